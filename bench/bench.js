@@ -19,6 +19,10 @@ const assert = require('assert');
 const bytes = require('bytes');
 const Queue = require('d3-queue').queue;
 const composite = require('../lib/index.js');
+if (argv.threadpool) {
+  // run on the vtcomposite threadpool instead of the libuv threadpool
+  composite.configure({ threadpool_size: argv.threadpool });
+}
 var rules = require('./rules');
 let ruleCount = 1;
 const mapnik = require('mapnik');
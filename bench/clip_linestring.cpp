@@ -0,0 +1,116 @@
+// Microbenchmark of the linestring clipper used when overzooming against
+// boost::geometry::intersection, which it replaces.
+//
+// Build and run with `make bench-clip`.
+
+#include "../src/clip.hpp"
+// geometry.hpp
+#include <mapbox/geometry.hpp>
+#include <mapbox/geometry/algorithms/detail/boost_adapters.hpp>
+// boost
+#include <boost/geometry/algorithms/intersection.hpp>
+// stl
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+using coordinate_type = std::int64_t;
+using point_type = mapbox::geometry::point<coordinate_type>;
+using line_string_type = mapbox::geometry::line_string<coordinate_type>;
+using multi_line_string_type = mapbox::geometry::multi_line_string<coordinate_type>;
+using box_type = mapbox::geometry::box<coordinate_type>;
+
+// random walks over a z+2 overzoom of a 4096 extent tile, so that most lines
+// cross the border of the target tile at least once
+std::vector<multi_line_string_type> make_lines(std::size_t count, std::size_t num_points)
+{
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<coordinate_type> start{-4096, 4 * 4096};
+    std::uniform_int_distribution<coordinate_type> step{-256, 256};
+    std::vector<multi_line_string_type> lines(count);
+    for (auto& multi_line : lines)
+    {
+        multi_line.emplace_back();
+        auto& line = multi_line.back();
+        point_type pt{start(gen), start(gen)};
+        for (std::size_t i = 0; i < num_points; ++i)
+        {
+            line.push_back(pt);
+            pt.x += step(gen);
+            pt.y += step(gen);
+        }
+    }
+    return lines;
+}
+
+std::vector<line_string_type> clip_boost(multi_line_string_type const& multi_line, box_type const& bbox)
+{
+    std::vector<line_string_type> result;
+    boost::geometry::intersection(multi_line, bbox, result);
+    return result;
+}
+
+std::vector<line_string_type> clip_vtile(multi_line_string_type const& multi_line, box_type const& bbox)
+{
+    std::vector<line_string_type> result;
+    vtile::linestring_clipper<coordinate_type> clipper{bbox, result};
+    for (auto const& line : multi_line)
+    {
+        clipper.begin();
+        for (auto const& pt : line)
+        {
+            clipper.add(pt);
+        }
+        clipper.end();
+    }
+    return result;
+}
+
+template <typename Func>
+double run(std::vector<multi_line_string_type> const& lines, box_type const& bbox, std::size_t iterations, Func&& func, std::size_t& num_parts)
+{
+    num_parts = 0;
+    auto const start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i)
+    {
+        for (auto const& line : lines)
+        {
+            num_parts += func(line, bbox).size();
+        }
+    }
+    std::chrono::duration<double, std::milli> const elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t const iterations = argc > 1 ? static_cast<std::size_t>(std::atoi(argv[1])) : 20;
+    box_type const bbox{{-128, -128}, {4096 + 128, 4096 + 128}};
+    auto const lines = make_lines(10000, 64);
+
+    for (auto const& line : lines)
+    {
+        if (clip_boost(line, bbox) != clip_vtile(line, bbox))
+        {
+            std::cerr << "linestring_clipper and boost::geometry::intersection disagree\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::size_t boost_parts = 0;
+    std::size_t vtile_parts = 0;
+    double const boost_ms = run(lines, bbox, iterations, clip_boost, boost_parts);
+    double const vtile_ms = run(lines, bbox, iterations, clip_vtile, vtile_parts);
+    std::cout << "clipped " << lines.size() * iterations << " linestrings of 64 points\n"
+              << "  boost::geometry::intersection: " << boost_ms << " ms (" << boost_parts << " parts)\n"
+              << "  vtile::linestring_clipper:     " << vtile_ms << " ms (" << vtile_parts << " parts)\n"
+              << "  speedup: " << boost_ms / vtile_ms << "x\n";
+    return EXIT_SUCCESS;
+}
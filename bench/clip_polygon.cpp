@@ -0,0 +1,150 @@
+// Microbenchmark of the polygon clipper used when overzooming against
+// boost::geometry::intersection, which it replaces in the common cases.
+//
+// Build and run with `make bench-clip`.
+
+#include "../src/clip.hpp"
+// geometry.hpp
+#include <mapbox/geometry.hpp>
+#include <mapbox/geometry/algorithms/detail/boost_adapters.hpp>
+// boost
+#include <boost/geometry/algorithms/intersection.hpp>
+// stl
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+using coordinate_type = std::int64_t;
+using ring_type = mapbox::geometry::linear_ring<coordinate_type>;
+using polygon_type = mapbox::geometry::polygon<coordinate_type>;
+using box_type = mapbox::geometry::box<coordinate_type>;
+
+// star-shaped polygons (buildings to landuse sized) over a z+2 overzoom of a
+// 4096 extent tile, so that many of them cross the border of the target tile
+std::vector<polygon_type> make_polygons(std::size_t count)
+{
+    constexpr double pi = 3.14159265358979323846;
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<coordinate_type> center{-4096, 4 * 4096};
+    std::uniform_real_distribution<double> radius{0.5, 1.0};
+    std::uniform_int_distribution<int> num_points{4, 64};
+    std::vector<polygon_type> polygons;
+    polygons.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        coordinate_type const cx = center(gen);
+        coordinate_type const cy = center(gen);
+        double const size = i % 10 == 0 ? 8192.0 : 512.0;
+        int const n = num_points(gen);
+        ring_type ring;
+        for (int k = 0; k < n; ++k)
+        {
+            double const angle = 2.0 * pi * k / n;
+            double const r = size * radius(gen);
+            ring.emplace_back(cx + static_cast<coordinate_type>(r * std::cos(angle)),
+                              cy + static_cast<coordinate_type>(r * std::sin(angle)));
+        }
+        ring.push_back(ring.front());
+        polygons.push_back(polygon_type{std::move(ring)});
+    }
+    return polygons;
+}
+
+std::vector<polygon_type> clip_boost(polygon_type const& polygon, box_type const& bbox)
+{
+    std::vector<polygon_type> result;
+    boost::geometry::intersection(polygon, bbox, result);
+    return result;
+}
+
+// what overzoomed_feature_clipper does
+std::vector<polygon_type> clip_vtile(polygon_type const& polygon, box_type const& bbox)
+{
+    std::vector<polygon_type> result;
+    if (!vtile::clip_polygon(bbox, polygon, result))
+    {
+        boost::geometry::intersection(polygon, bbox, result);
+    }
+    return result;
+}
+
+// `polygons` with each ring starting at its smallest point, so that results
+// which only differ by where their rings start compare equal
+std::vector<polygon_type> normalized(std::vector<polygon_type> polygons)
+{
+    for (auto& polygon : polygons)
+    {
+        for (auto& ring : polygon)
+        {
+            if (ring.size() < 2)
+            {
+                continue;
+            }
+            ring.pop_back();
+            auto const smallest = std::min_element(ring.begin(), ring.end(), [](auto const& a, auto const& b) {
+                return a.x < b.x || (a.x == b.x && a.y < b.y);
+            });
+            std::rotate(ring.begin(), smallest, ring.end());
+            ring.push_back(ring.front());
+        }
+    }
+    return polygons;
+}
+
+template <typename Func>
+double run(std::vector<polygon_type> const& polygons, box_type const& bbox, std::size_t iterations, Func&& func, std::size_t& num_polygons)
+{
+    num_polygons = 0;
+    auto const start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i)
+    {
+        for (auto const& polygon : polygons)
+        {
+            num_polygons += func(polygon, bbox).size();
+        }
+    }
+    std::chrono::duration<double, std::milli> const elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t const iterations = argc > 1 ? static_cast<std::size_t>(std::atoi(argv[1])) : 20;
+    box_type const bbox{{-128, -128}, {4096 + 128, 4096 + 128}};
+    auto const polygons = make_polygons(10000);
+
+    std::size_t fast = 0;
+    for (auto const& polygon : polygons)
+    {
+        std::vector<polygon_type> result;
+        if (!vtile::clip_polygon(bbox, polygon, result))
+        {
+            continue;
+        }
+        ++fast;
+        if (normalized(result) != normalized(clip_boost(polygon, bbox)))
+        {
+            std::cerr << "clip_polygon and boost::geometry::intersection disagree\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::size_t boost_polygons = 0;
+    std::size_t vtile_polygons = 0;
+    double const boost_ms = run(polygons, bbox, iterations, clip_boost, boost_polygons);
+    double const vtile_ms = run(polygons, bbox, iterations, clip_vtile, vtile_polygons);
+    std::cout << "clipped " << polygons.size() * iterations << " polygons (" << fast << "/" << polygons.size() << " without boost)\n"
+              << "  boost::geometry::intersection: " << boost_ms << " ms (" << boost_polygons << " polygons)\n"
+              << "  vtile::clip_polygon:           " << vtile_ms << " ms (" << vtile_polygons << " polygons)\n"
+              << "  speedup: " << boost_ms / vtile_ms << "x\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,435 @@
+// Microbenchmarks of the per-feature kernels of composite and localize, to
+// attribute regressions that bench/bench.js can only see as slower calls:
+//
+// - decode:    vtzero geometry decoding into the point, linestring and polygon
+//              handlers of overzooming (detail::*_handler)
+// - overzoom:  overzoomed_feature_builder::apply, i.e. envelope, decode, clip
+//              and encode of every feature, with 32 and 64-bit coordinates
+// - localize:  the property pass LocalizeWorker::Execute makes over every
+//              feature, and the rebuild of the feature with its new properties,
+//              comparing key strings (as it used to) and with the
+//              vtile::feature_localizer it uses now
+// - displacement and gzip compression and decompression of whole tiles
+//
+// Each kernel runs over real-world tiles from mvt-fixtures and a synthetic
+// tile and reports nanoseconds per feature and per vertex of the input.
+//
+// Build and run with `make bench-kernels`, optionally followed by the paths
+// of more tiles to run on: `./build/bench/kernels path/to/tile.mvt`.
+
+#include "../src/codec.hpp"
+#include "../src/feature_builder.hpp"
+#include "../src/feature_localizer.hpp"
+#include "../src/localize_keys.hpp"
+#include "../src/zxy_math.hpp"
+// vtzero
+#include <vtzero/builder.hpp>
+#include <vtzero/property_mapper.hpp>
+#include <vtzero/vector_tile.hpp>
+// stl
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr std::uint32_t zoom_factor = 4; // overzoomed two zoom levels
+constexpr int buffer_size = 128;
+
+struct input
+{
+    std::string name;
+    std::string data; // uncompressed tile
+    std::size_t features = 0;
+    std::size_t vertices = 0;
+};
+
+std::string read_file(std::string const& path)
+{
+    std::ifstream stream{path, std::ios::binary};
+    if (!stream)
+    {
+        std::cerr << "could not read " << path << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+    return {std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{}};
+}
+
+input make_input(std::string name, std::string data)
+{
+    vtile::codec const c = vtile::detect_codec(data.data(), data.size());
+    if (c != vtile::codec::none)
+    {
+        std::vector<char> buffer;
+        if (vtile::decompress(c, data.data(), data.size(), buffer))
+        {
+            data.assign(buffer.begin(), buffer.end());
+        }
+    }
+    input in{std::move(name), std::move(data)};
+    vtzero::vector_tile tile{in.data};
+    while (auto layer = tile.next_layer())
+    {
+        while (auto feature = layer.next_feature())
+        {
+            ++in.features;
+            in.vertices += vtile::count_vertices(feature);
+        }
+    }
+    return in;
+}
+
+// A tile of random points, linestrings and polygons with localize-like
+// properties, a tenth of the polygons reaching out of their overzoomed child.
+std::string make_synthetic_tile(std::size_t count)
+{
+    constexpr double pi = 3.14159265358979323846;
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<int> start{0, 4096};
+    std::uniform_int_distribution<int> step{-64, 64};
+    std::uniform_int_distribution<int> num_points{4, 64};
+    std::uniform_real_distribution<double> radius{0.5, 1.0};
+    char const* const languages[] = {"name_en", "name_fr", "name_de", "name_ja", "name_zh-Hans"};
+
+    vtzero::tile_builder tile;
+    vtzero::layer_builder points{tile, "points", 2, 4096};
+    vtzero::layer_builder lines{tile, "lines", 2, 4096};
+    vtzero::layer_builder polygons{tile, "polygons", 2, 4096};
+    auto const add_properties = [&](auto& builder, std::size_t i) {
+        builder.add_property("class", i % 3 == 0 ? "park" : "street");
+        builder.add_property("name", "Name " + std::to_string(i));
+        for (char const* language : languages)
+        {
+            builder.add_property(language, std::string{language} + " " + std::to_string(i));
+        }
+        builder.add_property(i % 2 == 0 ? "worldview" : "_mbx_worldview", i % 4 == 0 ? "all" : "US,CN,JP");
+    };
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        {
+            vtzero::point_feature_builder builder{points};
+            builder.set_id(i);
+            builder.add_point(start(gen), start(gen));
+            add_properties(builder, i);
+            builder.commit();
+        }
+        {
+            vtzero::linestring_feature_builder builder{lines};
+            builder.set_id(i);
+            builder.add_linestring(64);
+            int x = start(gen);
+            int y = start(gen);
+            for (int k = 0; k < 64; ++k)
+            {
+                builder.set_point(x, y);
+                x += step(gen);
+                y += step(gen);
+            }
+            add_properties(builder, i);
+            builder.commit();
+        }
+        {
+            vtzero::polygon_feature_builder builder{polygons};
+            builder.set_id(i);
+            int const cx = start(gen);
+            int const cy = start(gen);
+            double const size = i % 10 == 0 ? 2048.0 : 128.0;
+            int const n = num_points(gen);
+            std::vector<vtzero::point> ring;
+            for (int k = 0; k < n; ++k)
+            {
+                double const angle = 2.0 * pi * k / n; // clockwise with y pointing down: an outer ring
+                double const r = size * radius(gen);
+                vtzero::point const pt{cx + static_cast<int>(r * std::cos(angle)), cy + static_cast<int>(r * std::sin(angle))};
+                if (ring.empty() || pt != ring.back())
+                {
+                    ring.push_back(pt);
+                }
+            }
+            ring.push_back(ring.front());
+            builder.add_ring(static_cast<unsigned>(ring.size()));
+            for (auto const& pt : ring)
+            {
+                builder.set_point(pt);
+            }
+            add_properties(builder, i);
+            builder.commit();
+        }
+    }
+    return tile.serialize();
+}
+
+// Runs `func` (which goes over the whole tile once) until at least `min_ms`
+// have passed and prints the time per run, per feature and per vertex.
+template <typename Func>
+void run(std::string const& kernel, input const& in, double min_ms, Func&& func)
+{
+    std::size_t runs = 0;
+    std::size_t check = 0; // keeps the work from being optimized away
+    auto const start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed{0};
+    do
+    {
+        check += func();
+        ++runs;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed.count() < min_ms);
+    double const ns = elapsed.count() * 1e6 / static_cast<double>(runs);
+    std::cout << std::left << std::setw(28) << kernel << std::setw(36) << in.name << std::right
+              << std::fixed << std::setprecision(1)
+              << std::setw(12) << ns / 1e3 << " us/tile"
+              << std::setw(10) << ns / static_cast<double>(in.features) << " ns/feature"
+              << std::setw(10) << ns / static_cast<double>(in.vertices) << " ns/vertex"
+              << (check == 0 ? " (no output)" : "") << "\n";
+}
+
+// decodes every geometry as overzooming does before clipping
+template <typename CoordinateType>
+std::size_t decode(input const& in)
+{
+    auto& pool = vtile::scratch_pool<CoordinateType>::local();
+    mapbox::geometry::box<CoordinateType> const bbox{{-buffer_size, -buffer_size}, {4096 + buffer_size, 4096 + buffer_size}};
+    mapbox::geometry::multi_point<CoordinateType> points;
+    std::vector<mapbox::geometry::line_string<CoordinateType>> lines;
+    std::vector<vtile::detail::annotated_ring<CoordinateType>> rings;
+    std::size_t decoded = 0;
+    vtzero::vector_tile tile{in.data};
+    while (auto layer = tile.next_layer())
+    {
+        while (auto feature = layer.next_feature())
+        {
+            switch (feature.geometry_type())
+            {
+            case vtzero::GeomType::POINT:
+                vtzero::decode_point_geometry(feature.geometry(), vtile::detail::point_handler<CoordinateType>(points, 0, 0, zoom_factor, bbox));
+                decoded += points.size();
+                points.clear();
+                break;
+            case vtzero::GeomType::LINESTRING:
+                vtzero::decode_linestring_geometry(feature.geometry(), vtile::detail::line_string_handler<CoordinateType>(lines, 0, 0, zoom_factor));
+                decoded += lines.size();
+                pool.recycle_all(lines);
+                break;
+            case vtzero::GeomType::POLYGON:
+                vtzero::decode_polygon_geometry(feature.geometry(), vtile::detail::polygon_handler<CoordinateType>(rings, 0, 0, zoom_factor));
+                decoded += rings.size();
+                for (auto& ring : rings)
+                {
+                    pool.recycle(ring.first);
+                }
+                rings.clear();
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    return decoded;
+}
+
+// overzooms every layer into the second child of the tile on each axis
+template <typename CoordinateType>
+std::size_t overzoom(input const& in)
+{
+    std::uint32_t dx = 0;
+    std::uint32_t dy = 0;
+    std::tie(dx, dy) = vtile::displacement(0, 4096, 2, 1, 1);
+    mapbox::geometry::box<CoordinateType> const bbox{{-buffer_size, -buffer_size}, {4096 + buffer_size, 4096 + buffer_size}};
+    vtzero::tile_builder builder;
+    vtzero::vector_tile tile{in.data};
+    while (auto layer = tile.next_layer())
+    {
+        vtzero::layer_builder layer_builder{builder, layer.name(), layer.version(), layer.extent()};
+        vtzero::property_mapper mapper{layer, layer_builder};
+        vtile::overzoomed_feature_builder<CoordinateType> f_builder{layer_builder, mapper, bbox, dx, dy, zoom_factor};
+        while (auto feature = layer.next_feature())
+        {
+            f_builder.apply(feature);
+        }
+    }
+    return builder.serialize().size();
+}
+
+// What LocalizeWorker::Execute did for each feature of a localized tile
+// (languages ['en'], worldviews ['US']) before keys were classified per
+// layer: classify every property key, keep the preferred language and the
+// compatible worldview, then rebuild the feature with its new properties.
+std::size_t localize_strings(input const& in)
+{
+    std::string const worldview_property = "worldview";
+    std::string const hidden_prefix = "_mbx_";
+    std::string const class_property = "class";
+    std::string const language_property = "name";
+    std::vector<std::string> const language_key_precedence = {"name_en", "_mbx_name_en", "name"};
+
+    vtzero::tile_builder builder;
+    vtzero::vector_tile tile{in.data};
+    while (auto layer = tile.next_layer())
+    {
+        vtzero::layer_builder layer_builder{builder, layer.name(), layer.version(), layer.extent()};
+        while (auto feature = layer.next_feature())
+        {
+            std::vector<std::pair<std::string, vtzero::property_value>> final_properties;
+            auto language_key_idx = language_key_precedence.size();
+            vtzero::property_value language_value;
+            bool skip_feature = false;
+            while (auto property = feature.next_property())
+            {
+                std::string const property_key = property.key().to_string();
+                if (property_key == worldview_property || property_key == hidden_prefix + worldview_property)
+                {
+                    if (property_key == worldview_property && property.value().type() == vtzero::property_value_type::string_value &&
+                        property.value().string_value() != "all")
+                    {
+                        skip_feature = true;
+                    }
+                }
+                else if (property_key == class_property || property_key == hidden_prefix + class_property)
+                {
+                    final_properties.emplace_back(class_property, property.value());
+                }
+                else if (vtile::starts_with(property_key, language_property))
+                {
+                    for (std::size_t i = 0; i < language_key_idx; ++i)
+                    {
+                        if (property_key == language_key_precedence[i])
+                        {
+                            language_key_idx = i;
+                            language_value = property.value();
+                            break;
+                        }
+                    }
+                }
+                else if (!vtile::starts_with(property_key, hidden_prefix))
+                {
+                    final_properties.emplace_back(property_key, property.value());
+                }
+            }
+            if (skip_feature)
+            {
+                continue;
+            }
+            if (language_value.valid())
+            {
+                final_properties.emplace_back(language_property, language_value);
+            }
+            vtzero::geometry_feature_builder fbuilder{layer_builder};
+            fbuilder.copy_id(feature);
+            fbuilder.set_geometry(feature.geometry());
+            for (auto const& property : final_properties)
+            {
+                fbuilder.add_property(property.first, property.second);
+            }
+            fbuilder.commit();
+        }
+    }
+    return builder.serialize().size();
+}
+
+// What LocalizeWorker::Execute does for each layer of a localized tile with
+// the same params: classify the keys of the layer once, then localize each
+// feature by the roles of its key indexes and rebuild it with its new
+// properties (see add_localized_layer)
+std::size_t localize_indexed(input const& in)
+{
+    vtile::localize_options const options = vtile::make_localize_options("_mbx_", {}, {"en"}, "name", {"US"}, "worldview", "class", true);
+
+    vtzero::tile_builder builder;
+    vtzero::vector_tile tile{in.data};
+    while (auto layer = tile.next_layer())
+    {
+        vtzero::layer_builder layer_builder{builder, layer.name(), layer.version(), layer.extent()};
+        std::vector<vtile::localize_key> const keys = vtile::classify_keys(layer.key_table(), options);
+        vtile::feature_localizer localizer{layer, keys, options, layer_builder};
+        while (auto feature = layer.next_feature())
+        {
+            if (localizer.accept(feature))
+            {
+                for (std::size_t copy = 0; copy < localizer.copies(); ++copy)
+                {
+                    vtile::add_localized_feature(layer_builder, feature, localizer.properties(copy));
+                }
+            }
+        }
+    }
+    return builder.serialize().size();
+}
+
+std::size_t displacement(input const& in)
+{
+    // one displacement per feature, as composite computes one per layer
+    std::size_t sum = 0;
+    for (std::uint32_t i = 0; i < in.features; ++i)
+    {
+        std::uint32_t dx = 0;
+        std::uint32_t dy = 0;
+        std::tie(dx, dy) = vtile::displacement(10, 4096, 10 + (i % 8), i, i >> 3U);
+        sum += dx + dy;
+    }
+    return sum;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    double const min_ms = 500.0;
+    std::vector<std::string> paths = {
+        "node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt",
+        "node_modules/@mapbox/mvt-fixtures/real-world/bangkok/12-3188-1888.mvt",
+        "test/fixtures/polygons-buildings-sf-15-5239-12666.mvt"};
+    for (int i = 1; i < argc; ++i)
+    {
+        paths.emplace_back(argv[i]);
+    }
+    std::vector<input> inputs;
+    for (auto const& path : paths)
+    {
+        inputs.push_back(make_input(path.substr(path.find_last_of('/') + 1), read_file(path)));
+    }
+    inputs.push_back(make_input("synthetic", make_synthetic_tile(2000)));
+
+    for (auto const& in : inputs)
+    {
+        std::cout << in.name << ": " << in.data.size() << " bytes, " << in.features << " features, " << in.vertices << " vertices\n";
+    }
+    std::cout << "\n";
+
+    vtile::compression_options gzip;
+    gzip.codec = vtile::codec::gzip;
+    for (auto const& in : inputs)
+    {
+        run("decode (32-bit)", in, min_ms, [&] { return decode<std::int32_t>(in); });
+        run("decode (64-bit)", in, min_ms, [&] { return decode<std::int64_t>(in); });
+        run("overzoom (32-bit)", in, min_ms, [&] { return overzoom<std::int32_t>(in); });
+        run("overzoom (64-bit)", in, min_ms, [&] { return overzoom<std::int64_t>(in); });
+        run("localize (key strings)", in, min_ms, [&] { return localize_strings(in); });
+        run("localize (key indexes)", in, min_ms, [&] { return localize_indexed(in); });
+        run("displacement", in, min_ms, [&] { return displacement(in); });
+
+        std::string compressed;
+        vtile::compress(gzip, in.data.data(), in.data.size(), compressed);
+        run("gzip compress", in, min_ms, [&] {
+            std::string output;
+            vtile::compress(gzip, in.data.data(), in.data.size(), output);
+            return output.size();
+        });
+        std::vector<char> output;
+        run("gzip decompress", in, min_ms, [&] {
+            vtile::decompress(vtile::codec::gzip, compressed.data(), compressed.size(), output);
+            return output.size();
+        });
+        std::cout << "\n";
+    }
+    return EXIT_SUCCESS;
+}
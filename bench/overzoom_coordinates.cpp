@@ -0,0 +1,167 @@
+// Microbenchmark of overzooming with 32-bit against 64-bit coordinates: the
+// transform into the target tile, linestring clipping and polygon clipping
+// as done by overzoomed_feature_clipper, with both coordinate types.
+//
+// Build and run with `make bench-coordinates`.
+
+#include "../src/clip.hpp"
+// geometry.hpp
+#include <mapbox/geometry.hpp>
+#include <mapbox/geometry/algorithms/detail/boost_adapters.hpp>
+// boost
+#include <boost/geometry/algorithms/intersection.hpp>
+#include <boost/geometry/geometries/register/point.hpp>
+// stl
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+BOOST_GEOMETRY_REGISTER_POINT_2D(mapbox::geometry::point<std::int32_t>, std::int32_t, boost::geometry::cs::cartesian, x, y)
+
+namespace {
+
+constexpr std::int32_t extent = 4096;
+constexpr std::int32_t zoom_factor = 4;
+constexpr std::int32_t buffer = 128;
+
+// source geometries in the coordinates of a 4096 extent tile, overzoomed by
+// a factor of 4 into its second child on each axis
+struct source
+{
+    std::vector<std::vector<mapbox::geometry::point<std::int32_t>>> lines;
+    std::vector<std::vector<mapbox::geometry::point<std::int32_t>>> rings;
+};
+
+source make_source(std::size_t count)
+{
+    constexpr double pi = 3.14159265358979323846;
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<std::int32_t> start{0, extent};
+    std::uniform_int_distribution<std::int32_t> step{-64, 64};
+    std::uniform_real_distribution<double> radius{0.5, 1.0};
+    std::uniform_int_distribution<int> num_points{4, 64};
+    source src;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::vector<mapbox::geometry::point<std::int32_t>> line;
+        mapbox::geometry::point<std::int32_t> pt{start(gen), start(gen)};
+        for (int k = 0; k < 64; ++k)
+        {
+            line.push_back(pt);
+            pt.x += step(gen);
+            pt.y += step(gen);
+        }
+        src.lines.push_back(std::move(line));
+
+        std::int32_t const cx = start(gen);
+        std::int32_t const cy = start(gen);
+        double const size = i % 10 == 0 ? 2048.0 : 128.0;
+        int const n = num_points(gen);
+        std::vector<mapbox::geometry::point<std::int32_t>> ring;
+        for (int k = 0; k < n; ++k)
+        {
+            double const angle = 2.0 * pi * k / n;
+            double const r = size * radius(gen);
+            ring.emplace_back(cx + static_cast<std::int32_t>(r * std::cos(angle)),
+                              cy + static_cast<std::int32_t>(r * std::sin(angle)));
+        }
+        ring.push_back(ring.front());
+        src.rings.push_back(std::move(ring));
+    }
+    return src;
+}
+
+struct result
+{
+    double ms = 0.0;
+    std::size_t num_points = 0;
+    std::size_t bytes = 0;
+};
+
+template <typename CoordinateType>
+mapbox::geometry::point<CoordinateType> transform(mapbox::geometry::point<std::int32_t> const& pt)
+{
+    // what the feature handlers do, in the coordinate type of the builder
+    return {static_cast<CoordinateType>(pt.x) * zoom_factor - extent, static_cast<CoordinateType>(pt.y) * zoom_factor - extent};
+}
+
+template <typename CoordinateType>
+result run(source const& src, std::size_t iterations)
+{
+    using point_type = mapbox::geometry::point<CoordinateType>;
+    using line_string_type = mapbox::geometry::line_string<CoordinateType>;
+    using polygon_type = mapbox::geometry::polygon<CoordinateType>;
+    mapbox::geometry::box<CoordinateType> const bbox{{-buffer, -buffer}, {extent + buffer, extent + buffer}};
+
+    result res;
+    auto const start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i)
+    {
+        std::vector<line_string_type> lines;
+        std::vector<polygon_type> polygons;
+        vtile::linestring_clipper<CoordinateType> clipper{bbox, lines};
+        for (auto const& line : src.lines)
+        {
+            clipper.begin();
+            for (auto const& pt : line)
+            {
+                clipper.add(transform<CoordinateType>(pt));
+            }
+            clipper.end();
+        }
+        for (auto const& ring : src.rings)
+        {
+            polygon_type polygon;
+            polygon.emplace_back();
+            for (auto const& pt : ring)
+            {
+                polygon.back().push_back(transform<CoordinateType>(pt));
+            }
+            if (!vtile::clip_polygon(bbox, polygon, polygons))
+            {
+                boost::geometry::intersection(polygon, bbox, polygons);
+            }
+        }
+        res.num_points = 0;
+        for (auto const& line : lines)
+        {
+            res.num_points += line.size();
+        }
+        for (auto const& polygon : polygons)
+        {
+            for (auto const& ring : polygon)
+            {
+                res.num_points += ring.size();
+            }
+        }
+        res.bytes = res.num_points * sizeof(point_type);
+    }
+    std::chrono::duration<double, std::milli> const elapsed = std::chrono::steady_clock::now() - start;
+    res.ms = elapsed.count();
+    return res;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t const iterations = argc > 1 ? static_cast<std::size_t>(std::atoi(argv[1])) : 20;
+    auto const src = make_source(10000);
+
+    auto const wide = run<std::int64_t>(src, iterations);
+    auto const narrow = run<std::int32_t>(src, iterations);
+    if (wide.num_points != narrow.num_points)
+    {
+        std::cerr << "32-bit and 64-bit overzooming disagree\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "overzoomed " << src.lines.size() * iterations << " linestrings and " << src.rings.size() * iterations << " polygons\n"
+              << "  64-bit coordinates: " << wide.ms << " ms (" << wide.bytes / 1024 << " KiB of clipped points)\n"
+              << "  32-bit coordinates: " << narrow.ms << " ms (" << narrow.bytes / 1024 << " KiB of clipped points)\n"
+              << "  speedup: " << wide.ms / narrow.ms << "x\n";
+    return EXIT_SUCCESS;
+}
@@ -11,6 +11,17 @@
   'includes': [ 'common.gypi'], # brings in a default set of options that are inherited from gyp
   'variables': { # custom variables we use specific to this file
       'error_on_warnings%':'true', # can be overriden by a command line variable because of the % sign using "WERROR" (defined in Makefile)
+      # Clip all overzoomed polygons with boost::geometry::intersection instead of the
+      # Sutherland–Hodgman clipper in src/clip.hpp, to compare results and speed
+      'boost_polygon_clipping%':'false',
+      # Count the heap allocations of every composite call and pass them to its
+      # callback (debugging only: replaces the global operator new of the module)
+      'count_allocations%':'false',
+      # Inflate and deflate tiles with libdeflate (from the system) instead of zlib
+      'libdeflate%':'false',
+      # Support zstd and brotli compressed tiles (libraries from the system)
+      'zstd%':'false',
+      'brotli%':'false',
       # Use this variable to silence warnings from mason dependencies
       # It's a variable to make easy to pass to
       # cflags (linux) and xcode (mac)
@@ -74,8 +85,14 @@
       # This also is where the benefits of using a "glob" come into play...
       # See: https://github.com/mapbox/node-cpp-skel/pull/44#discussion_r122050205
       'sources': [
+        './src/allocations.cpp',
+        './src/codec.cpp',
+        './src/memory_budget.cpp',
         './src/module.cpp',
-        './src/vtcomposite.cpp'
+        './src/module_data.cpp',
+        './src/tile_cache.cpp',
+        './src/vtcomposite.cpp',
+        './src/worker.cpp'
       ],
       'ldflags': [
         '-Wl,-z,now',
@@ -86,6 +103,24 @@
             'xcode_settings': {
               'OTHER_CPLUSPLUSFLAGS': [ '-Werror' ]
             }
+        }],
+        ['boost_polygon_clipping == "true"', {
+            'defines': [ 'VTCOMPOSITE_BOOST_POLYGON_CLIPPING' ]
+        }],
+        ['count_allocations == "true"', {
+            'defines': [ 'VTCOMPOSITE_COUNT_ALLOCATIONS' ]
+        }],
+        ['libdeflate == "true"', {
+            'defines': [ 'VTCOMPOSITE_LIBDEFLATE' ],
+            'libraries': [ '-ldeflate' ]
+        }],
+        ['zstd == "true"', {
+            'defines': [ 'VTCOMPOSITE_ZSTD' ],
+            'libraries': [ '-lzstd' ]
+        }],
+        ['brotli == "true"', {
+            'defines': [ 'VTCOMPOSITE_BROTLI' ],
+            'libraries': [ '-lbrotlienc', '-lbrotlidec' ]
         }]
       ],
       #'include_dirs' : ["<!@(node -p \"require('node-addon-api').include\")"],
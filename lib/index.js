@@ -1,4 +1,12 @@
 "use strict";
 
 module.exports.composite = require('./binding/vtcomposite.node').composite;
+module.exports.compositeSync = require('./binding/vtcomposite.node').compositeSync;
+module.exports.compositePacked = require('./binding/vtcomposite.node').compositePacked;
+module.exports.compositeBatch = require('./binding/vtcomposite.node').compositeBatch;
 module.exports.localize = require('./binding/vtcomposite.node').localize;
+module.exports.localizeSync = require('./binding/vtcomposite.node').localizeSync;
+module.exports.localizeBatch = require('./binding/vtcomposite.node').localizeBatch;
+module.exports.configure = require('./binding/vtcomposite.node').configure;
+module.exports.cacheStats = require('./binding/vtcomposite.node').cacheStats;
+module.exports.memoryStats = require('./binding/vtcomposite.node').memoryStats;
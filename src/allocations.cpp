@@ -0,0 +1,59 @@
+#include "allocations.hpp"
+
+#ifdef VTCOMPOSITE_COUNT_ALLOCATIONS
+
+// stl
+#include <cstdlib>
+#include <new>
+
+namespace vtile {
+
+namespace {
+
+thread_local allocation_counter* current_counter = nullptr;
+
+} // namespace
+
+allocation_counter* current_allocation_counter()
+{
+    return current_counter;
+}
+
+allocation_scope::allocation_scope(allocation_counter* counter)
+    : previous_{current_counter}
+{
+    current_counter = counter;
+}
+
+allocation_scope::~allocation_scope()
+{
+    current_counter = previous_;
+}
+
+} // namespace vtile
+
+void* operator new(std::size_t size)
+{
+    if (vtile::current_counter != nullptr)
+    {
+        vtile::current_counter->count.fetch_add(1, std::memory_order_relaxed);
+    }
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc{};
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /*unused*/) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
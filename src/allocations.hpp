@@ -0,0 +1,55 @@
+#pragma once
+
+// stl
+#include <atomic>
+#include <cstddef>
+
+namespace vtile {
+
+// Debug counter of the heap allocations made while compositing. Counting is
+// only enabled in builds with `--count_allocations=true`
+// (`COUNT_ALLOCATIONS=true make`), which replace the global operator new of
+// the module; otherwise counters stay at 0 and scopes are free.
+//
+// Allocations are counted on the threads that have a counter installed with
+// an allocation_scope, so concurrent calls do not count each other's.
+struct allocation_counter
+{
+    std::atomic<std::size_t> count{0};
+};
+
+#ifdef VTCOMPOSITE_COUNT_ALLOCATIONS
+
+// the counter installed on the calling thread, or nullptr
+allocation_counter* current_allocation_counter();
+
+// Installs `counter` on the calling thread for the lifetime of the scope.
+class allocation_scope
+{
+  public:
+    explicit allocation_scope(allocation_counter* counter);
+    ~allocation_scope();
+
+    allocation_scope(allocation_scope const&) = delete;
+    allocation_scope& operator=(allocation_scope const&) = delete;
+
+  private:
+    allocation_counter* previous_;
+};
+
+#else
+
+inline allocation_counter* current_allocation_counter()
+{
+    return nullptr;
+}
+
+class allocation_scope
+{
+  public:
+    explicit allocation_scope(allocation_counter* /*unused*/) {}
+};
+
+#endif
+
+} // namespace vtile
@@ -0,0 +1,84 @@
+#pragma once
+
+// stl
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace vtile {
+
+// Thrown by cancellation::check() to abort a call; the worker reports its
+// message as the error of the call.
+class cancelled_error : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+// The deadline (the `deadline_ms` option) and the cancel flag (set by the
+// `signal` option) of a call. Workers check them between layers and features,
+// so a call stops within a feature of being cancelled, however large its
+// sources. Code paths take a pointer to it, which is null when neither option
+// is set (see if_active()).
+class cancellation
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    // Expires the call `ms` milliseconds from now.
+    void set_deadline(std::uint32_t ms)
+    {
+        deadline_ms_ = ms;
+        deadline_ = clock::now() + std::chrono::milliseconds{ms};
+    }
+
+    // The flag that cancels the call once set, shared with whoever may cancel
+    // it from another thread.
+    std::shared_ptr<std::atomic<bool>> const& flag()
+    {
+        if (!flag_)
+        {
+            flag_ = std::make_shared<std::atomic<bool>>(false);
+        }
+        return flag_;
+    }
+
+    // this, or null if the call can neither expire nor be cancelled
+    cancellation const* if_active() const
+    {
+        return (deadline_ms_ > 0 || flag_) ? this : nullptr;
+    }
+
+    // Throws cancelled_error if the call was cancelled or is past its
+    // deadline.
+    void check() const
+    {
+        if (flag_ && flag_->load(std::memory_order_relaxed))
+        {
+            throw cancelled_error{"cancelled: the signal of the call was aborted"};
+        }
+        if (deadline_ms_ > 0 && clock::now() >= deadline_)
+        {
+            throw cancelled_error{"deadline exceeded: the call took longer than " + std::to_string(deadline_ms_) + " ms"};
+        }
+    }
+
+  private:
+    std::uint32_t deadline_ms_ = 0; // no deadline if 0
+    clock::time_point deadline_{};
+    std::shared_ptr<std::atomic<bool>> flag_{};
+};
+
+// checks `cancel` if set
+inline void check(cancellation const* cancel)
+{
+    if (cancel != nullptr)
+    {
+        cancel->check();
+    }
+}
+
+} // namespace vtile
@@ -0,0 +1,598 @@
+#pragma once
+
+#include "scratch.hpp"
+// geometry.hpp
+#include <mapbox/geometry/box.hpp>
+#include <mapbox/geometry/envelope.hpp>
+#include <mapbox/geometry/line_string.hpp>
+#include <mapbox/geometry/point.hpp>
+#include <mapbox/geometry/polygon.hpp>
+// boost
+#include <boost/geometry/util/promote_integral.hpp>
+// stl
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace vtile {
+namespace detail {
+
+// one step of Liang–Barsky: narrows [t0, t1] to the part of the segment on the
+// inner side of an edge; returns false if nothing is left
+inline bool clip_edge(double p, double q, double& t0, double& t1)
+{
+    if (p < 0)
+    {
+        double const r = q / p;
+        if (r > t1)
+        {
+            return false;
+        }
+        if (r > t0)
+        {
+            t0 = r;
+        }
+    }
+    else if (p > 0)
+    {
+        double const r = q / p;
+        if (r < t0)
+        {
+            return false;
+        }
+        if (r < t1)
+        {
+            t1 = r;
+        }
+    }
+    else if (q < 0)
+    {
+        return false;
+    }
+    return true;
+}
+
+// Cohen–Sutherland region code of a point: one bit per box edge the point
+// lies beyond, 0 if it is within the box (border included)
+template <typename CoordinateType>
+inline unsigned outcode(mapbox::geometry::box<CoordinateType> const& bbox, mapbox::geometry::point<CoordinateType> const& pt)
+{
+    return (pt.x < bbox.min.x ? 1U : 0U) |
+           (pt.x > bbox.max.x ? 2U : 0U) |
+           (pt.y < bbox.min.y ? 4U : 0U) |
+           (pt.y > bbox.max.y ? 8U : 0U);
+}
+
+// true if `envelope` is empty or shares no point with `bbox`
+template <typename EnvelopeCoordinateType, typename CoordinateType>
+inline bool disjoint(mapbox::geometry::box<EnvelopeCoordinateType> const& envelope, mapbox::geometry::box<CoordinateType> const& bbox)
+{
+    return envelope.min.x > envelope.max.x ||
+           envelope.max.x < bbox.min.x || envelope.min.x > bbox.max.x ||
+           envelope.max.y < bbox.min.y || envelope.min.y > bbox.max.y;
+}
+
+// true if `envelope` lies within `bbox`, boundary included
+template <typename EnvelopeCoordinateType, typename CoordinateType>
+inline bool covered_by(mapbox::geometry::box<EnvelopeCoordinateType> const& envelope, mapbox::geometry::box<CoordinateType> const& bbox)
+{
+    return envelope.min.x >= bbox.min.x && envelope.max.x <= bbox.max.x &&
+           envelope.min.y >= bbox.min.y && envelope.max.y <= bbox.max.y;
+}
+
+} // namespace detail
+
+// Clips the segment p0-p1 against an axis-aligned box (Liang–Barsky). Returns
+// false if the segment lies outside of the box, otherwise moves the end points
+// onto the box border where needed and reports which ones were moved.
+//
+// New end points are computed in double precision and truncated towards zero,
+// like boost::geometry does for integer coordinates, so the results are the
+// same as those of boost::geometry::intersection.
+template <typename CoordinateType>
+bool clip_segment(mapbox::geometry::box<CoordinateType> const& bbox,
+                  mapbox::geometry::point<CoordinateType>& p0,
+                  mapbox::geometry::point<CoordinateType>& p1,
+                  bool& p0_clipped, bool& p1_clipped)
+{
+    CoordinateType const dx = p1.x - p0.x;
+    CoordinateType const dy = p1.y - p0.y;
+    double t0 = 0.0;
+    double t1 = 1.0;
+    if (!detail::clip_edge(static_cast<double>(-dx), static_cast<double>(p0.x - bbox.min.x), t0, t1) ||
+        !detail::clip_edge(static_cast<double>(dx), static_cast<double>(bbox.max.x - p0.x), t0, t1) ||
+        !detail::clip_edge(static_cast<double>(-dy), static_cast<double>(p0.y - bbox.min.y), t0, t1) ||
+        !detail::clip_edge(static_cast<double>(dy), static_cast<double>(bbox.max.y - p0.y), t0, t1))
+    {
+        return false;
+    }
+    p0_clipped = t0 > 0.0;
+    p1_clipped = t1 < 1.0;
+    if (p1_clipped)
+    {
+        p1.x = static_cast<CoordinateType>(static_cast<double>(p0.x) + t1 * static_cast<double>(dx));
+        p1.y = static_cast<CoordinateType>(static_cast<double>(p0.y) + t1 * static_cast<double>(dy));
+    }
+    if (p0_clipped)
+    {
+        p0.x = static_cast<CoordinateType>(static_cast<double>(p0.x) + t0 * static_cast<double>(dx));
+        p0.y = static_cast<CoordinateType>(static_cast<double>(p0.y) + t0 * static_cast<double>(dy));
+    }
+    return true;
+}
+
+// Clips linestrings against an axis-aligned box while they are being decoded,
+// one point at a time, without building the whole linestring first. Each part
+// of a linestring within the box is appended to `lines` as a separate
+// linestring, with repeated points removed.
+//
+// Usage: begin(), add() for every point, end() for every linestring.
+template <typename CoordinateType>
+class linestring_clipper
+{
+  public:
+    using point_type = mapbox::geometry::point<CoordinateType>;
+    using line_string_type = mapbox::geometry::line_string<CoordinateType>;
+
+    linestring_clipper(mapbox::geometry::box<CoordinateType> const& bbox,
+                       std::vector<line_string_type>& lines)
+        : bbox_{bbox},
+          lines_{lines} {}
+
+    ~linestring_clipper()
+    {
+        pool_.recycle(part_);
+    }
+
+    // move-only: part_ goes back to the pool once, with the clipper that
+    // owns it (a moved-from part_ has no capacity and is not kept)
+    linestring_clipper(linestring_clipper const&) = delete;
+    linestring_clipper& operator=(linestring_clipper const&) = delete;
+    linestring_clipper(linestring_clipper&&) noexcept = default;
+    linestring_clipper& operator=(linestring_clipper&&) = delete;
+
+    void begin()
+    {
+        finish_part();
+        has_previous_ = false;
+    }
+
+    void add(point_type const& pt)
+    {
+        unsigned const code = detail::outcode(bbox_, pt);
+        if (!has_previous_)
+        {
+            previous_ = pt;
+            previous_code_ = code;
+            has_previous_ = true;
+            return;
+        }
+        point_type p0 = previous_;
+        point_type p1 = pt;
+        unsigned const p0_code = previous_code_;
+        previous_ = pt;
+        previous_code_ = code;
+        bool p0_clipped = false;
+        bool p1_clipped = false;
+        // trivial reject: both ends beyond the same edge
+        // trivial accept: both ends within the box, nothing to compute
+        if ((p0_code & code) != 0 ||
+            ((p0_code | code) != 0 && !clip_segment(bbox_, p0, p1, p0_clipped, p1_clipped)))
+        {
+            finish_part();
+            return;
+        }
+        if (p0_clipped)
+        {
+            finish_part(); // the line re-enters the box
+        }
+        if (part_.empty())
+        {
+            part_.push_back(p0);
+        }
+        if (part_.back() != p1)
+        {
+            part_.push_back(p1);
+        }
+        if (p1_clipped)
+        {
+            finish_part(); // the line leaves the box
+        }
+    }
+
+    void end()
+    {
+        finish_part();
+    }
+
+  private:
+    void finish_part()
+    {
+        if (!part_.empty())
+        {
+            // copied rather than moved, so part_ keeps its capacity
+            lines_.push_back(pool_.take_line());
+            lines_.back().assign(part_.begin(), part_.end());
+            part_.clear();
+        }
+    }
+
+    mapbox::geometry::box<CoordinateType> const& bbox_;
+    std::vector<line_string_type>& lines_;
+    scratch_pool<CoordinateType>& pool_ = scratch_pool<CoordinateType>::local();
+    line_string_type part_ = pool_.take_line();
+    point_type previous_{};
+    unsigned previous_code_ = 0;
+    bool has_previous_ = false;
+};
+
+namespace detail {
+
+// true if `pt` lies in the interior of `bbox`, not on its border
+template <typename CoordinateType>
+inline bool in_interior(mapbox::geometry::box<CoordinateType> const& bbox, mapbox::geometry::point<CoordinateType> const& pt)
+{
+    return pt.x > bbox.min.x && pt.x < bbox.max.x && pt.y > bbox.min.y && pt.y < bbox.max.y;
+}
+
+// Number of times a closed ring enters the interior of the box, coming from
+// outside of it or from its border. A ring that only touches the border from
+// inside still counts twice, since the clipped ring would touch itself there.
+template <typename CoordinateType>
+std::size_t count_entries(mapbox::geometry::box<CoordinateType> const& bbox, mapbox::geometry::linear_ring<CoordinateType> const& ring)
+{
+    std::size_t entries = 0;
+    for (std::size_t i = 1; i < ring.size(); ++i)
+    {
+        auto p0 = ring[i - 1];
+        auto p1 = ring[i];
+        if (in_interior(bbox, p0))
+        {
+            continue;
+        }
+        if (in_interior(bbox, p1))
+        {
+            ++entries;
+            continue;
+        }
+        // both ends outside or on the border: does the segment cut through the box?
+        bool p0_clipped = false;
+        bool p1_clipped = false;
+        if ((outcode(bbox, p0) & outcode(bbox, p1)) == 0 && clip_segment(bbox, p0, p1, p0_clipped, p1_clipped))
+        {
+            double const mid_x = (static_cast<double>(p0.x) + static_cast<double>(p1.x)) / 2.0;
+            double const mid_y = (static_cast<double>(p0.y) + static_cast<double>(p1.y)) / 2.0;
+            if (mid_x > static_cast<double>(bbox.min.x) && mid_x < static_cast<double>(bbox.max.x) &&
+                mid_y > static_cast<double>(bbox.min.y) && mid_y < static_cast<double>(bbox.max.y))
+            {
+                ++entries;
+            }
+        }
+    }
+    return entries;
+}
+
+// the segment of a traced_point whose edge runs along the border of the box
+constexpr std::size_t border_segment = static_cast<std::size_t>(-1);
+
+// One Sutherland–Hodgman step: keeps the part of the (open) ring `in` on the
+// inner side of a single box edge. `inside` tells whether a point is on the
+// inner side, `intersect` returns the point where the edge leading to a
+// vertex crosses the box edge.
+template <typename CoordinateType, typename Inside, typename Intersect>
+void clip_ring_by_edge(std::vector<traced_point<CoordinateType>> const& in, std::vector<traced_point<CoordinateType>>& out,
+                       Inside&& inside, Intersect&& intersect)
+{
+    out.clear();
+    if (in.empty())
+    {
+        return;
+    }
+    traced_point<CoordinateType> const* prev = &in.back();
+    bool prev_inside = inside(prev->point);
+    for (auto const& pt : in)
+    {
+        bool const pt_inside = inside(pt.point);
+        if (pt_inside != prev_inside)
+        {
+            // leaving, the edge to the crossing lies on the same segment;
+            // coming back in, it runs along the box edge from where the ring left
+            out.push_back({intersect(*prev, pt), pt_inside ? border_segment : pt.segment});
+        }
+        if (pt_inside)
+        {
+            out.push_back(pt);
+        }
+        prev = &pt;
+        prev_inside = pt_inside;
+    }
+}
+
+// The coordinate where the segment a-b crosses the box edge running from
+// `from` to `to` on the line at `c` (x = c if `vertical`, otherwise y = c).
+//
+// Computed exactly as boost::geometry::intersection does for polygons, so
+// clip_polygon gives the same points as the boost::geometry fallback: the
+// exact crossing is truncated towards zero from the start of either the
+// segment or the box edge, whichever it is not close to the end of, or else
+// from the longer of the two. This is why the points differ from the ones
+// clip_segment gives for the same segment.
+template <typename CoordinateType>
+CoordinateType crossing(mapbox::geometry::point<CoordinateType> const& a,
+                        mapbox::geometry::point<CoordinateType> const& b,
+                        CoordinateType c,
+                        bool vertical,
+                        CoordinateType from,
+                        CoordinateType to)
+{
+    using calc_type = typename boost::geometry::promote_integral<CoordinateType>::type;
+    CoordinateType const a_along = vertical ? a.x : a.y;
+    CoordinateType const a_other = vertical ? a.y : a.x;
+    calc_type den = calc_type(vertical ? b.x : b.y) - calc_type(a_along);
+    calc_type const delta = calc_type(vertical ? b.y : b.x) - calc_type(a_other);
+    double const ratio_segment = static_cast<double>(calc_type(c) - calc_type(a_along)) / static_cast<double>(den);
+    calc_type const length_segment = den * den + delta * delta;
+    // the crossing is at a_other + num / den along the other axis
+    calc_type num = (calc_type(c) - calc_type(a_along)) * delta;
+    if (den < 0)
+    {
+        num = -num;
+        den = -den;
+    }
+    // the same crossing, counted from the start of the box edge
+    calc_type const num_edge = (calc_type(a_other) - calc_type(from)) * den + num;
+    double const ratio_edge = static_cast<double>(num_edge) / static_cast<double>(den) / static_cast<double>(calc_type(to) - calc_type(from));
+    calc_type const length_edge = (calc_type(to) - calc_type(from)) * (calc_type(to) - calc_type(from));
+    bool const near_end_segment = ratio_segment < 0.01 || ratio_segment > 0.99;
+    bool const near_end_edge = ratio_edge < 0.01 || ratio_edge > 0.99;
+    bool const from_segment = near_end_segment != near_end_edge ? near_end_segment : !(length_edge < length_segment);
+    if (from_segment)
+    {
+        return static_cast<CoordinateType>(calc_type(a_other) + num / den);
+    }
+    return static_cast<CoordinateType>(calc_type(from) + num_edge / den);
+}
+
+// true if b is the tip of a spike a-b-c running along one of the box edges,
+// i.e. the edge a-b is walked back by b-c; Sutherland–Hodgman leaves these
+// where parts of a ring outside of the box collapse onto its border
+template <typename CoordinateType>
+bool is_border_spike(mapbox::geometry::box<CoordinateType> const& bbox,
+                     mapbox::geometry::point<CoordinateType> const& a,
+                     mapbox::geometry::point<CoordinateType> const& b,
+                     mapbox::geometry::point<CoordinateType> const& c)
+{
+    if (a == c)
+    {
+        return true;
+    }
+    for (CoordinateType const x : {bbox.min.x, bbox.max.x})
+    {
+        if (a.x == x && b.x == x && c.x == x)
+        {
+            return (b.y - a.y > 0) != (c.y - b.y > 0);
+        }
+    }
+    for (CoordinateType const y : {bbox.min.y, bbox.max.y})
+    {
+        if (a.y == y && b.y == y && c.y == y)
+        {
+            return (b.x - a.x > 0) != (c.x - b.x > 0);
+        }
+    }
+    return false;
+}
+
+// removes repeated points and border spikes from an open ring
+template <typename CoordinateType>
+void remove_border_spikes(mapbox::geometry::box<CoordinateType> const& bbox, std::vector<mapbox::geometry::point<CoordinateType>>& ring)
+{
+    std::size_t size = 0; // ring[0, size) is the cleaned up part
+    for (auto const& pt : ring)
+    {
+        if (size > 0 && ring[size - 1] == pt)
+        {
+            continue;
+        }
+        ring[size++] = pt;
+        while (size >= 3 && is_border_spike(bbox, ring[size - 3], ring[size - 2], ring[size - 1]))
+        {
+            ring[size - 2] = ring[size - 1];
+            --size;
+            if (ring[size - 2] == ring[size - 1])
+            {
+                --size;
+            }
+        }
+    }
+    ring.resize(size);
+    // the same around the start of the ring
+    bool changed = true;
+    while (changed && ring.size() >= 3)
+    {
+        changed = false;
+        if (ring.front() == ring.back())
+        {
+            ring.pop_back();
+            changed = true;
+        }
+        else if (is_border_spike(bbox, ring[ring.size() - 2], ring.back(), ring.front()))
+        {
+            ring.pop_back();
+            changed = true;
+        }
+        else if (is_border_spike(bbox, ring.back(), ring.front(), ring[1]))
+        {
+            ring.erase(ring.begin());
+            changed = true;
+        }
+    }
+}
+
+template <typename CoordinateType>
+double signed_area(std::vector<mapbox::geometry::point<CoordinateType>> const& ring)
+{
+    double area = 0.0;
+    mapbox::geometry::point<CoordinateType> const* prev = &ring.back();
+    for (auto const& pt : ring)
+    {
+        area += static_cast<double>(prev->x) * static_cast<double>(pt.y) - static_cast<double>(pt.x) * static_cast<double>(prev->y);
+        prev = &pt;
+    }
+    return area / 2.0;
+}
+
+} // namespace detail
+
+// Cleans up a closed ring lying entirely within the box the way clip_ring
+// does: removes repeated points and spikes and closes the ring. Returns false
+// if nothing with a non-zero area is left. Keeps the winding order.
+template <typename CoordinateType>
+bool normalize_ring(mapbox::geometry::box<CoordinateType> const& bbox,
+                    mapbox::geometry::linear_ring<CoordinateType>& ring)
+{
+    if (!ring.empty() && ring.front() == ring.back())
+    {
+        ring.pop_back();
+    }
+    detail::remove_border_spikes(bbox, ring);
+    if (ring.size() < 3 || std::abs(detail::signed_area(ring)) < 0.5)
+    {
+        return false;
+    }
+    ring.push_back(ring.front());
+    return true;
+}
+
+// Clips a closed ring against an axis-aligned box (Sutherland–Hodgman) and
+// writes the result to `result`, closed, keeping the winding order of `ring`.
+// Parts of the ring outside of the box collapse onto its border; the spikes
+// this leaves along the border are removed. Returns false if nothing with a
+// non-zero area is left.
+//
+// Each vertex keeps track of the segment of `ring` it was reached by, so that
+// the points where the ring crosses the box are computed from the segments
+// of `ring` as boost::geometry does, not from segments already moved by an
+// earlier step.
+//
+// Sutherland–Hodgman never splits a ring, so the result is only exact if the
+// ring enters the box at most once (see clip_polygon below).
+template <typename CoordinateType>
+bool clip_ring(mapbox::geometry::box<CoordinateType> const& bbox,
+               mapbox::geometry::linear_ring<CoordinateType> const& ring,
+               mapbox::geometry::linear_ring<CoordinateType>& result)
+{
+    using point_type = mapbox::geometry::point<CoordinateType>;
+    using vertex_type = traced_point<CoordinateType>;
+    auto buffers = scratch_pool<CoordinateType>::local().vertex_buffers();
+    std::vector<vertex_type>& a = buffers.first;
+    std::vector<vertex_type>& b = buffers.second;
+    std::size_t size = ring.size();
+    if (size > 0 && ring.front() == ring.back())
+    {
+        --size; // clipped as an open ring
+    }
+    // segment i runs from ring[i] to ring[i + 1], wrapping around
+    a.reserve(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        a.push_back({ring[i], i == 0 ? size - 1 : i - 1});
+    }
+    b.reserve(size + 4);
+    auto const segment_start = [&ring](vertex_type const& prev, vertex_type const& pt) {
+        return pt.segment == detail::border_segment ? prev.point : ring[pt.segment];
+    };
+    auto const segment_end = [&ring, size](vertex_type const& pt) {
+        return pt.segment == detail::border_segment ? pt.point : ring[(pt.segment + 1) % size];
+    };
+    // boost::geometry walks the ring backwards and the box edges clockwise,
+    // see detail::crossing
+    auto const crossing = [&](vertex_type const& prev, vertex_type const& pt, CoordinateType c, bool vertical, CoordinateType from, CoordinateType to) {
+        return detail::crossing(segment_end(pt), segment_start(prev, pt), c, vertical, from, to);
+    };
+    detail::clip_ring_by_edge(
+        a, b, [&bbox](point_type const& pt) { return pt.x >= bbox.min.x; },
+        [&](vertex_type const& prev, vertex_type const& pt) {
+            return point_type{bbox.min.x, crossing(prev, pt, bbox.min.x, true, bbox.min.y, bbox.max.y)};
+        });
+    detail::clip_ring_by_edge(
+        b, a, [&bbox](point_type const& pt) { return pt.x <= bbox.max.x; },
+        [&](vertex_type const& prev, vertex_type const& pt) {
+            return point_type{bbox.max.x, crossing(prev, pt, bbox.max.x, true, bbox.max.y, bbox.min.y)};
+        });
+    detail::clip_ring_by_edge(
+        a, b, [&bbox](point_type const& pt) { return pt.y >= bbox.min.y; },
+        [&](vertex_type const& prev, vertex_type const& pt) {
+            return point_type{crossing(prev, pt, bbox.min.y, false, bbox.max.x, bbox.min.x), bbox.min.y};
+        });
+    detail::clip_ring_by_edge(
+        b, a, [&bbox](point_type const& pt) { return pt.y <= bbox.max.y; },
+        [&](vertex_type const& prev, vertex_type const& pt) {
+            return point_type{crossing(prev, pt, bbox.max.y, false, bbox.min.x, bbox.max.x), bbox.max.y};
+        });
+    result.clear();
+    for (auto const& vertex : a)
+    {
+        result.push_back(vertex.point);
+    }
+    return normalize_ring(bbox, result);
+}
+
+// Clips a polygon against an axis-aligned box, appending what is left of it
+// to `result`. Only handles the common cases where the clipped polygon is
+// a single polygon and Sutherland–Hodgman is exact:
+//
+//   - the outer ring enters the box at most once (this includes outer rings
+//     that contain the box, e.g. large landuse or water polygons), and
+//   - every inner ring is either entirely within the interior of the box or
+//     entirely outside of it.
+//
+// Returns false without touching `result` if the polygon is not one of these,
+// so the caller can fall back to boost::geometry::intersection.
+template <typename CoordinateType>
+bool clip_polygon(mapbox::geometry::box<CoordinateType> const& bbox,
+                  mapbox::geometry::polygon<CoordinateType> const& polygon,
+                  std::vector<mapbox::geometry::polygon<CoordinateType>>& result)
+{
+    if (polygon.empty())
+    {
+        return true;
+    }
+    if (detail::count_entries(bbox, polygon.front()) > 1)
+    {
+        return false;
+    }
+    for (std::size_t i = 1; i < polygon.size(); ++i)
+    {
+        auto const extent = mapbox::geometry::envelope(polygon[i]);
+        if (!detail::in_interior(bbox, extent.min) || !detail::in_interior(bbox, extent.max))
+        {
+            if (!detail::disjoint(extent, bbox))
+            {
+                return false;
+            }
+        }
+    }
+    auto& pool = scratch_pool<CoordinateType>::local();
+    mapbox::geometry::linear_ring<CoordinateType> outer = pool.take_ring();
+    if (!clip_ring(bbox, polygon.front(), outer))
+    {
+        pool.recycle(outer);
+        return true;
+    }
+    mapbox::geometry::polygon<CoordinateType> clipped = pool.take_polygon();
+    clipped.push_back(std::move(outer));
+    for (std::size_t i = 1; i < polygon.size(); ++i)
+    {
+        if (!detail::disjoint(mapbox::geometry::envelope(polygon[i]), bbox))
+        {
+            clipped.push_back(pool.take_ring());
+            clipped.back().assign(polygon[i].begin(), polygon[i].end());
+        }
+    }
+    result.push_back(std::move(clipped));
+    return true;
+}
+
+} // namespace vtile
@@ -0,0 +1,694 @@
+#include "codec.hpp"
+// gzip-hpp
+#include <gzip/utils.hpp>
+#include <zlib.h>
+#ifdef VTCOMPOSITE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+#ifdef VTCOMPOSITE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef VTCOMPOSITE_BROTLI
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+#endif
+// stl
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace vtile {
+
+namespace {
+
+// buffers larger than this are freed rather than pooled
+constexpr std::size_t max_pooled_capacity = 4U * 1024U * 1024U;
+constexpr std::size_t max_pooled_buffers = 8;
+
+// same limit as gzip::Decompressor
+constexpr std::size_t max_decompressed_size = 1000000000;
+
+// gzip default level, as used by gzip::compress
+constexpr int default_gzip_level = 6;
+
+std::vector<std::unique_ptr<std::vector<char>>>& buffer_pool()
+{
+    thread_local std::vector<std::unique_ptr<std::vector<char>>> pool;
+    return pool;
+}
+
+// Clears a per-thread buffer, freeing its memory if it grew larger than what
+// we keep around between calls.
+// releases the memory of a buffer of the calling thread that grew larger than
+// the buffers kept between calls
+void trim_buffer(std::string& buffer)
+{
+    if (buffer.capacity() > max_pooled_capacity)
+    {
+        std::string{}.swap(buffer);
+    }
+}
+
+std::string& reset_buffer(std::string& buffer)
+{
+    trim_buffer(buffer);
+    buffer.clear();
+    return buffer;
+}
+
+std::string& local_serialize_buffer()
+{
+    thread_local std::string buffer;
+    return buffer;
+}
+
+#if !defined(VTCOMPOSITE_ZSTD) || !defined(VTCOMPOSITE_BROTLI)
+[[noreturn]] void throw_unsupported(codec c)
+{
+    std::string const name = c == codec::zstd ? "zstd" : "brotli";
+    throw std::runtime_error(name + " compression is not supported by this build");
+}
+#endif
+
+bool is_gzip(unsigned char const* data, std::size_t size)
+{
+    return size >= 18 && data[0] == 0x1F && data[1] == 0x8B;
+}
+
+// The decompressed size of `data`, e.g. as the initial size of the output
+// buffer. Gzip streams end with the size of the uncompressed data (modulo
+// 2^32), which is exact for the tiles we get; it is capped by the best ratio
+// deflate can achieve so that a bogus trailer cannot make us allocate
+// gigabytes.
+std::size_t expected_size(unsigned char const* data, std::size_t size)
+{
+    std::size_t const max_ratio = 1032;
+    if (is_gzip(data, size))
+    {
+        unsigned char const* trailer = data + size - 4;
+        std::size_t const isize = static_cast<std::uint32_t>(trailer[0]) |
+                                  static_cast<std::uint32_t>(trailer[1]) << 8U |
+                                  static_cast<std::uint32_t>(trailer[2]) << 16U |
+                                  static_cast<std::uint32_t>(trailer[3]) << 24U;
+        return std::min(isize, size * max_ratio);
+    }
+    return size * 4;
+}
+
+#ifdef VTCOMPOSITE_LIBDEFLATE
+
+struct decompressor_deleter
+{
+    void operator()(libdeflate_decompressor* decompressor) const
+    {
+        libdeflate_free_decompressor(decompressor);
+    }
+};
+
+struct compressor_deleter
+{
+    void operator()(libdeflate_compressor* compressor) const
+    {
+        libdeflate_free_compressor(compressor);
+    }
+};
+
+libdeflate_decompressor* local_decompressor()
+{
+    thread_local std::unique_ptr<libdeflate_decompressor, decompressor_deleter> decompressor{libdeflate_alloc_decompressor()};
+    if (!decompressor)
+    {
+        throw std::bad_alloc{}; // LCOV_EXCL_LINE
+    }
+    return decompressor.get();
+}
+
+// one compressor per level and thread, allocated on first use
+libdeflate_compressor* local_compressor(int level)
+{
+    thread_local std::array<std::unique_ptr<libdeflate_compressor, compressor_deleter>, 10> compressors;
+    auto& compressor = compressors[static_cast<std::size_t>(level)];
+    if (!compressor)
+    {
+        compressor.reset(libdeflate_alloc_compressor(level));
+        if (!compressor)
+        {
+            throw std::bad_alloc{}; // LCOV_EXCL_LINE
+        }
+    }
+    return compressor.get();
+}
+
+// returns false if libdeflate cannot decode `data` on its own, e.g. gzip
+// streams of several members, of which it only reads the first
+bool libdeflate_decompress(char const* data, std::size_t size, std::vector<char>& output)
+{
+    auto const* bytes = reinterpret_cast<unsigned char const*>(data);
+    bool const gzip = is_gzip(bytes, size);
+    libdeflate_decompressor* decompressor = local_decompressor();
+    output.resize(std::max<std::size_t>(expected_size(bytes, size), 64));
+    while (true)
+    {
+        std::size_t actual_in = 0;
+        std::size_t actual = 0;
+        libdeflate_result const result =
+            gzip ? libdeflate_gzip_decompress_ex(decompressor, data, size, output.data(), output.size(), &actual_in, &actual)
+                 : libdeflate_zlib_decompress_ex(decompressor, data, size, output.data(), output.size(), &actual_in, &actual);
+        if (result == LIBDEFLATE_SUCCESS)
+        {
+            output.resize(actual);
+            return actual_in == size;
+        }
+        if (result != LIBDEFLATE_INSUFFICIENT_SPACE || output.size() >= max_decompressed_size)
+        {
+            return false;
+        }
+        output.resize(std::min(output.size() * 2, max_decompressed_size));
+    }
+}
+
+#endif
+
+struct inflate_stream_deleter
+{
+    void operator()(z_stream* stream) const
+    {
+        inflateEnd(stream);
+        delete stream;
+    }
+};
+
+// The inflate stream of the calling thread, allocated on first use and reset
+// for every tile. Reads both gzip and zlib streams, as gzip::Decompressor
+// does.
+z_stream* local_inflate_stream()
+{
+    thread_local std::unique_ptr<z_stream, inflate_stream_deleter> stream;
+    if (!stream)
+    {
+        std::unique_ptr<z_stream> fresh{new z_stream{}};
+        if (inflateInit2(fresh.get(), 32 + MAX_WBITS) != Z_OK)
+        {
+            throw std::bad_alloc{}; // LCOV_EXCL_LINE
+        }
+        stream.reset(fresh.release());
+    }
+    else if (inflateReset(stream.get()) != Z_OK)
+    {
+        throw std::runtime_error("inflate init failed"); // LCOV_EXCL_LINE
+    }
+    return stream.get();
+}
+
+// Inflates `data` with zlib. Unlike gzip::Decompressor, which stops after the
+// first member, gzip streams of several members are read to the end and their
+// contents concatenated, as gunzip does. Truncated streams yield what could
+// be read, as with gzip::Decompressor.
+void zlib_decompress(char const* data, std::size_t size, std::vector<char>& output)
+{
+    z_stream* stream = local_inflate_stream();
+    auto const* bytes = reinterpret_cast<unsigned char const*>(data);
+    stream->next_in = const_cast<Bytef*>(bytes); // NOLINT
+    stream->avail_in = static_cast<uInt>(size);
+    output.resize(std::max<std::size_t>(expected_size(bytes, size), 64));
+    std::size_t written = 0;
+    while (true)
+    {
+        if (written == output.size())
+        {
+            if (output.size() >= max_decompressed_size)
+            {
+                throw std::runtime_error("size of output string will use more memory then intended when decompressing");
+            }
+            output.resize(std::min(output.size() * 2, max_decompressed_size));
+        }
+        stream->next_out = reinterpret_cast<Bytef*>(output.data() + written);
+        stream->avail_out = static_cast<uInt>(output.size() - written);
+        int const result = inflate(stream, Z_NO_FLUSH);
+        written = output.size() - stream->avail_out;
+        if (result == Z_STREAM_END)
+        {
+            // the next member, if any
+            if (!is_gzip(stream->next_in, stream->avail_in))
+            {
+                break;
+            }
+            if (inflateReset(stream) != Z_OK)
+            {
+                throw std::runtime_error("inflate init failed"); // LCOV_EXCL_LINE
+            }
+        }
+        else if (result == Z_BUF_ERROR && stream->avail_out > 0)
+        {
+            break; // truncated
+        }
+        else if (result != Z_OK && result != Z_BUF_ERROR)
+        {
+            throw std::runtime_error(stream->msg != nullptr ? stream->msg : "invalid gzip compressed tile");
+        }
+    }
+    output.resize(written);
+}
+
+void gzip_decompress(char const* data, std::size_t size, std::vector<char>& output)
+{
+#ifdef VTCOMPOSITE_LIBDEFLATE
+    if (libdeflate_decompress(data, size, output))
+    {
+        return;
+    }
+#endif
+    zlib_decompress(data, size, output);
+}
+
+#ifndef VTCOMPOSITE_LIBDEFLATE
+
+struct deflate_stream_deleter
+{
+    void operator()(z_stream* stream) const
+    {
+        deflateEnd(stream);
+        delete stream;
+    }
+};
+
+// One deflate stream per level and thread, allocated on first use and reset
+// for every tile: initializing a stream allocates about 256KB. Same settings
+// as gzip::Compressor, so the output is the same.
+z_stream* local_deflate_stream(int level)
+{
+    thread_local std::array<std::unique_ptr<z_stream, deflate_stream_deleter>, 10> streams;
+    auto& stream = streams[static_cast<std::size_t>(level)];
+    if (!stream)
+    {
+        std::unique_ptr<z_stream> fresh{new z_stream{}};
+        if (deflateInit2(fresh.get(), level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            throw std::bad_alloc{}; // LCOV_EXCL_LINE
+        }
+        stream.reset(fresh.release());
+    }
+    else if (deflateReset(stream.get()) != Z_OK)
+    {
+        throw std::runtime_error("gzip compression failed"); // LCOV_EXCL_LINE
+    }
+    return stream.get();
+}
+
+#endif
+
+void gzip_compress(int level, char const* data, std::size_t size, std::string& output)
+{
+#ifdef VTCOMPOSITE_LIBDEFLATE
+    libdeflate_compressor* compressor = local_compressor(level);
+    output.resize(libdeflate_gzip_compress_bound(compressor, size));
+    std::size_t const compressed = libdeflate_gzip_compress(compressor, data, size, &output[0], output.size());
+    if (compressed == 0)
+    {
+        throw std::runtime_error("gzip compression failed"); // LCOV_EXCL_LINE
+    }
+    output.resize(compressed);
+#else
+    // a single deflate call into an output sized by deflateBound
+    z_stream* stream = local_deflate_stream(level);
+    output.resize(deflateBound(stream, static_cast<uLong>(size)));
+    stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data)); // NOLINT
+    stream->avail_in = static_cast<uInt>(size);
+    stream->next_out = reinterpret_cast<Bytef*>(&output[0]);
+    stream->avail_out = static_cast<uInt>(output.size());
+    if (deflate(stream, Z_FINISH) != Z_STREAM_END)
+    {
+        throw std::runtime_error("gzip compression failed"); // LCOV_EXCL_LINE
+    }
+    output.resize(output.size() - stream->avail_out);
+#endif
+}
+
+#ifdef VTCOMPOSITE_ZSTD
+
+struct zstd_dctx_deleter
+{
+    void operator()(ZSTD_DCtx* context) const
+    {
+        ZSTD_freeDCtx(context);
+    }
+};
+
+struct zstd_cctx_deleter
+{
+    void operator()(ZSTD_CCtx* context) const
+    {
+        ZSTD_freeCCtx(context);
+    }
+};
+
+void zstd_decompress(char const* data, std::size_t size, std::vector<char>& output)
+{
+    thread_local std::unique_ptr<ZSTD_DCtx, zstd_dctx_deleter> context{ZSTD_createDCtx()};
+    if (!context)
+    {
+        throw std::bad_alloc{}; // LCOV_EXCL_LINE
+    }
+    unsigned long long const content_size = ZSTD_getFrameContentSize(data, size);
+    if (content_size == ZSTD_CONTENTSIZE_ERROR)
+    {
+        throw std::runtime_error("invalid zstd compressed tile");
+    }
+    if (content_size != ZSTD_CONTENTSIZE_UNKNOWN && content_size <= max_decompressed_size)
+    {
+        // single-shot, the common case as ZSTD_compress records the size
+        output.resize(static_cast<std::size_t>(content_size));
+        std::size_t const result = ZSTD_decompressDCtx(context.get(), output.data(), output.size(), data, size);
+        if (ZSTD_isError(result) == 0U)
+        {
+            output.resize(result);
+            return;
+        }
+    }
+    // streaming, for frames without a content size or with several frames
+    ZSTD_DCtx_reset(context.get(), ZSTD_reset_session_only);
+    output.resize(std::max<std::size_t>(size * 4, ZSTD_DStreamOutSize()));
+    ZSTD_inBuffer in{data, size, 0};
+    std::size_t written = 0;
+    while (true)
+    {
+        if (written == output.size())
+        {
+            if (output.size() >= max_decompressed_size)
+            {
+                throw std::runtime_error("size of output string will use more memory then intended when decompressing");
+            }
+            output.resize(std::min(output.size() * 2, max_decompressed_size));
+        }
+        ZSTD_outBuffer out{output.data(), output.size(), written};
+        std::size_t const result = ZSTD_decompressStream(context.get(), &out, &in);
+        if (ZSTD_isError(result) != 0U)
+        {
+            throw std::runtime_error(std::string{"invalid zstd compressed tile: "} + ZSTD_getErrorName(result));
+        }
+        written = out.pos;
+        // all input read, and all output flushed since there is room left
+        if (in.pos == in.size && written < output.size())
+        {
+            if (result != 0)
+            {
+                throw std::runtime_error("truncated zstd compressed tile");
+            }
+            break;
+        }
+    }
+    output.resize(written);
+}
+
+void zstd_compress(int level, char const* data, std::size_t size, std::string& output)
+{
+    thread_local std::unique_ptr<ZSTD_CCtx, zstd_cctx_deleter> context{ZSTD_createCCtx()};
+    if (!context)
+    {
+        throw std::bad_alloc{}; // LCOV_EXCL_LINE
+    }
+    output.resize(ZSTD_compressBound(size));
+    std::size_t const result = ZSTD_compressCCtx(context.get(), &output[0], output.size(), data, size, level);
+    if (ZSTD_isError(result) != 0U)
+    {
+        throw std::runtime_error(std::string{"zstd compression failed: "} + ZSTD_getErrorName(result)); // LCOV_EXCL_LINE
+    }
+    output.resize(result);
+}
+
+#endif
+
+#ifdef VTCOMPOSITE_BROTLI
+
+struct brotli_decoder_deleter
+{
+    void operator()(BrotliDecoderState* state) const
+    {
+        BrotliDecoderDestroyInstance(state);
+    }
+};
+
+// returns false if `data` is not a valid brotli stream of a vector tile
+bool brotli_decompress(char const* data, std::size_t size, std::vector<char>& output)
+{
+    std::unique_ptr<BrotliDecoderState, brotli_decoder_deleter> state{BrotliDecoderCreateInstance(nullptr, nullptr, nullptr)};
+    if (!state)
+    {
+        throw std::bad_alloc{}; // LCOV_EXCL_LINE
+    }
+    output.resize(size * 4);
+    std::size_t available_in = size;
+    auto const* next_in = reinterpret_cast<std::uint8_t const*>(data);
+    std::size_t written = 0;
+    while (true)
+    {
+        std::size_t available_out = output.size() - written;
+        auto* next_out = reinterpret_cast<std::uint8_t*>(output.data()) + written;
+        BrotliDecoderResult const result = BrotliDecoderDecompressStream(state.get(), &available_in, &next_in, &available_out, &next_out, nullptr);
+        written = output.size() - available_out;
+        if (result == BROTLI_DECODER_RESULT_SUCCESS)
+        {
+            output.resize(written);
+            // a whole stream, of a tile: what else decodes (e.g. the single
+            // byte 0x06, an empty stream) is not taken for brotli
+            return available_in == 0 && written > 0 && output.front() == 0x1A;
+        }
+        if (result != BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT)
+        {
+            return false;
+        }
+        if (output.size() >= max_decompressed_size)
+        {
+            throw std::runtime_error("size of output string will use more memory then intended when decompressing");
+        }
+        output.resize(std::min(output.size() * 2, max_decompressed_size));
+    }
+}
+
+void brotli_compress(int level, char const* data, std::size_t size, std::string& output)
+{
+    std::size_t encoded_size = BrotliEncoderMaxCompressedSize(size);
+    output.resize(encoded_size);
+    if (BrotliEncoderCompress(level, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC, size,
+                              reinterpret_cast<std::uint8_t const*>(data), &encoded_size,
+                              reinterpret_cast<std::uint8_t*>(&output[0])) == BROTLI_FALSE)
+    {
+        throw std::runtime_error("brotli compression failed"); // LCOV_EXCL_LINE
+    }
+    output.resize(encoded_size);
+}
+
+#endif
+
+} // namespace
+
+bool parse_codec(std::string const& name, codec& result)
+{
+    if (name == "gzip")
+    {
+        result = codec::gzip;
+        return true;
+    }
+    if (name == "zstd")
+    {
+        result = codec::zstd;
+        return true;
+    }
+    if (name == "br")
+    {
+        result = codec::brotli;
+        return true;
+    }
+    return false;
+}
+
+bool codec_supported(codec c)
+{
+    switch (c)
+    {
+    case codec::zstd:
+#ifdef VTCOMPOSITE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    case codec::brotli:
+#ifdef VTCOMPOSITE_BROTLI
+        return true;
+#else
+        return false;
+#endif
+    default:
+        return true;
+    }
+}
+
+int max_level(codec c)
+{
+    switch (c)
+    {
+    case codec::zstd:
+        return 22;
+    case codec::brotli:
+        return 11;
+    default:
+        return 9;
+    }
+}
+
+codec detect_codec(char const* data, std::size_t size)
+{
+    if (gzip::is_compressed(data, size))
+    {
+        return codec::gzip;
+    }
+    auto const* bytes = reinterpret_cast<unsigned char const*>(data);
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xB5 && bytes[2] == 0x2F && bytes[3] == 0xFD)
+    {
+        return codec::zstd;
+    }
+#ifdef VTCOMPOSITE_BROTLI
+    // 0x1A: field 3 (layers), length-delimited
+    if (size > 0 && bytes[0] != 0x1A)
+    {
+        return codec::brotli;
+    }
+#endif
+    return codec::none;
+}
+
+std::size_t decompressed_size(codec c, char const* data, std::size_t size)
+{
+    switch (c)
+    {
+    case codec::none:
+        return size;
+    case codec::gzip:
+        return expected_size(reinterpret_cast<unsigned char const*>(data), size);
+    case codec::zstd:
+#ifdef VTCOMPOSITE_ZSTD
+    {
+        unsigned long long const content_size = ZSTD_getFrameContentSize(data, size);
+        if (content_size != ZSTD_CONTENTSIZE_UNKNOWN && content_size != ZSTD_CONTENTSIZE_ERROR && content_size <= max_decompressed_size)
+        {
+            return static_cast<std::size_t>(content_size);
+        }
+    }
+#endif
+        break;
+    default:
+        break;
+    }
+    return size * 4;
+}
+
+bool decompress(codec c, char const* data, std::size_t size, std::vector<char>& output)
+{
+    switch (c)
+    {
+    case codec::gzip:
+        gzip_decompress(data, size, output);
+        return true;
+    case codec::zstd:
+#ifdef VTCOMPOSITE_ZSTD
+        zstd_decompress(data, size, output);
+        return true;
+#else
+        throw_unsupported(c);
+#endif
+    case codec::brotli:
+#ifdef VTCOMPOSITE_BROTLI
+        // detect_codec can only guess brotli
+        if (!brotli_decompress(data, size, output))
+        {
+            output.clear();
+            return false;
+        }
+        return true;
+#else
+        throw_unsupported(c);
+#endif
+    default:
+        output.assign(data, data + size);
+        return true;
+    }
+}
+
+bool compress(compression_options const& options, char const* data, std::size_t size, std::string& output)
+{
+    output.clear();
+    // Empty tiles are never compressed: that would lead to a non-zero byte
+    // string which can be perceived as a valid vector tile.
+    if (options.codec == codec::none || size == 0 || size < options.min_bytes)
+    {
+        return false;
+    }
+    // each codec sizes the per-thread buffer by its bound, compresses into it
+    // with a single call and shrinks it to the compressed size; only the
+    // compressed bytes are copied to `output`, which is handed over to JS
+    // and would otherwise keep the capacity of the bound
+    thread_local std::string buffer;
+    std::string& compressed = reset_buffer(buffer);
+    switch (options.codec)
+    {
+    case codec::zstd:
+#ifdef VTCOMPOSITE_ZSTD
+        zstd_compress(options.level < 0 ? ZSTD_CLEVEL_DEFAULT : options.level, data, size, compressed);
+        break;
+#else
+        throw_unsupported(options.codec);
+#endif
+    case codec::brotli:
+#ifdef VTCOMPOSITE_BROTLI
+        brotli_compress(options.level < 0 ? BROTLI_DEFAULT_QUALITY : options.level, data, size, compressed);
+        break;
+#else
+        throw_unsupported(options.codec);
+#endif
+    default:
+        gzip_compress(options.level < 0 ? default_gzip_level : options.level, data, size, compressed);
+        break;
+    }
+    // a string of the compressed size, even if `output` had a larger capacity
+    std::string{compressed}.swap(output);
+    trim_buffer(compressed);
+    return true;
+}
+
+void buffer_releaser::operator()(std::vector<char>* buffer) const
+{
+    std::unique_ptr<std::vector<char>> owned{buffer};
+    auto& pool = buffer_pool();
+    if (owned->capacity() <= max_pooled_capacity && pool.size() < max_pooled_buffers)
+    {
+        owned->clear();
+        pool.push_back(std::move(owned));
+    }
+}
+
+pooled_buffer take_buffer()
+{
+    auto& pool = buffer_pool();
+    if (pool.empty())
+    {
+        return pooled_buffer{new std::vector<char>()};
+    }
+    pooled_buffer buffer{pool.back().release()};
+    pool.pop_back();
+    return buffer;
+}
+
+std::string& serialize_buffer()
+{
+    return reset_buffer(local_serialize_buffer());
+}
+
+void release_serialize_buffer()
+{
+    trim_buffer(local_serialize_buffer());
+}
+
+} // namespace vtile
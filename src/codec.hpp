@@ -0,0 +1,102 @@
+#pragma once
+
+// stl
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vtile {
+
+// Compression of tiles.
+//
+// Gzip is always available, through zlib (gzip-hpp) or, in builds with
+// `--libdeflate=true` (`LIBDEFLATE=true make`), through libdeflate, which
+// inflates and deflates whole buffers at once and is considerably faster.
+// Either way the output is a standard gzip stream, and anything zlib can read
+// is accepted as input: what libdeflate does not handle in one go (e.g.
+// concatenated gzip members) is handed to zlib.
+//
+// Zstandard and brotli are available in builds with `--zstd=true` and
+// `--brotli=true` (`ZSTD=true`, `BROTLI=true make`).
+enum class codec : std::uint8_t
+{
+    none,
+    gzip,
+    zstd,
+    brotli
+};
+
+// Output compression requested from composite or localize.
+struct compression_options
+{
+    vtile::codec codec = codec::none;
+    int level = -1; // the default level of the codec if negative
+    // serialized tiles smaller than this are returned uncompressed, as they
+    // would hardly shrink
+    std::size_t min_bytes = 0;
+};
+
+// Parses the name of a codec as used in the options: "gzip", "zstd" or "br".
+bool parse_codec(std::string const& name, codec& result);
+
+// True if this build can compress and decompress with `c`.
+bool codec_supported(codec c);
+
+// The highest compression level of `c` (the lowest is 0 for brotli and 1
+// otherwise).
+int max_level(codec c);
+
+// Detects how a source tile is compressed from its first bytes: the gzip and
+// zlib headers and the zstd frame magic number. Brotli streams have no magic
+// number, so in builds with brotli anything else that does not start like a
+// vector tile (with a layer, field 3) is a brotli candidate, only taken for
+// brotli by decompress if it decodes to a vector tile.
+codec detect_codec(char const* data, std::size_t size);
+
+// The size of `data`, compressed with `c`, once decompressed: exact for
+// gzip streams of up to 4 GiB and zstd frames that record it, otherwise an
+// estimate from a typical compression ratio.
+std::size_t decompressed_size(codec c, char const* data, std::size_t size);
+
+// Decompresses `data`, compressed with `c`, into `output`, replacing its
+// contents. Throws std::runtime_error on invalid data or a codec this build
+// does not support. Returns false, leaving `output` empty, if `c` is brotli
+// and `data` does not decode to a vector tile: detect_codec only guesses
+// brotli, and such data is to be read as an uncompressed tile, as in builds
+// without brotli.
+bool decompress(codec c, char const* data, std::size_t size, std::vector<char>& output);
+
+// Compresses `data` as requested by `options` into `output`, replacing its
+// contents with exactly the compressed bytes: codecs compress into a buffer
+// of the calling thread sized by their bound, so that `output` only takes the
+// memory of the compressed tile. Leaves `output` empty and returns false if
+// `data` is to be returned uncompressed (empty, or smaller than
+// options.min_bytes).
+bool compress(compression_options const& options, char const* data, std::size_t size, std::string& output);
+
+// Returns buffers to a small per-thread pool instead of freeing them.
+struct buffer_releaser
+{
+    void operator()(std::vector<char>* buffer) const;
+};
+
+using pooled_buffer = std::unique_ptr<std::vector<char>, buffer_releaser>;
+
+// An empty buffer for a decompressed tile, reusing the memory of a buffer
+// released earlier on the calling thread where possible.
+pooled_buffer take_buffer();
+
+// A buffer of the calling thread to serialize a tile into before compressing
+// it. Only valid until the next call on the same thread, or until
+// release_serialize_buffer().
+std::string& serialize_buffer();
+
+// Releases the memory of the buffer of serialize_buffer() once the tile in it
+// is compressed, unless it is small enough to be kept for the next call, so
+// that threads do not hold on to the largest tile they serialized outside of
+// the memory budget.
+void release_serialize_buffer();
+
+} // namespace vtile
@@ -0,0 +1,359 @@
+#pragma once
+
+#include "feature_builder.hpp"
+// vtzero
+#include <vtzero/builder.hpp>
+#include <vtzero/types.hpp>
+#include <vtzero/vector_tile.hpp>
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vtile {
+
+// How composite drops features from tiles larger than its `max_bytes` option.
+struct drop_options
+{
+    std::size_t max_bytes = 0; // no limit if 0
+    // features of layers with a lower priority are dropped first; unlisted
+    // layers have priority 0
+    std::unordered_map<std::string, double> layer_priority{};
+    // then features with a higher numeric value of this property, before
+    // those without it
+    std::string rank_property{"filterrank"};
+};
+
+// the features dropped from a layer of the output tile
+struct dropped_layer
+{
+    std::string name{};
+    std::uint64_t features = 0;
+    std::uint64_t vertices = 0; // counted if asked for
+};
+
+namespace detail {
+
+inline std::size_t varint_size(std::uint64_t value)
+{
+    std::size_t size = 1;
+    while (value >= 0x80U)
+    {
+        value >>= 7U;
+        ++size;
+    }
+    return size;
+}
+
+// the size of a length-delimited field holding `size` bytes
+inline std::size_t field_size(std::size_t size)
+{
+    return 1 + varint_size(size) + size;
+}
+
+// A feature that may be dropped, in the order features are dropped.
+struct drop_candidate
+{
+    double layer_priority;
+    double rank;               // -infinity without the rank property
+    std::size_t geometry_size; // bytes of encoded geometry
+    std::size_t layer;         // index in the tile
+    std::size_t feature;       // index in the layer
+    std::size_t size;          // encoded size in the layer
+
+    bool operator<(drop_candidate const& other) const
+    {
+        // lower layer priority, higher rank, smaller geometry, later in
+        // the tile first
+        return std::make_tuple(layer_priority, -rank, geometry_size, other.layer, other.feature) <
+               std::make_tuple(other.layer_priority, -other.rank, other.geometry_size, layer, feature);
+    }
+};
+
+// the numeric value of `value`, or false if it is not a number (or NaN)
+inline bool numeric_value(vtzero::property_value const& value, double& result)
+{
+    switch (value.type())
+    {
+    case vtzero::property_value_type::float_value:
+        if (std::isnan(value.float_value()))
+        {
+            return false;
+        }
+        result = static_cast<double>(value.float_value());
+        return true;
+    case vtzero::property_value_type::double_value:
+        if (std::isnan(value.double_value()))
+        {
+            return false;
+        }
+        result = value.double_value();
+        return true;
+    case vtzero::property_value_type::int_value:
+        result = static_cast<double>(value.int_value());
+        return true;
+    case vtzero::property_value_type::uint_value:
+        result = static_cast<double>(value.uint_value());
+        return true;
+    case vtzero::property_value_type::sint_value:
+        result = static_cast<double>(value.sint_value());
+        return true;
+    default:
+        return false;
+    }
+}
+
+// the number of points of `feature`, 0 if its geometry is malformed
+inline std::uint64_t safe_count_vertices(vtzero::feature const& feature)
+{
+    try
+    {
+        return count_vertices(feature);
+    }
+    catch (vtzero::geometry_exception const& /*unused*/)
+    {
+        return 0;
+    }
+}
+
+} // namespace detail
+
+// The size of `feature` encoded in its layer, as vtzero writes it: the
+// feature message with its id, tags, type and geometry fields.
+inline std::size_t encoded_feature_size(vtzero::feature const& feature)
+{
+    std::size_t size = 2; // type
+    if (feature.has_id())
+    {
+        size += 1 + detail::varint_size(feature.id());
+    }
+    std::size_t tags = 0;
+    feature.for_each_property_indexes([&tags](vtzero::index_value_pair const& pair) {
+        tags += detail::varint_size(pair.key().value()) + detail::varint_size(pair.value().value());
+        return true;
+    });
+    if (tags > 0)
+    {
+        size += detail::field_size(tags);
+    }
+    size += detail::field_size(feature.geometry().data().size());
+    return detail::field_size(size);
+}
+
+// Collects the layers of an output tile limited to options.max_bytes, so
+// that the features to drop are left out before the layers are added to the
+// tile builder (see add_to). Features are ranked across all layers, so all of
+// them have to be known before any is dropped; the layers are held as views
+// into the data they were read from or, for layers built here, as
+// single-layer tiles owned by this object.
+class capped_tile
+{
+  public:
+    explicit capped_tile(drop_options const& options)
+        : options_{options} {}
+
+    // a layer whose data outlives this object
+    void add_existing_layer(vtzero::layer const& layer)
+    {
+        layers_.push_back(layer);
+        size_ += detail::field_size(layer.data().size());
+    }
+
+    // the layers `build` adds to the vtzero::tile_builder it is called with
+    template <typename Build>
+    void build_layers(Build&& build)
+    {
+        vtzero::tile_builder builder;
+        std::forward<Build>(build)(builder);
+        add_built(builder);
+    }
+
+    // the size of the tile with all layers
+    std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    // Adds the layers to `builder` without the features to drop, in the
+    // order of drop_options, so that the tile fits in options.max_bytes.
+    // Features are only dropped until the tile fits: each dropped feature
+    // shrinks the tile by at least its encoded size, since kept features and
+    // the key and value tables of their layers are copied as they are. Layers
+    // left without features are left out. Returns the features dropped from
+    // each layer that lost any, counting their vertices if
+    // `count_dropped_vertices` is set; `bytes_dropped` is set to how much
+    // smaller the tile is.
+    std::vector<dropped_layer> add_to(vtzero::tile_builder& builder, bool count_dropped_vertices, std::uint64_t& bytes_dropped)
+    {
+        bytes_dropped = 0;
+        if (size_ <= options_.max_bytes)
+        {
+            for (auto const& layer : layers_)
+            {
+                builder.add_existing_layer(layer);
+            }
+            return {};
+        }
+        std::vector<std::vector<bool>> const drop = plan();
+        std::vector<dropped_layer> result;
+        std::size_t const size = size_;
+        for (std::size_t l = 0; l < layers_.size(); ++l)
+        {
+            vtzero::layer& layer = layers_[l];
+            auto const& dropped = drop[l];
+            if (dropped.empty())
+            {
+                builder.add_existing_layer(layer);
+                continue;
+            }
+            size_ -= detail::field_size(layer.data().size());
+            result.push_back(drop_from(layer, dropped, count_dropped_vertices));
+            if (result.back().features < dropped.size())
+            {
+                // the rewritten layer, at its actual size
+                builder.add_existing_layer(layers_[l]);
+                size_ += detail::field_size(layers_[l].data().size());
+            }
+        }
+        bytes_dropped = size - size_;
+        return result;
+    }
+
+  private:
+    void add_built(vtzero::tile_builder& builder)
+    {
+        data_.emplace_back();
+        builder.serialize(data_.back());
+        vtzero::vector_tile tile{data_.back()};
+        while (auto layer = tile.next_layer())
+        {
+            add_existing_layer(layer);
+        }
+    }
+
+    // by layer, the features to drop
+    std::vector<std::vector<bool>> plan()
+    {
+        std::vector<detail::drop_candidate> candidates;
+        for (std::size_t l = 0; l < layers_.size(); ++l)
+        {
+            vtzero::layer& layer = layers_[l];
+            auto const priority = options_.layer_priority.find(std::string(layer.name()));
+            double const layer_priority = priority == options_.layer_priority.end() ? 0.0 : priority->second;
+            auto const& keys = layer.key_table();
+            auto const rank_key = std::find_if(keys.begin(), keys.end(), [this](vtzero::data_view const& key) {
+                return options_.rank_property == key;
+            });
+            layer.reset_feature();
+            std::size_t f = 0;
+            while (auto feature = layer.next_feature())
+            {
+                double rank = -std::numeric_limits<double>::infinity();
+                if (rank_key != keys.end())
+                {
+                    auto const rank_index = static_cast<std::uint32_t>(std::distance(keys.begin(), rank_key));
+                    feature.for_each_property_indexes([&](vtzero::index_value_pair const& pair) {
+                        if (pair.key().value() != rank_index)
+                        {
+                            return true;
+                        }
+                        detail::numeric_value(layer.value(pair.value()), rank);
+                        return false;
+                    });
+                }
+                candidates.push_back({layer_priority, rank, feature.geometry().data().size(), l, f++, encoded_feature_size(feature)});
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        std::vector<std::vector<bool>> drop(layers_.size());
+        std::size_t size = size_;
+        for (auto const& candidate : candidates)
+        {
+            if (size <= options_.max_bytes)
+            {
+                break;
+            }
+            auto& dropped = drop[candidate.layer];
+            if (dropped.empty())
+            {
+                dropped.resize(layers_[candidate.layer].num_features());
+            }
+            dropped[candidate.feature] = true;
+            size -= std::min(size, candidate.size);
+        }
+        return drop;
+    }
+
+    // rewrites `layer` without the `dropped` features into a single-layer
+    // tile owned by this object, unless it loses all of them, and points
+    // `layer` at the rewritten one
+    dropped_layer drop_from(vtzero::layer& layer, std::vector<bool> const& dropped, bool count_dropped_vertices)
+    {
+        dropped_layer counts{std::string(layer.name()), 0, 0};
+        counts.features = static_cast<std::uint64_t>(std::count(dropped.begin(), dropped.end(), true));
+        if (counts.features == dropped.size())
+        {
+            if (count_dropped_vertices)
+            {
+                layer.reset_feature();
+                while (auto feature = layer.next_feature())
+                {
+                    counts.vertices += detail::safe_count_vertices(feature);
+                }
+            }
+            return counts;
+        }
+        vtzero::tile_builder builder;
+        {
+            vtzero::layer_builder lbuilder{builder, layer.name(), layer.version(), layer.extent()};
+            for (auto const& key : layer.key_table())
+            {
+                lbuilder.add_key_without_dup_check(key);
+            }
+            for (auto const& value : layer.value_table())
+            {
+                lbuilder.add_value_without_dup_check(value);
+            }
+            layer.reset_feature();
+            std::size_t f = 0;
+            while (auto feature = layer.next_feature())
+            {
+                if (dropped[f++])
+                {
+                    if (count_dropped_vertices)
+                    {
+                        counts.vertices += detail::safe_count_vertices(feature);
+                    }
+                    continue;
+                }
+                vtzero::geometry_feature_builder fbuilder{lbuilder};
+                fbuilder.copy_id(feature);
+                fbuilder.set_geometry(feature.geometry());
+                feature.for_each_property_indexes([&fbuilder](vtzero::index_value_pair const& pair) {
+                    fbuilder.add_property(pair);
+                    return true;
+                });
+                fbuilder.commit();
+            }
+        }
+        data_.emplace_back();
+        builder.serialize(data_.back());
+        layer = vtzero::vector_tile{data_.back()}.next_layer();
+        return counts;
+    }
+
+    drop_options const& options_;
+    std::vector<vtzero::layer> layers_{};
+    std::deque<std::string> data_{}; // layers built here; a deque, so that views stay valid
+    std::size_t size_ = 0;
+};
+
+} // namespace vtile
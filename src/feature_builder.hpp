@@ -1,5 +1,8 @@
 #pragma once
 
+#include "clip.hpp"
+#include "scratch.hpp"
+#include "stats.hpp"
 // geometry.hpp
 #include <mapbox/geometry.hpp>
 #include <mapbox/geometry/algorithms/detail/boost_adapters.hpp>
@@ -9,10 +12,18 @@
 // boost
 #include <boost/geometry/algorithms/intersection.hpp>
 #include <boost/geometry/algorithms/intersects.hpp>
+#include <boost/geometry/geometries/register/point.hpp>
 // stl
 #include <algorithm>
-//BOOST_GEOMETRY_REGISTER_POINT_2D(mapbox::geometry::point<int>, int, boost::geometry::cs::cartesian, x, y)
-// ^ Uncomment to enable coordinate_type = int ^
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// coordinate_type = std::int64_t is registered by boost_adapters.hpp
+BOOST_GEOMETRY_REGISTER_POINT_2D(mapbox::geometry::point<std::int32_t>, std::int32_t, boost::geometry::cs::cartesian, x, y)
 
 namespace vtile {
 namespace detail {
@@ -36,8 +47,8 @@ struct point_handler
 
     void points_point(vtzero::point const& pt)
     {
-        CoordinateType x = pt.x * static_cast<std::int32_t>(zoom_factor_) - static_cast<std::int32_t>(dx_);
-        CoordinateType y = pt.y * static_cast<std::int32_t>(zoom_factor_) - static_cast<std::int32_t>(dy_);
+        CoordinateType x = static_cast<CoordinateType>(pt.x) * static_cast<CoordinateType>(zoom_factor_) - static_cast<CoordinateType>(dx_);
+        CoordinateType y = static_cast<CoordinateType>(pt.y) * static_cast<CoordinateType>(zoom_factor_) - static_cast<CoordinateType>(dy_);
         mapbox::geometry::point<CoordinateType> pt0{x, y};
         if (boost::geometry::covered_by(pt0, bbox_))
         {
@@ -57,7 +68,7 @@ struct point_handler
 template <typename CoordinateType>
 struct line_string_handler
 {
-    using geom_type = mapbox::geometry::multi_line_string<CoordinateType>;
+    using geom_type = std::vector<mapbox::geometry::line_string<CoordinateType>>;
 
     line_string_handler(geom_type& geom, std::uint32_t dx, std::uint32_t dy, std::uint32_t zoom_factor)
         : geom_(geom),
@@ -70,7 +81,7 @@ struct line_string_handler
     void linestring_begin(std::uint32_t count)
     {
         first_ = true;
-        geom_.emplace_back();
+        geom_.push_back(pool_.take_line());
         geom_.back().reserve(count);
     }
 
@@ -78,8 +89,8 @@ struct line_string_handler
     {
         if (first_ || pt.x != cur_x_ || pt.y != cur_y_)
         {
-            CoordinateType x = pt.x * static_cast<std::int32_t>(zoom_factor_) - static_cast<std::int32_t>(dx_);
-            CoordinateType y = pt.y * static_cast<std::int32_t>(zoom_factor_) - static_cast<std::int32_t>(dy_);
+            CoordinateType x = static_cast<CoordinateType>(pt.x) * static_cast<CoordinateType>(zoom_factor_) - static_cast<CoordinateType>(dx_);
+            CoordinateType y = static_cast<CoordinateType>(pt.y) * static_cast<CoordinateType>(zoom_factor_) - static_cast<CoordinateType>(dy_);
             geom_.back().emplace_back(x, y);
             cur_x_ = pt.x;
             cur_y_ = pt.y;
@@ -90,6 +101,56 @@ struct line_string_handler
     void linestring_end() {}
 
     geom_type& geom_;
+    scratch_pool<CoordinateType>& pool_ = scratch_pool<CoordinateType>::local();
+    std::uint32_t const dx_;
+    std::uint32_t const dy_;
+    std::uint32_t const zoom_factor_;
+    CoordinateType cur_x_ = 0;
+    CoordinateType cur_y_ = 0;
+    bool first_ = true;
+};
+
+// Like line_string_handler, but clips the linestrings against `bbox` while
+// decoding them instead of storing them.
+template <typename CoordinateType>
+struct clipping_line_string_handler
+{
+    using geom_type = std::vector<mapbox::geometry::line_string<CoordinateType>>;
+
+    clipping_line_string_handler(geom_type& geom, mapbox::geometry::box<CoordinateType> const& bbox,
+                                 std::uint32_t dx, std::uint32_t dy, std::uint32_t zoom_factor)
+        : clipper_(bbox, geom),
+          dx_(dx),
+          dy_(dy),
+          zoom_factor_(zoom_factor)
+    {
+    }
+
+    void linestring_begin(std::uint32_t /*unused*/)
+    {
+        first_ = true;
+        clipper_.begin();
+    }
+
+    void linestring_point(vtzero::point const& pt)
+    {
+        if (first_ || pt.x != cur_x_ || pt.y != cur_y_)
+        {
+            CoordinateType x = static_cast<CoordinateType>(pt.x) * static_cast<CoordinateType>(zoom_factor_) - static_cast<CoordinateType>(dx_);
+            CoordinateType y = static_cast<CoordinateType>(pt.y) * static_cast<CoordinateType>(zoom_factor_) - static_cast<CoordinateType>(dy_);
+            clipper_.add({x, y});
+            cur_x_ = pt.x;
+            cur_y_ = pt.y;
+            first_ = false;
+        }
+    }
+
+    void linestring_end()
+    {
+        clipper_.end();
+    }
+
+    linestring_clipper<CoordinateType> clipper_;
     std::uint32_t const dx_;
     std::uint32_t const dy_;
     std::uint32_t const zoom_factor_;
@@ -114,7 +175,7 @@ struct polygon_handler
     void ring_begin(std::uint32_t count)
     {
         first_ = true;
-        geom_.emplace_back();
+        geom_.emplace_back(pool_.take_ring(), vtzero::ring_type::invalid);
         geom_.back().first.reserve(count);
     }
 
@@ -122,8 +183,8 @@ struct polygon_handler
     {
         if (first_ || pt.x != cur_x_ || pt.y != cur_y_)
         {
-            CoordinateType x = pt.x * static_cast<std::int32_t>(zoom_factor_) - static_cast<std::int32_t>(dx_);
-            CoordinateType y = pt.y * static_cast<std::int32_t>(zoom_factor_) - static_cast<std::int32_t>(dy_);
+            CoordinateType x = static_cast<CoordinateType>(pt.x) * static_cast<CoordinateType>(zoom_factor_) - static_cast<CoordinateType>(dx_);
+            CoordinateType y = static_cast<CoordinateType>(pt.y) * static_cast<CoordinateType>(zoom_factor_) - static_cast<CoordinateType>(dy_);
             geom_.back().first.emplace_back(x, y);
             cur_x_ = pt.x;
             cur_y_ = pt.y;
@@ -137,6 +198,7 @@ struct polygon_handler
     }
 
     geom_type& geom_;
+    scratch_pool<CoordinateType>& pool_ = scratch_pool<CoordinateType>::local();
     std::uint32_t const dx_;
     std::uint32_t const dy_;
     std::uint32_t const zoom_factor_;
@@ -145,157 +207,573 @@ struct polygon_handler
     bool first_ = true;
 };
 
+// Computes the bounding box of a feature's geometry straight from the command
+// stream (for any geometry type) without storing any coordinates. The box is
+// always computed with 64-bit coordinates, so it also tells whether the
+// feature can be handled with narrower ones.
+struct envelope_handler
+{
+    using box_type = mapbox::geometry::box<std::int64_t>;
+    envelope_handler(std::uint32_t dx, std::uint32_t dy, std::uint32_t zoom_factor)
+        : dx_(dx),
+          dy_(dy),
+          zoom_factor_(zoom_factor) {}
+
+    void points_begin(std::uint32_t /*unused*/) {}
+    void points_point(vtzero::point const& pt) { add(pt); }
+    void points_end() {}
+
+    void linestring_begin(std::uint32_t /*unused*/) {}
+    void linestring_point(vtzero::point const& pt) { add(pt); }
+    void linestring_end() {}
+
+    void ring_begin(std::uint32_t /*unused*/) {}
+    void ring_point(vtzero::point const& pt) { add(pt); }
+    void ring_end(vtzero::ring_type /*unused*/) {}
+
+    void add(vtzero::point const& pt)
+    {
+        min_x_ = std::min(min_x_, pt.x);
+        min_y_ = std::min(min_y_, pt.y);
+        max_x_ = std::max(max_x_, pt.x);
+        max_y_ = std::max(max_y_, pt.y);
+    }
+
+    // the envelope in target tile coordinates; min > max if there were no points
+    box_type result() const
+    {
+        if (min_x_ > max_x_)
+        {
+            return {{1, 1}, {0, 0}};
+        }
+        return transform({{min_x_, min_y_}, {max_x_, max_y_}}, dx_, dy_, zoom_factor_);
+    }
+
+    // `envelope` (in source tile coordinates) in target tile coordinates
+    static box_type transform(box_type const& envelope, std::uint32_t dx, std::uint32_t dy, std::uint32_t zoom_factor)
+    {
+        std::int64_t const factor = zoom_factor;
+        return {{envelope.min.x * factor - dx, envelope.min.y * factor - dy},
+                {envelope.max.x * factor - dx, envelope.max.y * factor - dy}};
+    }
+
+    std::uint32_t const dx_;
+    std::uint32_t const dy_;
+    std::uint32_t const zoom_factor_;
+    std::int32_t min_x_ = std::numeric_limits<std::int32_t>::max();
+    std::int32_t min_y_ = std::numeric_limits<std::int32_t>::max();
+    std::int32_t max_x_ = std::numeric_limits<std::int32_t>::min();
+    std::int32_t max_y_ = std::numeric_limits<std::int32_t>::min();
+};
+
+// counts the points of a feature's geometry (for any geometry type)
+struct vertex_counter
+{
+    void points_begin(std::uint32_t /*unused*/) {}
+    void points_point(vtzero::point const& /*unused*/) { ++count; }
+    void points_end() {}
+
+    void linestring_begin(std::uint32_t /*unused*/) {}
+    void linestring_point(vtzero::point const& /*unused*/) { ++count; }
+    void linestring_end() {}
+
+    void ring_begin(std::uint32_t /*unused*/) {}
+    void ring_point(vtzero::point const& /*unused*/) { ++count; }
+    void ring_end(vtzero::ring_type /*unused*/) {}
+
+    std::uint64_t result() const { return count; }
+
+    std::uint64_t count = 0;
+};
+
+template <typename To, typename From>
+mapbox::geometry::point<To> narrow_point(mapbox::geometry::point<From> const& pt)
+{
+    return {static_cast<To>(pt.x), static_cast<To>(pt.y)};
+}
+
 } // namespace detail
 
+// Result of clipping a single source feature against the target tile. Only the
+// container matching the feature's geometry type is populated.
 template <typename CoordinateType>
-struct overzoomed_feature_builder
+struct clipped_feature
+{
+    explicit clipped_feature(vtzero::feature const& feature_)
+        : feature{feature_} {}
+
+    vtzero::feature feature;
+    mapbox::geometry::multi_point<CoordinateType> points{};
+    std::vector<mapbox::geometry::line_string<CoordinateType>> lines{};
+    std::vector<mapbox::geometry::polygon<CoordinateType>> polygons{};
+};
+
+// hands the geometries of `clipped` back to the scratch pool of the thread
+template <typename CoordinateType>
+void recycle(clipped_feature<CoordinateType>& clipped)
+{
+    auto& pool = scratch_pool<CoordinateType>::local();
+    clipped.points.clear();
+    pool.recycle_all(clipped.lines);
+    pool.recycle_all(clipped.polygons);
+}
+
+template <typename CoordinateType>
+struct overzoomed_feature_clipper
 {
     using coordinate_type = CoordinateType;
-    overzoomed_feature_builder(vtzero::layer_builder& layer_builder,
-                               vtzero::property_mapper& mapper,
-                               mapbox::geometry::box<coordinate_type> const& bbox,
+    using envelope_type = detail::envelope_handler::box_type;
+
+    // Clipping computes differences between coordinates, which must not
+    // overflow coordinate_type. Features reaching further out than this are
+    // clipped with 64-bit coordinates instead (see clip_wide).
+    static constexpr std::int64_t max_coordinate = std::numeric_limits<coordinate_type>::max() / 2;
+
+    overzoomed_feature_clipper(mapbox::geometry::box<coordinate_type> const& bbox,
                                std::uint32_t dx, std::uint32_t dy, std::uint32_t zoom_factor)
-        : layer_builder_{layer_builder},
-          mapper_{mapper},
-          bbox_{bbox},
+        : bbox_{bbox},
           dx_{dx},
           dy_{dy},
           zoom_factor_{zoom_factor} {}
 
-    template <typename FeatureBuilder>
-    void finalize(FeatureBuilder& builder, vtzero::feature const& feature)
+    // Features are first checked against the bbox using the envelope of their
+    // geometry: features entirely outside are dropped before decoding them and
+    // lines and polygons entirely inside are only transformed, not clipped.
+    envelope_type envelope(vtzero::feature const& feature) const
     {
-        // add properties
-        builder.copy_properties(feature, mapper_);
-        builder.commit();
+        return vtzero::decode_geometry(feature.geometry(), detail::envelope_handler(dx_, dy_, zoom_factor_));
     }
 
-    void apply_geometry_point(vtzero::feature const& feature)
+    // the envelope in target tile coordinates of a feature whose envelope in
+    // source tile coordinates is known (see source_envelope)
+    envelope_type envelope(envelope_type const& source) const
     {
-        mapbox::geometry::multi_point<CoordinateType> multi_point;
-        vtzero::decode_point_geometry(feature.geometry(), detail::point_handler<coordinate_type>(multi_point, dx_, dy_, zoom_factor_, bbox_));
-        if (!multi_point.empty())
+        if (source.min.x > source.max.x)
         {
-            vtzero::point_feature_builder feature_builder{layer_builder_};
-            feature_builder.copy_id(feature);
-            feature_builder.add_points_from_container(multi_point);
-            finalize(feature_builder, feature);
+            return source;
         }
+        return detail::envelope_handler::transform(source, dx_, dy_, zoom_factor_);
+    }
+
+    static bool fits(envelope_type const& extent)
+    {
+        return extent.min.x >= -max_coordinate && extent.min.y >= -max_coordinate &&
+               extent.max.x <= max_coordinate && extent.max.y <= max_coordinate;
+    }
+
+    bool clip_point(vtzero::feature const& feature, clipped_feature<coordinate_type>& clipped) const
+    {
+        vtzero::decode_point_geometry(feature.geometry(), detail::point_handler<coordinate_type>(clipped.points, dx_, dy_, zoom_factor_, bbox_));
+        return !clipped.points.empty();
     }
 
-    void apply_geometry_linestring(vtzero::feature const& feature)
+    bool clip_linestring(vtzero::feature const& feature, envelope_type const& extent, clipped_feature<coordinate_type>& clipped) const
     {
-        mapbox::geometry::multi_line_string<CoordinateType> multi_line;
-        vtzero::decode_linestring_geometry(feature.geometry(), detail::line_string_handler<coordinate_type>(multi_line, dx_, dy_, zoom_factor_));
-        std::vector<mapbox::geometry::line_string<coordinate_type>> result;
-        boost::geometry::intersection(multi_line, bbox_, result);
-        if (!result.empty())
+        if (detail::covered_by(extent, bbox_))
         {
-            vtzero::linestring_feature_builder feature_builder{layer_builder_};
-            feature_builder.copy_id(feature);
-            bool valid = false;
-            for (auto const& l : result)
-            {
-                if (l.size() > 1)
-                {
-                    feature_builder.add_linestring(static_cast<unsigned>(l.size()));
-                    auto itr = l.cbegin();
-                    auto last_pt = *itr++;
-                    feature_builder.set_point(static_cast<int>(last_pt.x), static_cast<int>(last_pt.y));
-                    for (auto const& end = l.end(); itr != end; ++itr)
-                    {
-                        if (*itr != last_pt)
-                        {
-                            valid = true;
-                            feature_builder.set_point(static_cast<int>(itr->x), static_cast<int>(itr->y));
-                            last_pt = *itr;
-                        }
-                    }
-                }
-            }
-            if (valid)
-            {
-                finalize(feature_builder, feature);
-            }
+            vtzero::decode_linestring_geometry(feature.geometry(), detail::line_string_handler<coordinate_type>(clipped.lines, dx_, dy_, zoom_factor_));
+        }
+        else
+        {
+            vtzero::decode_linestring_geometry(feature.geometry(), detail::clipping_line_string_handler<coordinate_type>(clipped.lines, bbox_, dx_, dy_, zoom_factor_));
         }
+        return !clipped.lines.empty();
     }
-    void apply_geometry_polygon(vtzero::feature const& feature)
+
+    bool clip_polygon(vtzero::feature const& feature, envelope_type const& extent, clipped_feature<coordinate_type>& clipped)
     {
-        std::vector<detail::annotated_ring<CoordinateType>> rings;
-        vtzero::decode_polygon_geometry(feature.geometry(), detail::polygon_handler<CoordinateType>(rings, dx_, dy_, zoom_factor_));
-        std::vector<mapbox::geometry::polygon<CoordinateType>> polygons;
+        bool const inside = detail::covered_by(extent, bbox_);
+        auto& pool = scratch_pool<coordinate_type>::local();
+        vtzero::decode_polygon_geometry(feature.geometry(), detail::polygon_handler<coordinate_type>(rings_, dx_, dy_, zoom_factor_));
         bool process = false;
-        for (auto const& r : rings)
+        for (auto& r : rings_)
         {
             if (r.second == vtzero::ring_type::outer)
             {
-                auto extent = mapbox::geometry::envelope(r.first);
-                process = boost::geometry::intersects(extent, bbox_);
+                process = inside || boost::geometry::intersects(mapbox::geometry::envelope(r.first), bbox_);
                 if (process)
                 {
-                    polygons.emplace_back(); // start new polygon
+                    polygons_.push_back(pool.take_polygon()); // start new polygon
                 }
             }
             if (process && r.first.size() > 3)
             {
-                polygons.back().push_back(std::move(r.first));
+                polygons_.back().push_back(std::move(r.first));
+            }
+            else
+            {
+                pool.recycle(r.first);
             }
         }
-        if (!polygons.empty())
+        rings_.clear();
+        if (inside)
         {
-            vtzero::polygon_feature_builder feature_builder{layer_builder_};
-            feature_builder.copy_id(feature);
-            bool valid = false;
-            for (auto const& poly : polygons)
+            // not clipped, but cleaned up like the rings of clipped polygons
+            for (auto& poly : polygons_)
             {
-                std::vector<mapbox::geometry::polygon<coordinate_type>> result;
-                boost::geometry::intersection(poly, bbox_, result);
-                for (auto const& p : result)
+                if (poly.empty() || !vtile::normalize_ring(bbox_, poly.front()))
+                {
+                    pool.recycle(poly);
+                    continue;
+                }
+                std::size_t size = 1;
+                for (std::size_t i = 1; i < poly.size(); ++i)
                 {
-                    for (auto const& ring : p)
+                    if (vtile::normalize_ring(bbox_, poly[i]))
                     {
-                        if (ring.size() > 3)
-                        {
-                            valid = true;
-                            feature_builder.add_ring(static_cast<unsigned>(ring.size()));
-                            std::for_each(ring.begin(), ring.end(),
-                                          [&feature_builder](auto const& pt) { feature_builder.set_point(static_cast<int>(pt.x), static_cast<int>(pt.y)); });
-                        }
+                        std::swap(poly[size++], poly[i]);
                     }
                 }
+                while (poly.size() > size)
+                {
+                    pool.recycle(poly.back());
+                    poly.pop_back();
+                }
+                clipped.polygons.push_back(std::move(poly));
             }
-            if (valid)
+            polygons_.clear();
+            return !clipped.polygons.empty();
+        }
+        for (auto const& poly : polygons_)
+        {
+#ifndef VTCOMPOSITE_BOOST_POLYGON_CLIPPING
+            if (vtile::clip_polygon(bbox_, poly, clipped.polygons))
             {
-                finalize(feature_builder, feature);
+                continue;
             }
+#endif
+            std::vector<mapbox::geometry::polygon<coordinate_type>> result;
+            boost::geometry::intersection(poly, bbox_, result);
+            std::move(result.begin(), result.end(), std::back_inserter(clipped.polygons));
         }
+        pool.recycle_all(polygons_);
+        return !clipped.polygons.empty();
     }
 
-    void apply(vtzero::feature const& feature)
+    // clips with 64-bit coordinates; what is left lies within bbox_, so it
+    // fits in coordinate_type again
+    bool clip_wide(vtzero::feature const& feature, clipped_feature<coordinate_type>& clipped) const
+    {
+        mapbox::geometry::box<std::int64_t> const bbox{{bbox_.min.x, bbox_.min.y}, {bbox_.max.x, bbox_.max.y}};
+        clipped_feature<std::int64_t> wide{feature};
+        if (!overzoomed_feature_clipper<std::int64_t>{bbox, dx_, dy_, zoom_factor_}(feature, wide))
+        {
+            return false;
+        }
+        for (auto const& pt : wide.points)
+        {
+            clipped.points.push_back(detail::narrow_point<coordinate_type>(pt));
+        }
+        for (auto const& line : wide.lines)
+        {
+            clipped.lines.emplace_back();
+            for (auto const& pt : line)
+            {
+                clipped.lines.back().push_back(detail::narrow_point<coordinate_type>(pt));
+            }
+        }
+        for (auto const& poly : wide.polygons)
+        {
+            clipped.polygons.emplace_back();
+            for (auto const& ring : poly)
+            {
+                clipped.polygons.back().emplace_back();
+                for (auto const& pt : ring)
+                {
+                    clipped.polygons.back().back().push_back(detail::narrow_point<coordinate_type>(pt));
+                }
+            }
+        }
+        recycle(wide);
+        return true;
+    }
+
+    // returns false if nothing of the feature is left within the target bbox
+    bool operator()(vtzero::feature const& feature, clipped_feature<coordinate_type>& clipped)
+    {
+        return clip(feature, envelope(feature), clipped);
+    }
+
+    // as operator(), for a feature whose envelope in target tile coordinates
+    // is already known
+    bool clip(vtzero::feature const& feature, envelope_type const& extent, clipped_feature<coordinate_type>& clipped)
     {
+        if (detail::disjoint(extent, bbox_))
+        {
+            return false;
+        }
+        if (sizeof(coordinate_type) < sizeof(std::int64_t) && !fits(extent))
+        {
+            return clip_wide(feature, clipped);
+        }
         switch (feature.geometry_type())
         {
         case vtzero::GeomType::POINT:
-            apply_geometry_point(feature);
-            break;
+            return clip_point(feature, clipped);
         case vtzero::GeomType::LINESTRING:
-            apply_geometry_linestring(feature);
-            break;
+            return clip_linestring(feature, extent, clipped);
         case vtzero::GeomType::POLYGON:
-            apply_geometry_polygon(feature);
-            break;
+            return clip_polygon(feature, extent, clipped);
         default:
             // LCOV_EXCL_START
-            break;
+            return false;
             // LCOV_EXCL_STOP
         }
     }
-    vtzero::layer_builder& layer_builder_;
-    vtzero::property_mapper& mapper_;
+
     mapbox::geometry::box<coordinate_type> const& bbox_;
     std::uint32_t dx_;
     std::uint32_t dy_;
     std::uint32_t zoom_factor_;
+    // reused for every polygon feature
+    std::vector<detail::annotated_ring<coordinate_type>> rings_{};
+    std::vector<mapbox::geometry::polygon<coordinate_type>> polygons_{};
+};
+
+// Replaces the copied properties of overzoomed features, e.g. to localize them
+// while they are overzoomed instead of in another pass over the output tile.
+class property_writer
+{
+  public:
+    virtual ~property_writer() = default;
+
+    // false if `feature` is dropped from the output
+    virtual bool accept(vtzero::feature const& feature) = 0;
+
+    // how many times the feature last accepted is written, with different
+    // properties (e.g. once for each of its worldviews)
+    virtual std::size_t copies() const = 0;
+
+    // the properties of copy `copy` of the feature last accepted, as indexes
+    // in the key and value tables of the output layer
+    virtual std::vector<vtzero::index_value_pair> const& properties(std::size_t copy) = 0;
+};
+
+template <typename CoordinateType>
+struct overzoomed_feature_builder
+{
+    using coordinate_type = CoordinateType;
+    overzoomed_feature_builder(vtzero::layer_builder& layer_builder,
+                               vtzero::property_mapper& mapper,
+                               mapbox::geometry::box<coordinate_type> const& bbox,
+                               std::uint32_t dx, std::uint32_t dy, std::uint32_t zoom_factor)
+        : layer_builder_{layer_builder},
+          mapper_{mapper},
+          clipper_{bbox, dx, dy, zoom_factor} {}
+
+    template <typename FeatureBuilder>
+    void add_properties(FeatureBuilder& builder, vtzero::feature const& feature, std::size_t copy)
+    {
+        if (writer_ == nullptr)
+        {
+            builder.copy_properties(feature, mapper_);
+            return;
+        }
+        for (auto const& property : writer_->properties(copy))
+        {
+            builder.add_property(property);
+        }
+    }
+
+    template <typename FeatureBuilder>
+    void finalize(FeatureBuilder& builder, vtzero::feature const& feature, std::size_t vertices, std::size_t copy)
+    {
+        if (stats_ == nullptr)
+        {
+            add_properties(builder, feature, copy);
+            builder.commit();
+            return;
+        }
+        std::uint64_t const start = steady_ns();
+        add_properties(builder, feature, copy);
+        stats_->properties_ns += steady_ns() - start;
+        builder.commit();
+        ++stats_->features_out;
+        stats_->vertices_out += vertices;
+    }
+
+    void emit_point(clipped_feature<coordinate_type> const& clipped, std::size_t copy)
+    {
+        vtzero::point_feature_builder feature_builder{layer_builder_};
+        feature_builder.copy_id(clipped.feature);
+        feature_builder.add_points_from_container(clipped.points);
+        finalize(feature_builder, clipped.feature, clipped.points.size(), copy);
+    }
+
+    void emit_linestring(clipped_feature<coordinate_type> const& clipped, std::size_t copy)
+    {
+        vtzero::linestring_feature_builder feature_builder{layer_builder_};
+        feature_builder.copy_id(clipped.feature);
+        bool valid = false;
+        std::size_t vertices = 0;
+        for (auto const& l : clipped.lines)
+        {
+            if (l.size() > 1)
+            {
+                feature_builder.add_linestring(static_cast<unsigned>(l.size()));
+                auto itr = l.cbegin();
+                auto last_pt = *itr++;
+                feature_builder.set_point(static_cast<int>(last_pt.x), static_cast<int>(last_pt.y));
+                ++vertices;
+                for (auto const& end = l.end(); itr != end; ++itr)
+                {
+                    if (*itr != last_pt)
+                    {
+                        valid = true;
+                        feature_builder.set_point(static_cast<int>(itr->x), static_cast<int>(itr->y));
+                        ++vertices;
+                        last_pt = *itr;
+                    }
+                }
+            }
+        }
+        if (valid)
+        {
+            finalize(feature_builder, clipped.feature, vertices, copy);
+        }
+    }
+
+    void emit_polygon(clipped_feature<coordinate_type> const& clipped, std::size_t copy)
+    {
+        vtzero::polygon_feature_builder feature_builder{layer_builder_};
+        feature_builder.copy_id(clipped.feature);
+        bool valid = false;
+        std::size_t vertices = 0;
+        for (auto const& p : clipped.polygons)
+        {
+            for (auto const& ring : p)
+            {
+                if (ring.size() > 3)
+                {
+                    valid = true;
+                    vertices += ring.size();
+                    feature_builder.add_ring(static_cast<unsigned>(ring.size()));
+                    std::for_each(ring.begin(), ring.end(),
+                                  [&feature_builder](auto const& pt) { feature_builder.set_point(static_cast<int>(pt.x), static_cast<int>(pt.y)); });
+                }
+            }
+        }
+        if (valid)
+        {
+            finalize(feature_builder, clipped.feature, vertices, copy);
+        }
+    }
+
+    void emit_clipped(clipped_feature<coordinate_type> const& clipped)
+    {
+        std::size_t const copies = writer_ == nullptr ? 1 : writer_->copies();
+        for (std::size_t copy = 0; copy < copies; ++copy)
+        {
+            switch (clipped.feature.geometry_type())
+            {
+            case vtzero::GeomType::POINT:
+                emit_point(clipped, copy);
+                break;
+            case vtzero::GeomType::LINESTRING:
+                emit_linestring(clipped, copy);
+                break;
+            case vtzero::GeomType::POLYGON:
+                emit_polygon(clipped, copy);
+                break;
+            default:
+                // LCOV_EXCL_START
+                break;
+                // LCOV_EXCL_STOP
+            }
+        }
+    }
+
+    // encodes a feature previously clipped by an overzoomed_feature_clipper
+    void emit(clipped_feature<coordinate_type> const& clipped)
+    {
+        if (writer_ == nullptr || writer_->accept(clipped.feature))
+        {
+            emit_clipped(clipped);
+        }
+    }
+
+    void apply(vtzero::feature const& feature)
+    {
+        if (writer_ != nullptr && !writer_->accept(feature))
+        {
+            return;
+        }
+        clipped_.feature = feature;
+        if (clipper_(feature, clipped_))
+        {
+            emit_clipped(clipped_);
+        }
+        recycle(clipped_);
+    }
+
+    // as apply(), for a feature whose envelope in source tile coordinates is
+    // known, so that a feature overzoomed into several tiles is only decoded
+    // for the tiles it touches
+    void apply(vtzero::feature const& feature, detail::envelope_handler::box_type const& source_envelope)
+    {
+        auto const extent = clipper_.envelope(source_envelope);
+        if (detail::disjoint(extent, clipper_.bbox_))
+        {
+            return;
+        }
+        if (writer_ != nullptr && !writer_->accept(feature))
+        {
+            return;
+        }
+        clipped_.feature = feature;
+        if (clipper_.clip(feature, extent, clipped_))
+        {
+            emit_clipped(clipped_);
+        }
+        recycle(clipped_);
+    }
+
+    vtzero::layer_builder& layer_builder_;
+    vtzero::property_mapper& mapper_;
+    overzoomed_feature_clipper<coordinate_type> clipper_;
+    clipped_feature<coordinate_type> clipped_{vtzero::feature{}}; // reused for every feature
+    layer_stats* stats_ = nullptr;                                 // counts features out if set
+    property_writer* writer_ = nullptr;                            // writes the properties if set
+};
+
+// The envelope of a feature's geometry in its own tile coordinates; min > max
+// if it has no points.
+inline detail::envelope_handler::box_type source_envelope(vtzero::feature const& feature)
+{
+    return vtzero::decode_geometry(feature.geometry(), detail::envelope_handler(0, 0, 1));
+}
+
+// The number of points of a feature's geometry.
+inline std::uint64_t count_vertices(vtzero::feature const& feature)
+{
+    return vtzero::decode_geometry(feature.geometry(), detail::vertex_counter{});
+}
+
+// Clips features into a list of clipped_feature records instead of encoding
+// them, so the (expensive) clipping of a large layer can be split into chunks
+// and run on several threads. The records are encoded afterwards, in feature
+// order, with overzoomed_feature_builder::emit.
+template <typename CoordinateType>
+struct overzoomed_feature_collector
+{
+    using coordinate_type = CoordinateType;
+    overzoomed_feature_collector(std::vector<clipped_feature<coordinate_type>>& records,
+                                 mapbox::geometry::box<coordinate_type> const& bbox,
+                                 std::uint32_t dx, std::uint32_t dy, std::uint32_t zoom_factor)
+        : records_{records},
+          clipper_{bbox, dx, dy, zoom_factor} {}
+
+    void apply(vtzero::feature const& feature)
+    {
+        clipped_feature<coordinate_type> clipped{feature};
+        if (clipper_(feature, clipped))
+        {
+            records_.push_back(std::move(clipped));
+        }
+    }
+
+    std::vector<clipped_feature<coordinate_type>>& records_;
+    overzoomed_feature_clipper<coordinate_type> clipper_;
 };
 
 } // namespace vtile
@@ -0,0 +1,379 @@
+#pragma once
+
+#include "feature_builder.hpp"
+#include "localize_keys.hpp"
+// vtzero
+#include <vtzero/builder.hpp>
+#include <vtzero/exception.hpp>
+#include <vtzero/property_value.hpp>
+#include <vtzero/vector_tile.hpp>
+// stl
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vtile {
+
+// Localizes the properties of the features of `layer` as localize does:
+// decides which features are dropped, and gives the others the properties
+// localize writes, as indexes in the layer of `builder`. `keys` holds the
+// role of every key of the layer (see classify_keys), so properties are only
+// looked up by the index of their key.
+class feature_localizer : public property_writer
+{
+  public:
+    feature_localizer(vtzero::layer const& layer,
+                      std::vector<localize_key> const& keys,
+                      localize_options const& options,
+                      vtzero::layer_builder& builder)
+        : layer_{layer},
+          keys_{keys},
+          options_{options},
+          mapper_{layer, keys, options, builder},
+          localize_{select(options)},
+          languages_(num_language_slots(keys)) {}
+
+    bool accept(vtzero::feature const& feature) override
+    {
+        indexes_.clear();
+        feature.for_each_property_indexes([this](vtzero::index_value_pair&& index) {
+            indexes_.push_back(index);
+            return true;
+        });
+        return localize(indexes_);
+    }
+
+    // as accept(), for a feature whose property indexes are decoded already
+    bool localize(std::vector<vtzero::index_value_pair> const& indexes)
+    {
+        return (this->*localize_)(indexes);
+    }
+
+    // one copy for each worldview of the feature, or one if it has none
+    std::size_t copies() const override
+    {
+        return feature_worldviews_ == nullptr ? 1 : feature_worldviews_->size();
+    }
+
+    // Keys and values are only added to the output layer here, so that
+    // features accepted but then left without geometry add neither.
+    std::vector<vtzero::index_value_pair> const& properties(std::size_t copy) override
+    {
+        properties_.clear();
+        for (auto const& property : final_properties_)
+        {
+            if (feature_worldviews_ != nullptr && mapper_.is_worldview_key(property)) // safeguard – should always evaluate to false
+            {
+                continue;
+            }
+            vtzero::index_value const key = mapper_.key(property);
+            properties_.emplace_back(key, mapper_.value(property.value));
+        }
+        if (feature_worldviews_ != nullptr)
+        {
+            vtzero::index_value const key = mapper_.key({output_key::worldview_property, 0, {}});
+            properties_.emplace_back(key, mapper_.value((*feature_worldviews_)[copy]));
+        }
+        return properties_;
+    }
+
+  private:
+    using localize_fn = bool (feature_localizer::*)(std::vector<vtzero::index_value_pair> const&);
+
+    static localize_fn select(localize_options const& options)
+    {
+        if (!options.localized)
+        {
+            return &feature_localizer::localize_feature<false, false>;
+        }
+        if (options.all_languages)
+        {
+            return &feature_localizer::localize_feature<true, true>;
+        }
+        return &feature_localizer::localize_feature<true, false>;
+    }
+
+    // returns a vector of requested worldviews that the feature exists in
+    static std::vector<std::string> worldviews_for_feature(std::vector<std::string> available_worldviews, std::vector<std::string> target_worldviews)
+    {
+        target_worldviews.emplace_back("all");
+
+        std::vector<std::string> matching_worldviews;
+        intersection(available_worldviews, target_worldviews, matching_worldviews);
+        return matching_worldviews;
+    }
+
+    // The worldviews to create a clone of a feature for, given the value of
+    // its compatible worldview key: none if the feature is dropped. Worked out
+    // once for each value of the layer, as features share a few values.
+    template <bool Localized>
+    std::vector<std::string> const& worldviews(vtzero::index_value value_index)
+    {
+        if (worldviews_.empty())
+        {
+            worldviews_.resize(layer_.value_table_size());
+        }
+        std::uint32_t const index = value_index.value();
+        if (index >= worldviews_.size())
+        {
+            throw vtzero::out_of_range_exception{index};
+        }
+        worldview_match& match = worldviews_[index];
+        if (match.known)
+        {
+            return match.worldviews;
+        }
+        match.known = true;
+        vtzero::property_value const value = layer_.value(value_index);
+        if (value.type() != vtzero::property_value_type::string_value)
+        {
+            return match.worldviews;
+        }
+        std::string property_value = static_cast<std::string>(value.string_value());
+
+        // determine which worldviews to create a clone of the feature
+        if (!Localized || options_.all_worldviews)
+        {
+            match.worldviews = {property_value};
+        }
+        else
+        {
+            std::vector<std::string> available_worldviews = split(property_value);
+            match.worldviews = worldviews_for_feature(available_worldviews, options_.worldviews);
+        }
+        return match.worldviews;
+    }
+
+    // Sets the final properties (and worldview) of the feature with property
+    // `indexes`; returns false if the feature is dropped.
+    template <bool Localized, bool AllLanguages>
+    bool localize_feature(std::vector<vtzero::index_value_pair> const& indexes)
+    {
+        // a flag to indicate whether This feature will be dropped; will set this flag
+        // to true when we encounter a property that suggests this feature should be
+        // discarded (for example, if the feature has an incompatible worldview key/value).
+        bool skip_feature = false;
+
+        // will be creating one clone of the feature for each worldview if worldview property exists
+        std::vector<std::string> const* worldviews_to_create = nullptr;
+
+        // will be searching for the class with lowest rank
+        auto class_key_idx = static_cast<std::uint32_t>(options_.class_key_precedence.size());
+        vtzero::index_value class_value;
+
+        auto language_key_idx = static_cast<std::uint32_t>(options_.language_key_precedence.size());
+        vtzero::index_value language_value;
+        vtzero::index_value original_language_value;
+        bool omit_local_language = false;
+
+        // collect final properties
+        final_properties_.clear();
+        if (AllLanguages)
+        {
+            std::fill(languages_.begin(), languages_.end(), localize_property{});
+        }
+
+        for (auto const& index : indexes)
+        {
+            // once skip_feature is set, the rest of the properties don't matter
+            if (skip_feature)
+            {
+                break;
+            }
+            std::uint32_t const key_index = index.key().value();
+            if (key_index >= keys_.size())
+            {
+                throw vtzero::out_of_range_exception{key_index};
+            }
+            localize_key const& key = keys_[key_index];
+            switch (key.role)
+            {
+            case key_role::drop:
+                break;
+            case key_role::keep:
+                final_properties_.push_back({output_key::source, key_index, index.value()});
+                break;
+            case key_role::incompatible_worldview:
+            {
+                // skip feature only if the value of incompatible worldview key is not 'all'
+                vtzero::property_value const value = layer_.value(index.value());
+                skip_feature = value.type() != vtzero::property_value_type::string_value || value.string_value() != "all";
+                break;
+            }
+            case key_role::compatible_worldview:
+            {
+                // keep feature and retain its compatible worldview value
+                worldviews_to_create = &worldviews<Localized>(index.value());
+                skip_feature = worldviews_to_create->empty();
+                break;
+            }
+            case key_role::drop_feature: // safeguard, should never happen
+                skip_feature = true;
+                break;
+            case key_role::class_value:
+                // check if the property is of higher precedence that class key encountered so far
+                if (key.rank < class_key_idx)
+                {
+                    class_key_idx = key.rank;
+                    class_value = index.value();
+                }
+                // wait till we are done looping through all properties before we add class value to final_properties
+                break;
+            case key_role::all_languages_original:
+            {
+                // add local language name to final properties
+                final_properties_.push_back({output_key::renamed, key_index, index.value()});
+                original_language_value = index.value();
+                break;
+            }
+            case key_role::all_languages_other:
+            {
+                // add other languages (name_xx, except name_script) to languages_
+                // later encounter of the same language in the loop overwrites the former
+                languages_[key.slot] = {output_key::renamed, key_index, index.value()};
+                break;
+            }
+            case key_role::language:
+            case key_role::language_original:
+            case key_role::language_script:
+            {
+                // check if the property is of higher precedence that language key encountered so far
+                if (key.rank < language_key_idx)
+                {
+                    language_key_idx = key.rank;
+                    language_value = index.value();
+                }
+                // preserve original language value, and wait till finish looping through all properties to assign a value
+                if (key.role == key_role::language_original)
+                {
+                    original_language_value = index.value();
+                    break;
+                }
+                if (key.role == key_role::language_script)
+                {
+                    vtzero::property_value const value = layer_.value(index.value());
+                    // true if script is in the omitted list
+                    omit_local_language = std::any_of(
+                        options_.omit_scripts.begin(),
+                        options_.omit_scripts.end(),
+                        [&](const std::string& script) {
+                            return (script == value.string_value());
+                        });
+                }
+                if (key.keep)
+                {
+                    final_properties_.push_back({output_key::source, key_index, index.value()});
+                }
+                // else – wait till we are done looping through all properties to add {language} value to final_properties
+                break;
+            }
+            }
+        } // end of properties loop
+
+        // if skip feature, proceed to next feature
+        if (skip_feature)
+        {
+            return false;
+        }
+
+        // use the class value of highest precedence
+        if (class_value.valid())
+        {
+            final_properties_.push_back({output_key::class_property, 0, class_value});
+        }
+
+        // use the language value of highest precedence
+        if (language_value.valid())
+        {
+            // `local` language is "the original language in an acceptable script".
+            if (omit_local_language)
+            {
+                // don't need to check if `local` is in the desired list of languages
+                // because the script of the original language is not acceptable.
+                final_properties_.push_back({output_key::language_property, 0, language_value});
+            }
+            else if (options_.local_language_rank < language_key_idx)
+            {
+                // the original language is in an acceptable script, and `local` is in the list of
+                // desired languages (`{language_property}_local` is in language_key_precedence).
+                // note the `<`: this means if there exists a `{language_property}_local` or a `{language_prefix}{language_property}_local`
+                // already exists in the input tile, the code does not enter this if block.
+                // {language_property}_local` and `{language_prefix}{language_property}_local` take precedence over the local language.
+                final_properties_.push_back({output_key::language_property, 0, original_language_value});
+            }
+            else
+            {
+                final_properties_.push_back({output_key::language_property, 0, language_value});
+            }
+        }
+
+        if (Localized && original_language_value.valid())
+        {
+            final_properties_.push_back({output_key::local_key, 0, original_language_value});
+        }
+
+        // Check the list of languages to be added
+        // Only add the ones that are different from original local language to the final properties
+        if (AllLanguages)
+        {
+            vtzero::property_value const original_language = original_language_value.valid() ? layer_.value(original_language_value) : vtzero::property_value{};
+            for (auto const& language_property : languages_)
+            {
+                if (!language_property.value.valid())
+                {
+                    continue;
+                }
+                vtzero::property_value const language_property_value = layer_.value(language_property.value);
+                if (!original_language.valid() || language_property_value.string_value() != original_language.string_value())
+                {
+                    final_properties_.push_back(language_property);
+                }
+            }
+        }
+
+        if (worldviews_to_create != nullptr && worldviews_to_create->empty())
+        { // safeguard, should never happen
+            return false;
+        }
+        feature_worldviews_ = worldviews_to_create;
+        return true;
+    }
+
+    vtzero::layer const& layer_;
+    std::vector<localize_key> const& keys_;
+    localize_options const& options_;
+    localize_mapper mapper_;
+    localize_fn localize_;
+    // of the feature last accepted
+    std::vector<localize_property> final_properties_{};
+    std::vector<std::string> const* feature_worldviews_ = nullptr; // one copy for each, if set; see worldviews()
+    // reused across features
+    struct worldview_match
+    {
+        bool known = false;
+        std::vector<std::string> worldviews{};
+    };
+    std::vector<worldview_match> worldviews_{}; // by value index, see worldviews()
+    std::vector<localize_property> languages_; // by localize_key::slot, with all languages
+    std::vector<vtzero::index_value_pair> indexes_{};
+    std::vector<vtzero::index_value_pair> properties_{};
+};
+
+// adds a copy of `feature` with `properties` (indexes in the key and value
+// tables of `lbuilder`) to `lbuilder`
+inline void add_localized_feature(vtzero::layer_builder& lbuilder, vtzero::feature const& feature,
+                                  std::vector<vtzero::index_value_pair> const& properties)
+{
+    vtzero::geometry_feature_builder fbuilder{lbuilder};
+    fbuilder.copy_id(feature); // TODO: deduplicate this (vector tile spec says SHOULD be unique)
+    fbuilder.set_geometry(feature.geometry());
+    for (auto const& property : properties)
+    {
+        fbuilder.add_property(property);
+    }
+    fbuilder.commit();
+}
+
+} // namespace vtile
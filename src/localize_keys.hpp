@@ -0,0 +1,382 @@
+#pragma once
+
+// vtzero
+#include <vtzero/builder.hpp>
+#include <vtzero/types.hpp>
+#include <vtzero/vector_tile.hpp>
+// stl
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace vtile {
+
+// How a localize call treats property keys, derived once from its parameters.
+struct localize_options
+{
+    bool localized = false;      // return a localized tile
+    bool all_languages = false;  // localized with languages ['all']
+    bool all_worldviews = false; // localized with worldviews ['ALL']
+    std::string hidden_prefix{};
+    std::vector<std::string> omit_scripts{}; // the local language is not used in these scripts
+    std::vector<std::string> worldviews{}; // requested, when localized
+    std::string worldview_property{};
+    std::string incompatible_worldview_key{}; // features with it are dropped, unless its value is 'all'
+    std::string compatible_worldview_key{};   // its value is kept as worldview_property
+    std::string class_property{};
+    std::vector<std::string> class_key_precedence{};
+    std::string language_property{};
+    std::string script_key{}; // {language_property}_script
+    std::string local_key{};  // {language_property}_local
+    std::vector<std::string> language_key_precedence{};
+    std::uint32_t local_language_rank = 0; // of local_key in language_key_precedence
+};
+
+inline bool starts_with(std::string const& str, std::string const& prefix)
+{
+    return prefix.length() <= str.length() && std::equal(prefix.begin(), prefix.end(), str.begin());
+}
+
+// splits a string by comma
+inline std::vector<std::string> split(std::string const& input)
+{
+    std::vector<std::string> values;
+    std::stringstream s_stream(input);
+    while (s_stream.good())
+    {
+        std::string substr;
+        std::getline(s_stream, substr, ',');
+        values.push_back(substr);
+    }
+    return values;
+}
+
+// finds the intersection of two vectors of strings
+// and assigns the intersection to a new vector passed by reference
+// results are returned in alphabetically ascending order
+// {"CN", "RU", "US"} + {"RU", "US"} => {"US", "RU"}
+inline void intersection(
+    std::vector<std::string>& v1,
+    std::vector<std::string>& v2,
+    std::vector<std::string>& result)
+{
+    std::sort(v1.begin(), v1.end());
+    std::sort(v2.begin(), v2.end());
+    std::set_intersection(v1.begin(), v1.end(),
+                          v2.begin(), v2.end(),
+                          std::back_inserter(result));
+}
+
+// the index of `key` in `precedence`, or its size if it is not there
+inline std::uint32_t key_rank(std::vector<std::string> const& precedence, std::string const& key)
+{
+    return static_cast<std::uint32_t>(std::distance(precedence.begin(), std::find(precedence.begin(), precedence.end(), key)));
+}
+
+inline localize_options make_localize_options(std::string const& hidden_prefix,
+                                              std::vector<std::string> const& omit_scripts,
+                                              std::vector<std::string> const& languages,
+                                              std::string const& language_property,
+                                              std::vector<std::string> const& worldviews,
+                                              std::string const& worldview_property,
+                                              std::string const& class_property,
+                                              bool localized)
+{
+    localize_options options;
+    options.localized = localized;
+    options.hidden_prefix = hidden_prefix;
+    options.omit_scripts = omit_scripts;
+    options.worldview_property = worldview_property;
+    options.class_property = class_property;
+    options.language_property = language_property;
+    options.script_key = language_property + "_script";
+    options.local_key = language_property + "_local";
+    if (localized)
+    {
+        options.incompatible_worldview_key = worldview_property;
+        options.compatible_worldview_key = hidden_prefix + worldview_property;
+        options.class_key_precedence = {hidden_prefix + class_property, class_property};
+        if (languages.size() == 1 && languages[0] == "all")
+        {
+            options.all_languages = true;
+        }
+        else
+        {
+            for (auto const& lang : languages)
+            {
+                options.language_key_precedence.push_back(language_property + "_" + lang);
+                options.language_key_precedence.push_back(hidden_prefix + language_property + "_" + lang);
+            }
+            options.language_key_precedence.push_back(language_property);
+        }
+        options.worldviews = worldviews;
+        options.all_worldviews = worldviews.size() == 1 && worldviews[0] == "ALL";
+    }
+    else
+    {
+        options.incompatible_worldview_key = hidden_prefix + worldview_property;
+        options.compatible_worldview_key = worldview_property;
+        options.class_key_precedence = {class_property};
+        options.language_key_precedence = {language_property};
+    }
+    options.local_language_rank = key_rank(options.language_key_precedence, options.local_key);
+    return options;
+}
+
+// What localize does with the properties of a key.
+enum class key_role : std::uint8_t
+{
+    drop,                   // hidden, dropped
+    keep,                   // kept as it is
+    incompatible_worldview, // drops the feature unless its value is 'all'
+    compatible_worldview,   // picks the worldviews of the feature
+    drop_feature,           // any other worldview key (safeguard)
+    class_value,            // a candidate class, by rank
+    language,               // a candidate language, by rank; kept as it is if `keep`
+    language_original,      // {language_property}, also a candidate language
+    language_script,        // {language_property}_script; kept as it is if `keep`
+    all_languages_original, // {language_property}, with languages ['all']
+    all_languages_other     // another language, with languages ['all']
+};
+
+struct localize_key
+{
+    key_role role = key_role::drop;
+    std::uint32_t rank = 0; // of class and language keys, the lowest wins
+    std::uint32_t slot = 0; // of all_languages_other keys, the same for keys with the same name
+    bool keep = false;
+    std::string name{}; // without hidden prefix, for the all_languages roles
+};
+
+// The role of every key of a layer's key table, so that the properties of
+// its features are localized by looking up the index of their key instead
+// of comparing key strings.
+inline std::vector<localize_key> classify_keys(std::vector<vtzero::data_view> const& key_table, localize_options const& options)
+{
+    std::string const hidden_worldview = options.hidden_prefix + options.worldview_property;
+    std::string const hidden_class = options.hidden_prefix + options.class_property;
+    std::string const hidden_language = options.hidden_prefix + options.language_property;
+
+    std::vector<localize_key> keys(key_table.size());
+    std::vector<std::string> slots; // the names of all_languages_other keys
+    for (std::size_t i = 0; i < key_table.size(); ++i)
+    {
+        std::string const key(key_table[i]);
+        localize_key& result = keys[i];
+        if (key == options.worldview_property || key == hidden_worldview)
+        {
+            if (key == options.incompatible_worldview_key)
+            {
+                result.role = key_role::incompatible_worldview;
+            }
+            else if (key == options.compatible_worldview_key)
+            {
+                result.role = key_role::compatible_worldview;
+            }
+            else
+            {
+                result.role = key_role::drop_feature;
+            }
+        }
+        else if (key == options.class_property || key == hidden_class)
+        {
+            result.role = key_role::class_value;
+            result.rank = key_rank(options.class_key_precedence, key);
+        }
+        else if (starts_with(key, options.language_property) || starts_with(key, hidden_language))
+        {
+            if (options.all_languages)
+            {
+                result.name = starts_with(key, options.hidden_prefix) ? key.substr(options.hidden_prefix.length()) : key;
+                if (key == options.language_property)
+                {
+                    result.role = key_role::all_languages_original;
+                }
+                else if (key != options.script_key)
+                {
+                    result.role = key_role::all_languages_other;
+                    result.slot = static_cast<std::uint32_t>(std::distance(slots.begin(), std::find(slots.begin(), slots.end(), result.name)));
+                    if (result.slot == slots.size())
+                    {
+                        slots.push_back(result.name);
+                    }
+                }
+                // else – the script is dropped
+            }
+            else
+            {
+                result.rank = key_rank(options.language_key_precedence, key);
+                if (key == options.language_property)
+                {
+                    result.role = key_role::language_original;
+                }
+                else if (key == options.script_key)
+                {
+                    result.role = key_role::language_script;
+                    result.keep = !options.localized;
+                }
+                else
+                {
+                    result.role = key_role::language;
+                    result.keep = !options.localized && !starts_with(key, options.hidden_prefix);
+                }
+            }
+        }
+        else if (!starts_with(key, options.hidden_prefix))
+        {
+            result.role = key_role::keep;
+        }
+    }
+    return keys;
+}
+
+// The number of slots of all_languages_other keys (see localize_key::slot)
+inline std::size_t num_language_slots(std::vector<localize_key> const& keys)
+{
+    std::size_t result = 0;
+    for (auto const& key : keys)
+    {
+        if (key.role == key_role::all_languages_other)
+        {
+            result = std::max<std::size_t>(result, key.slot + 1);
+        }
+    }
+    return result;
+}
+
+// True if localize keeps every property with these keys as it is, so that a
+// layer with this key table can be copied instead of rewritten.
+inline bool keeps_all(std::vector<localize_key> const& keys)
+{
+    return std::all_of(keys.begin(), keys.end(), [](localize_key const& key) { return key.role == key_role::keep; });
+}
+
+// The key a property of a localized feature is written with.
+enum class output_key : std::uint8_t
+{
+    source,             // the key of the source layer
+    renamed,            // the name of the key of the source layer (see localize_key::name)
+    class_property,     // localize_options::class_property
+    language_property,  // localize_options::language_property
+    local_key,          // localize_options::local_key
+    worldview_property  // localize_options::worldview_property
+};
+
+// A property of a localized feature, by the index of its value (and, for
+// source and renamed keys, of its key) in the source layer.
+struct localize_property
+{
+    output_key kind = output_key::source;
+    std::uint32_t key = 0;
+    vtzero::index_value value{};
+};
+
+// Maps the properties of a source layer to the key and value tables of the
+// layer they are localized into. As with vtzero::property_mapper, every key
+// and value is only added to the layer once, on first use, and tags are then
+// written by index. Keys and values are deduplicated as they are added, as
+// localize also writes keys that are not in the source layer, so the tables
+// are the same as with properties added by name.
+class localize_mapper
+{
+  public:
+    localize_mapper(vtzero::layer const& layer,
+                    std::vector<localize_key> const& keys,
+                    localize_options const& options,
+                    vtzero::layer_builder& builder)
+        : layer_{layer},
+          keys_{keys},
+          options_{options},
+          builder_{builder},
+          source_keys_(keys.size()),
+          renamed_keys_(keys.size()),
+          values_(layer.value_table_size()) {}
+
+    vtzero::index_value key(localize_property const& property)
+    {
+        switch (property.kind)
+        {
+        case output_key::source:
+            return lookup(source_keys_, property.key, layer_.key(vtzero::index_value{property.key}));
+        case output_key::renamed:
+            return lookup(renamed_keys_, property.key, keys_[property.key].name);
+        case output_key::class_property:
+            return lookup(added_keys_, 0, options_.class_property);
+        case output_key::language_property:
+            return lookup(added_keys_, 1, options_.language_property);
+        case output_key::local_key:
+            return lookup(added_keys_, 2, options_.local_key);
+        case output_key::worldview_property:
+            break;
+        }
+        return lookup(added_keys_, 3, options_.worldview_property);
+    }
+
+    vtzero::index_value value(vtzero::index_value source)
+    {
+        std::uint32_t const index = source.value();
+        if (index >= values_.size())
+        {
+            throw vtzero::out_of_range_exception{index};
+        }
+        if (!values_[index].valid())
+        {
+            values_[index] = builder_.add_value(layer_.value(source));
+        }
+        return values_[index];
+    }
+
+    // a value that is not in the source layer
+    vtzero::index_value value(std::string const& value)
+    {
+        return builder_.add_value(vtzero::encoded_property_value{value});
+    }
+
+    // True if `property` is written with the worldview property as its key.
+    // Source keys never are: they would have been classified as worldviews.
+    bool is_worldview_key(localize_property const& property) const
+    {
+        switch (property.kind)
+        {
+        case output_key::source:
+            return false;
+        case output_key::renamed:
+            return keys_[property.key].name == options_.worldview_property;
+        case output_key::class_property:
+            return options_.class_property == options_.worldview_property;
+        case output_key::language_property:
+            return options_.language_property == options_.worldview_property;
+        case output_key::local_key:
+            return options_.local_key == options_.worldview_property;
+        case output_key::worldview_property:
+            break;
+        }
+        return true;
+    }
+
+  private:
+    template <typename Keys, typename Key>
+    vtzero::index_value lookup(Keys& keys, std::size_t index, Key const& key)
+    {
+        if (!keys[index].valid())
+        {
+            keys[index] = builder_.add_key(vtzero::data_view{key});
+        }
+        return keys[index];
+    }
+
+    vtzero::layer const& layer_;
+    std::vector<localize_key> const& keys_;
+    localize_options const& options_;
+    vtzero::layer_builder& builder_;
+    std::vector<vtzero::index_value> source_keys_;  // by key index in the source layer
+    std::vector<vtzero::index_value> renamed_keys_; // by key index in the source layer
+    std::vector<vtzero::index_value> values_;       // by value index in the source layer
+    std::array<vtzero::index_value, 4> added_keys_{};
+};
+
+} // namespace vtile
@@ -0,0 +1,146 @@
+#pragma once
+
+// stl
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace vtile {
+
+struct cache_stats
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+    std::size_t max_bytes = 0;
+};
+
+// A map of string keys to shared, immutable values bounded by a byte budget,
+// safe to use from several threads.
+//
+// Every entry is charged the number of bytes given to put(); when the budget
+// is exceeded the least recently used entries are evicted. Values are handed
+// out as shared pointers, so evicting an entry never invalidates a value that
+// is still in use. A budget of 0 (the default) disables the cache: callers
+// check enabled() before computing keys or values.
+template <typename Value>
+class lru_cache
+{
+  public:
+    using value_type = std::shared_ptr<Value const>;
+
+    lru_cache() = default;
+    ~lru_cache() = default;
+
+    // non-copyable
+    lru_cache(lru_cache const&) = delete;
+    lru_cache& operator=(lru_cache const&) = delete;
+    // non-movable
+    lru_cache(lru_cache&&) = delete;
+    lru_cache& operator=(lru_cache&&) = delete;
+
+    bool enabled() const noexcept
+    {
+        return max_bytes_.load(std::memory_order_relaxed) > 0;
+    }
+
+    // Sets the budget, evicting entries as needed; 0 empties and disables the
+    // cache.
+    void set_max_bytes(std::size_t max_bytes)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        max_bytes_.store(max_bytes, std::memory_order_relaxed);
+        evict(0);
+    }
+
+    // the value cached under `key`, or nullptr
+    value_type get(std::string const& key)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto it = index_.find(key);
+        if (it == index_.end())
+        {
+            ++misses_;
+            return {};
+        }
+        ++hits_;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->value;
+    }
+
+    // Caches `value` under `key`, replacing any previous value. Values charged
+    // more bytes than the whole budget are not cached.
+    void put(std::string const& key, value_type value, std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (bytes > max_bytes_.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            bytes_ -= it->second->bytes;
+            entries_.erase(it->second);
+            index_.erase(it);
+        }
+        evict(bytes);
+        entries_.push_front(entry{key, std::move(value), bytes});
+        index_.emplace(key, entries_.begin());
+        bytes_ += bytes;
+    }
+
+    cache_stats stats() const
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        cache_stats result;
+        result.hits = hits_;
+        result.misses = misses_;
+        result.evictions = evictions_;
+        result.entries = index_.size();
+        result.bytes = bytes_;
+        result.max_bytes = max_bytes_.load(std::memory_order_relaxed);
+        return result;
+    }
+
+  private:
+    struct entry
+    {
+        std::string key;
+        value_type value;
+        std::size_t bytes;
+    };
+
+    // evicts the least recently used entries until `room` more bytes fit
+    void evict(std::size_t room)
+    {
+        std::size_t const max_bytes = max_bytes_.load(std::memory_order_relaxed);
+        while (!entries_.empty() && bytes_ + room > max_bytes)
+        {
+            entry const& last = entries_.back();
+            bytes_ -= last.bytes;
+            index_.erase(last.key);
+            entries_.pop_back();
+            ++evictions_;
+        }
+    }
+
+    mutable std::mutex mutex_{};
+    std::list<entry> entries_{}; // most recently used first
+    std::unordered_map<std::string, typename std::list<entry>::iterator> index_{};
+    std::atomic<std::size_t> max_bytes_{0};
+    std::size_t bytes_ = 0;
+    std::uint64_t hits_ = 0;
+    std::uint64_t misses_ = 0;
+    std::uint64_t evictions_ = 0;
+};
+
+} // namespace vtile
@@ -0,0 +1,136 @@
+#include "memory_budget.hpp"
+
+// stl
+#include <algorithm>
+#include <utility>
+
+namespace vtile {
+
+void memory_budget::set_max_bytes(std::size_t max_bytes)
+{
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        max_bytes_ = max_bytes;
+        take_ready(ready);
+    }
+    for (auto& on_reserved : ready)
+    {
+        on_reserved();
+    }
+}
+
+std::size_t memory_budget::max_bytes() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return max_bytes_;
+}
+
+bool memory_budget::admit(std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (max_bytes_ == 0 || bytes <= max_bytes_)
+    {
+        return true;
+    }
+    ++rejected_;
+    return false;
+}
+
+bool memory_budget::try_reserve(std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (!deferred_.empty() || !fits(bytes))
+    {
+        return false;
+    }
+    add(bytes);
+    return true;
+}
+
+bool memory_budget::reserve_or_defer(std::size_t bytes, std::function<void()> on_reserved)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (deferred_.empty() && fits(bytes))
+    {
+        add(bytes);
+        return true;
+    }
+    ++queued_;
+    deferred_.push_back({bytes, std::move(on_reserved)});
+    return false;
+}
+
+void memory_budget::release(std::size_t bytes)
+{
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        in_flight_ -= std::min(bytes, in_flight_);
+        take_ready(ready);
+    }
+    for (auto& on_reserved : ready)
+    {
+        on_reserved();
+    }
+}
+
+void memory_budget::reject()
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    ++rejected_;
+}
+
+memory_stats memory_budget::stats() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    memory_stats result;
+    result.in_flight = in_flight_;
+    result.peak = peak_;
+    result.max_bytes = max_bytes_;
+    result.waiting = deferred_.size();
+    result.queued = queued_;
+    result.rejected = rejected_;
+    return result;
+}
+
+// called with mutex_ held
+bool memory_budget::fits(std::size_t bytes) const
+{
+    return max_bytes_ == 0 || in_flight_ == 0 || in_flight_ + bytes <= max_bytes_;
+}
+
+// called with mutex_ held
+void memory_budget::add(std::size_t bytes)
+{
+    in_flight_ += bytes;
+    peak_ = std::max(peak_, in_flight_);
+}
+
+// called with mutex_ held: reserves the memory of the deferred calls that fit
+// now, in order, and moves their callbacks to `ready`
+void memory_budget::take_ready(std::vector<std::function<void()>>& ready)
+{
+    while (!deferred_.empty() && fits(deferred_.front().bytes))
+    {
+        add(deferred_.front().bytes);
+        ready.push_back(std::move(deferred_.front().on_reserved));
+        deferred_.pop_front();
+    }
+}
+
+memory_budget& native_memory()
+{
+    static memory_budget budget;
+    return budget;
+}
+
+std::string memory_budget_error(std::size_t bytes)
+{
+    memory_stats const stats = native_memory().stats();
+    return "memory budget exceeded: the call needs an estimated " + std::to_string(bytes) +
+           " bytes, the budget is " + std::to_string(stats.max_bytes) +
+           " bytes with " + std::to_string(stats.in_flight) + " bytes in flight";
+}
+
+} // namespace vtile
@@ -0,0 +1,103 @@
+#pragma once
+
+// stl
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vtile {
+
+struct memory_stats
+{
+    std::size_t in_flight = 0;  // bytes reserved by the calls running now
+    std::size_t peak = 0;       // the highest in_flight so far
+    std::size_t max_bytes = 0;  // the budget, 0 if unlimited
+    std::size_t waiting = 0;    // calls deferred until memory is released
+    std::uint64_t queued = 0;   // calls that had to wait for memory
+    std::uint64_t rejected = 0; // calls that did not fit in the budget
+};
+
+// A byte budget of the native memory held by calls while they run, safe to
+// use from several threads.
+//
+// Calls reserve an estimate of their memory before they start and release it
+// once their result is handed back to JS. Calls estimated at more than the
+// whole budget are rejected (see admit()); others that do not fit yet are
+// deferred: they wait in a queue, without holding a thread, and are started in
+// the order they were made by the release() that makes room for them. A call
+// always fits when no other call is in flight, so that lowering the budget
+// never leaves calls waiting forever. A budget of 0 (the default) never
+// rejects nor delays a call, but the bytes in flight are still counted.
+class memory_budget
+{
+  public:
+    memory_budget() = default;
+    ~memory_budget() = default;
+
+    // non-copyable
+    memory_budget(memory_budget const&) = delete;
+    memory_budget& operator=(memory_budget const&) = delete;
+    // non-movable
+    memory_budget(memory_budget&&) = delete;
+    memory_budget& operator=(memory_budget&&) = delete;
+
+    // Sets the budget, starting the deferred calls that fit in it now; 0
+    // removes the limit.
+    void set_max_bytes(std::size_t max_bytes);
+
+    std::size_t max_bytes() const;
+
+    // False, counting a rejected call, if `bytes` exceed the whole budget.
+    bool admit(std::size_t bytes);
+
+    // Reserves `bytes` if they fit next to the bytes in flight and no call
+    // is deferred; returns false otherwise, without waiting.
+    bool try_reserve(std::size_t bytes);
+
+    // Reserves `bytes` as try_reserve() does and returns true, or returns
+    // false and defers the call: `on_reserved` is called once `bytes` are
+    // reserved for it, by the release() or set_max_bytes() making room for it,
+    // on the thread calling these and without holding the lock.
+    bool reserve_or_defer(std::size_t bytes, std::function<void()> on_reserved);
+
+    // Releases `bytes`, then starts the deferred calls that fit now.
+    void release(std::size_t bytes);
+
+    // counts a call rejected after admit(), as it could not wait for memory
+    void reject();
+
+    memory_stats stats() const;
+
+  private:
+    struct deferred_call
+    {
+        std::size_t bytes;
+        std::function<void()> on_reserved;
+    };
+
+    bool fits(std::size_t bytes) const;
+    void add(std::size_t bytes);
+    void take_ready(std::vector<std::function<void()>>& ready);
+
+    mutable std::mutex mutex_{};
+    std::deque<deferred_call> deferred_{};
+    std::size_t max_bytes_ = 0;
+    std::size_t in_flight_ = 0;
+    std::size_t peak_ = 0;
+    std::uint64_t queued_ = 0;
+    std::uint64_t rejected_ = 0;
+};
+
+// The process-wide budget of composite, compositeBatch and localize calls,
+// set with configure({ memory_budget }).
+memory_budget& native_memory();
+
+// The error of a call estimated at `bytes` that does not fit in
+// native_memory().
+std::string memory_budget_error(std::size_t bytes);
+
+} // namespace vtile
@@ -1,10 +1,20 @@
+#include "module_data.hpp"
 #include "vtcomposite.hpp"
 #include <napi.h>
 
 Napi::Object init(Napi::Env env, Napi::Object exports)
 {
+    vtile::init_module_data(env);
     exports.Set(Napi::String::New(env, "composite"), Napi::Function::New(env, vtile::composite));
+    exports.Set(Napi::String::New(env, "compositeSync"), Napi::Function::New(env, vtile::composite_sync));
+    exports.Set(Napi::String::New(env, "compositePacked"), Napi::Function::New(env, vtile::composite_packed));
+    exports.Set(Napi::String::New(env, "compositeBatch"), Napi::Function::New(env, vtile::composite_batch));
     exports.Set(Napi::String::New(env, "localize"), Napi::Function::New(env, vtile::localize));
+    exports.Set(Napi::String::New(env, "localizeSync"), Napi::Function::New(env, vtile::localize_sync));
+    exports.Set(Napi::String::New(env, "localizeBatch"), Napi::Function::New(env, vtile::localize_batch));
+    exports.Set(Napi::String::New(env, "configure"), Napi::Function::New(env, vtile::configure));
+    exports.Set(Napi::String::New(env, "cacheStats"), Napi::Function::New(env, vtile::get_cache_stats));
+    exports.Set(Napi::String::New(env, "memoryStats"), Napi::Function::New(env, vtile::get_memory_stats));
     return exports;
 }
 
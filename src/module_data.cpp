@@ -0,0 +1,75 @@
+#include "module_data.hpp"
+
+namespace vtile {
+
+namespace {
+
+// the strings of js_name, in its order
+constexpr char const* JS_NAMES[] = {
+    "buffer",
+    "z",
+    "x",
+    "y",
+    "max_z",
+    "layers",
+    "id",
+    "buffer_size",
+    "compress",
+    "compression",
+    "threads",
+    "priority",
+    "stats",
+    "localize",
+    "max_bytes",
+    "drop_priority",
+    "drop_property",
+    "deadline_ms",
+    "signal",
+    "codec",
+    "level",
+    "min_bytes",
+    "hidden_prefix",
+    "omit_scripts",
+    "language",
+    "languages",
+    "language_property",
+    "worldview",
+    "worldviews",
+    "worldview_property",
+    "worldview_default",
+    "class_property",
+    "aborted",
+    "abort",
+    "addEventListener",
+    "removeEventListener",
+    "threadpool_size",
+    "tile_cache_size",
+    "layer_cache_size",
+    "inline_threshold",
+    "memory_budget"};
+
+static_assert(sizeof(JS_NAMES) / sizeof(JS_NAMES[0]) == NUM_JS_NAMES, "a string for each js_name");
+
+} // namespace
+
+module_data::module_data(Napi::Env env)
+    : strings_{}
+{
+    for (std::size_t i = 0; i < NUM_JS_NAMES; ++i)
+    {
+        strings_[i] = Napi::Persistent(Napi::String::New(env, JS_NAMES[i]));
+    }
+}
+
+void init_module_data(Napi::Env env)
+{
+    // deleted with the environment
+    env.SetInstanceData(new module_data{env}); // NOLINT
+}
+
+Napi::String js_string(Napi::Env env, js_name name)
+{
+    return env.GetInstanceData<module_data>()->string(name);
+}
+
+} // namespace vtile
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <napi.h>
+// stl
+#include <array>
+#include <cstddef>
+
+namespace vtile {
+
+// The property names read from the arguments of calls and of configure
+enum class js_name : std::size_t
+{
+    // tiles of composite, targets of compositeBatch, params of localize
+    buffer,
+    z,
+    x,
+    y,
+    max_z,
+    layers,
+    id,
+    // options of composite
+    buffer_size,
+    compress,
+    compression,
+    threads,
+    priority,
+    stats,
+    localize,
+    max_bytes,
+    drop_priority,
+    drop_property,
+    deadline_ms,
+    signal,
+    // compression options
+    codec,
+    level,
+    min_bytes,
+    // params of localize and the localize option of composite
+    hidden_prefix,
+    omit_scripts,
+    language,
+    languages,
+    language_property,
+    worldview,
+    worldviews,
+    worldview_property,
+    worldview_default,
+    class_property,
+    // AbortSignal
+    aborted,
+    abort,
+    add_event_listener,
+    remove_event_listener,
+    // options of configure
+    threadpool_size,
+    tile_cache_size,
+    layer_cache_size,
+    inline_threshold,
+    memory_budget
+};
+
+constexpr std::size_t NUM_JS_NAMES = static_cast<std::size_t>(js_name::memory_budget) + 1;
+
+// What the module keeps for each JS environment (the main thread and each
+// worker thread) as the instance data of the environment.
+//
+// Holds the strings of js_name, created once so that reading the arguments of
+// a call does not create a string for every Has and Get of every tile and
+// option.
+class module_data
+{
+  public:
+    explicit module_data(Napi::Env env);
+
+    Napi::String string(js_name name) const
+    {
+        return strings_[static_cast<std::size_t>(name)].Value();
+    }
+
+  private:
+    std::array<Napi::Reference<Napi::String>, NUM_JS_NAMES> strings_;
+};
+
+// Sets up the module_data of `env`; called once by the init function of the
+// module for each environment it is loaded in.
+void init_module_data(Napi::Env env);
+
+// The string of `name` in `env`
+Napi::String js_string(Napi::Env env, js_name name);
+
+} // namespace vtile
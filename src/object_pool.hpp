@@ -0,0 +1,57 @@
+#pragma once
+
+// stl
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace vtile {
+
+// Objects of type T kept for reuse by a single thread, so that the objects
+// made for every call (the batons of calls) reuse their memory and the
+// capacity of their vectors instead of being allocated again. T must be
+// default-constructible and have a reset() putting it back into the state of
+// a new object.
+template <typename T>
+class object_pool
+{
+  public:
+    // keeps up to `max_size` free objects
+    explicit object_pool(std::size_t max_size)
+        : max_size_{max_size}
+    {
+    }
+
+    // a free object, or a new one if there is none
+    std::unique_ptr<T> acquire()
+    {
+        if (free_.empty())
+        {
+            return std::make_unique<T>();
+        }
+        std::unique_ptr<T> object = std::move(free_.back());
+        free_.pop_back();
+        return object;
+    }
+
+    // resets `object` and keeps it for acquire(), unless the pool is full
+    void release(std::unique_ptr<T> object)
+    {
+        if (!object)
+        {
+            return;
+        }
+        object->reset();
+        if (free_.size() < max_size_)
+        {
+            free_.push_back(std::move(object));
+        }
+    }
+
+  private:
+    std::vector<std::unique_ptr<T>> free_{};
+    std::size_t max_size_;
+};
+
+} // namespace vtile
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "allocations.hpp"
+#include "thread_pool.hpp"
+// stl
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace vtile {
+
+// The most threads a parallel_for on `pool` (or on short-lived threads, if
+// null) uses: the threads of the pool, or else the number of hardware threads.
+inline std::size_t max_threads(thread_pool const* pool)
+{
+    if (pool != nullptr)
+    {
+        return pool->size();
+    }
+    std::size_t const hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? hardware : 1;
+}
+
+// Calls func(i) for every i in [0, count) using up to num_threads threads,
+// the calling thread included. The extra threads are tasks of `pool` when one
+// is given (inheriting the lane of the calling task) and short-lived threads
+// otherwise. Indices are handed out in order through a shared counter, so the
+// call never waits for a helper that has not started yet.
+//
+// The first exception thrown by func is rethrown on the calling thread once
+// all started calls have finished; the remaining indices are skipped.
+// Allocations of the helpers count towards the allocation counter of the
+// calling thread (see allocations.hpp). num_threads is capped by
+// max_threads(pool).
+template <typename Func>
+void parallel_for(std::size_t count, std::size_t num_threads, Func&& func, thread_pool* pool = nullptr)
+{
+    num_threads = std::min({num_threads, count, max_threads(pool)});
+    if (num_threads <= 1)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    struct shared_state
+    {
+        std::atomic<std::size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::mutex mutex{};
+        std::condition_variable all_done{};
+        std::size_t done = 0; // guarded by mutex
+        std::exception_ptr error{};
+    };
+    auto state = std::make_shared<shared_state>();
+    // Helpers that start after every index was handed out never touch func,
+    // so it is safe for them to outlive this call.
+    auto* task = &func;
+    allocation_counter* const counter = current_allocation_counter();
+    auto run = [state, task, count, counter]() {
+        allocation_scope const scope{counter};
+        for (std::size_t i = state->next.fetch_add(1); i < count; i = state->next.fetch_add(1))
+        {
+            std::exception_ptr error;
+            if (!state->failed)
+            {
+                try
+                {
+                    (*task)(i);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                    state->failed = true;
+                }
+            }
+            std::lock_guard<std::mutex> lock{state->mutex};
+            if (error && !state->error)
+            {
+                state->error = error;
+            }
+            if (++state->done == count)
+            {
+                state->all_done.notify_all();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    if (pool != nullptr)
+    {
+        for (std::size_t t = 1; t < num_threads; ++t)
+        {
+            pool->submit(run);
+        }
+    }
+    else
+    {
+        threads.reserve(num_threads - 1);
+        try
+        {
+            for (std::size_t t = 1; t < num_threads; ++t)
+            {
+                threads.emplace_back(run);
+            }
+        }
+        // LCOV_EXCL_START
+        catch (std::system_error const&)
+        {
+            // could not spawn all threads: carry on with the ones we have
+        }
+        // LCOV_EXCL_STOP
+    }
+    run();
+    {
+        std::unique_lock<std::mutex> lock{state->mutex};
+        state->all_done.wait(lock, [&state, count]() { return state->done == count; });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    if (state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
+
+} // namespace vtile
@@ -0,0 +1,147 @@
+#pragma once
+
+// geometry.hpp
+#include <mapbox/geometry/line_string.hpp>
+#include <mapbox/geometry/point.hpp>
+#include <mapbox/geometry/polygon.hpp>
+// stl
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace vtile {
+
+// A vertex of a ring being clipped, with the segment of the source ring that
+// the edge leading to it lies on (see clip_ring)
+template <typename CoordinateType>
+struct traced_point
+{
+    mapbox::geometry::point<CoordinateType> point;
+    std::size_t segment;
+};
+
+// Per-thread pool of the geometry containers that overzooming fills for every
+// feature and throws away once the feature is encoded.
+//
+// Containers handed back with recycle() are cleared but keep their capacity,
+// and take_*() hands them out again, so clipping a feature does not allocate
+// once the pool has warmed up. The pool lives as long as its thread, that is
+// across tasks; containers grown beyond max_points (and spares beyond
+// max_spares) are freed instead of being kept, which bounds what a thread
+// holds on to after an unusually large feature.
+template <typename CoordinateType>
+class scratch_pool
+{
+  public:
+    using point_type = mapbox::geometry::point<CoordinateType>;
+    using line_string_type = mapbox::geometry::line_string<CoordinateType>;
+    using ring_type = mapbox::geometry::linear_ring<CoordinateType>;
+    using polygon_type = mapbox::geometry::polygon<CoordinateType>;
+    using vertex_type = traced_point<CoordinateType>;
+
+    static constexpr std::size_t max_points = 1U << 16U;
+    static constexpr std::size_t max_spares = 1U << 12U;
+
+    // the pool of the calling thread
+    static scratch_pool& local()
+    {
+        thread_local scratch_pool pool;
+        return pool;
+    }
+
+    line_string_type take_line()
+    {
+        return take(lines_);
+    }
+
+    ring_type take_ring()
+    {
+        return take(rings_);
+    }
+
+    polygon_type take_polygon()
+    {
+        return take(polygons_);
+    }
+
+    void recycle(line_string_type& line)
+    {
+        keep(lines_, line, max_points);
+    }
+
+    void recycle(ring_type& ring)
+    {
+        keep(rings_, ring, max_points);
+    }
+
+    void recycle(polygon_type& polygon)
+    {
+        for (auto& ring : polygon)
+        {
+            recycle(ring);
+        }
+        keep(polygons_, polygon, max_spares);
+    }
+
+    // recycles every geometry of `geometries` and clears it
+    template <typename Geometry>
+    void recycle_all(std::vector<Geometry>& geometries)
+    {
+        for (auto& geometry : geometries)
+        {
+            recycle(geometry);
+        }
+        geometries.clear();
+    }
+
+    // Two vertex buffers for algorithms working back and forth between them
+    // (see clip_ring). Only valid until the next call on the same thread.
+    std::pair<std::vector<vertex_type>&, std::vector<vertex_type>&> vertex_buffers()
+    {
+        trim(buffer_a_);
+        trim(buffer_b_);
+        buffer_a_.clear();
+        buffer_b_.clear();
+        return {buffer_a_, buffer_b_};
+    }
+
+  private:
+    template <typename Container>
+    static Container take(std::vector<Container>& spares)
+    {
+        if (spares.empty())
+        {
+            return Container{};
+        }
+        Container container = std::move(spares.back());
+        spares.pop_back();
+        return container;
+    }
+
+    template <typename Container>
+    static void keep(std::vector<Container>& spares, Container& container, std::size_t max_capacity)
+    {
+        if (container.capacity() == 0 || container.capacity() > max_capacity || spares.size() >= max_spares)
+        {
+            return;
+        }
+        container.clear();
+        spares.push_back(std::move(container));
+    }
+
+    static void trim(std::vector<vertex_type>& buffer)
+    {
+        if (buffer.capacity() > max_points)
+        {
+            std::vector<vertex_type>{}.swap(buffer);
+        }
+    }
+
+    std::vector<line_string_type> lines_{};
+    std::vector<ring_type> rings_{};
+    std::vector<polygon_type> polygons_{};
+    std::vector<vertex_type> buffer_a_{};
+    std::vector<vertex_type> buffer_b_{};
+};
+
+} // namespace vtile
@@ -0,0 +1,110 @@
+#pragma once
+
+// stl
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <string>
+
+namespace vtile {
+
+// Time spent in a phase of a call, summed over the threads working on it.
+struct phase_time
+{
+    std::atomic<std::uint64_t> wall_ns{0}; // steady clock
+    std::atomic<std::uint64_t> cpu_ns{0};  // thread CPU clock
+};
+
+struct layer_stats
+{
+    std::string name{};
+    bool overzoomed = false;
+    bool cached = false;        // taken from the layer cache
+    std::uint64_t bytes_in = 0; // size of the layer in its source tile
+    std::uint64_t features_in = 0;
+    std::uint64_t features_out = 0;
+    std::uint64_t vertices_in = 0;
+    std::uint64_t vertices_out = 0;
+    std::uint64_t skipped = 0;       // version 1 features skipped for malformed geometry
+    std::uint64_t dropped = 0;       // features dropped to fit in the max_bytes option
+    std::uint64_t properties_ns = 0; // steady clock time spent mapping properties
+};
+
+// Performance counters of a composite, compositeBatch or localize call,
+// collected when its `stats` option is set. Code paths take a pointer to
+// them, which is null when the option is not set.
+struct call_stats
+{
+    phase_time decompress{};
+    phase_time overzoom{}; // decoding, clipping and encoding overzoomed layers
+    phase_time localize{};
+    phase_time serialize{};
+    phase_time compress{};
+    std::uint64_t bytes_in = 0;
+    std::uint64_t bytes_out = 0;
+    std::uint64_t bytes_dropped = 0; // by dropping features, before compression
+    std::deque<layer_stats> layers{}; // in output order; elements never move
+};
+
+inline std::uint64_t steady_ns()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+}
+
+inline std::uint64_t thread_cpu_ns()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000U + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+// Adds the time between its construction and destruction to a phase_time, on
+// both clocks. Does nothing (and reads no clock) if the phase_time is null.
+class phase_timer
+{
+  public:
+    explicit phase_timer(phase_time* time)
+        : time_{time},
+          wall_start_{time != nullptr ? steady_ns() : 0},
+          cpu_start_{time != nullptr ? thread_cpu_ns() : 0} {}
+
+    ~phase_timer()
+    {
+        stop();
+    }
+
+    // ends the phase before the timer goes out of scope
+    void stop()
+    {
+        if (time_ != nullptr)
+        {
+            time_->wall_ns += steady_ns() - wall_start_;
+            time_->cpu_ns += thread_cpu_ns() - cpu_start_;
+            time_ = nullptr;
+        }
+    }
+
+    // non-copyable
+    phase_timer(phase_timer const&) = delete;
+    phase_timer& operator=(phase_timer const&) = delete;
+    // non-movable
+    phase_timer(phase_timer&&) = delete;
+    phase_timer& operator=(phase_timer&&) = delete;
+
+  private:
+    phase_time* time_;
+    std::uint64_t const wall_start_;
+    std::uint64_t const cpu_start_;
+};
+
+// the phase `member` of `stats`, or null if stats are not collected
+inline phase_time* phase(call_stats* stats, phase_time call_stats::*member)
+{
+    return stats != nullptr ? &(stats->*member) : nullptr;
+}
+
+} // namespace vtile
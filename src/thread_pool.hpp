@@ -0,0 +1,217 @@
+#pragma once
+
+// stl
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vtile {
+
+enum class priority : std::uint8_t
+{
+    interactive = 0, // map requests: always taken first
+    bulk = 1         // seeding and other background jobs
+};
+
+constexpr std::size_t NUM_PRIORITIES = 2;
+
+// A fixed-size pool of threads with one deque per thread and per priority lane.
+//
+// Tasks submitted from outside the pool are spread round-robin over the
+// threads; tasks submitted from a pool thread go to that thread's own deque
+// and inherit the lane of the task that submitted them. A thread takes tasks
+// from the front of its own deques and, once these are empty, steals from the
+// back of the other threads' deques. Interactive tasks anywhere in the pool are
+// taken before any bulk task.
+//
+// The destructor runs all tasks that are still queued before joining.
+class thread_pool
+{
+  public:
+    using task_type = std::function<void()>;
+
+    explicit thread_pool(std::size_t num_threads)
+    {
+        if (num_threads == 0)
+        {
+            num_threads = 1;
+        }
+        queues_.reserve(num_threads);
+        for (std::size_t i = 0; i < num_threads; ++i)
+        {
+            queues_.push_back(std::make_unique<worker_queue>());
+        }
+        threads_.reserve(num_threads);
+        try
+        {
+            for (std::size_t i = 0; i < num_threads; ++i)
+            {
+                threads_.emplace_back([this, i]() { run(i); });
+            }
+        }
+        // LCOV_EXCL_START
+        catch (...)
+        {
+            shutdown();
+            throw;
+        }
+        // LCOV_EXCL_STOP
+    }
+
+    ~thread_pool()
+    {
+        shutdown();
+    }
+
+    // non-copyable
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+    // non-movable
+    thread_pool(thread_pool&&) = delete;
+    thread_pool& operator=(thread_pool&&) = delete;
+
+    std::size_t size() const noexcept
+    {
+        return threads_.size();
+    }
+
+    void submit(task_type task, priority lane)
+    {
+        worker_context const& context = current();
+        std::size_t const target = context.pool == this ? context.index : next_queue_.fetch_add(1) % queues_.size();
+        {
+            std::lock_guard<std::mutex> lock{queues_[target]->mutex};
+            queues_[target]->lanes[static_cast<std::size_t>(lane)].push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock{sleep_mutex_};
+            ++pending_;
+        }
+        wake_.notify_one();
+    }
+
+    // submits with the lane of the task running on the calling thread
+    // (interactive when not called from a task of this pool)
+    void submit(task_type task)
+    {
+        worker_context const& context = current();
+        submit(std::move(task), context.pool == this ? context.lane : priority::interactive);
+    }
+
+  private:
+    struct worker_queue
+    {
+        std::mutex mutex{};
+        std::deque<task_type> lanes[NUM_PRIORITIES]{};
+    };
+
+    struct worker_context
+    {
+        thread_pool const* pool;
+        std::size_t index;
+        priority lane;
+    };
+
+    void shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock{sleep_mutex_};
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    static worker_context& current()
+    {
+        static thread_local worker_context context{nullptr, 0, priority::interactive};
+        return context;
+    }
+
+    bool try_pop(std::size_t self, task_type& task, priority& lane)
+    {
+        std::size_t const num_queues = queues_.size();
+        for (std::size_t l = 0; l < NUM_PRIORITIES; ++l)
+        {
+            for (std::size_t offset = 0; offset < num_queues; ++offset)
+            {
+                worker_queue& queue = *queues_[(self + offset) % num_queues];
+                std::lock_guard<std::mutex> lock{queue.mutex};
+                auto& tasks = queue.lanes[l];
+                if (tasks.empty())
+                {
+                    continue;
+                }
+                if (offset == 0)
+                {
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                else
+                {
+                    task = std::move(tasks.back());
+                    tasks.pop_back();
+                }
+                lane = static_cast<priority>(l);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(std::size_t self)
+    {
+        worker_context& context = current();
+        context.pool = this;
+        context.index = self;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock{sleep_mutex_};
+                wake_.wait(lock, [this]() { return pending_ > 0 || stop_; });
+                if (pending_ == 0)
+                {
+                    return; // stopped and drained
+                }
+                // claims one of the queued tasks; it is guaranteed to be in one of the
+                // deques, but another thread may be holding that deque's lock right now
+                --pending_;
+            }
+            task_type task;
+            while (!try_pop(self, task, context.lane))
+            {
+                std::this_thread::yield();
+            }
+            try
+            {
+                task();
+            }
+            // LCOV_EXCL_START
+            catch (...)
+            {
+                // tasks report their own errors
+            }
+            // LCOV_EXCL_STOP
+        }
+    }
+
+    std::vector<std::unique_ptr<worker_queue>> queues_{};
+    std::vector<std::thread> threads_{};
+    std::mutex sleep_mutex_{};
+    std::condition_variable wake_{};
+    std::size_t pending_ = 0; // guarded by sleep_mutex_
+    bool stop_ = false;       // guarded by sleep_mutex_
+    std::atomic<std::size_t> next_queue_{0};
+};
+
+} // namespace vtile
@@ -0,0 +1,149 @@
+#include "tile_cache.hpp"
+
+// stl
+#include <cstring>
+
+namespace vtile {
+
+namespace {
+
+constexpr std::uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+inline std::uint64_t rotl(std::uint64_t x, unsigned r)
+{
+    return (x << r) | (x >> (64U - r));
+}
+
+// reads in native byte order: keys never leave the process
+inline std::uint64_t read64(char const* p)
+{
+    std::uint64_t value = 0;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline std::uint32_t read32(char const* p)
+{
+    std::uint32_t value = 0;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline std::uint64_t xxh_round(std::uint64_t acc, std::uint64_t input)
+{
+    acc += input * PRIME64_2;
+    acc = rotl(acc, 31);
+    return acc * PRIME64_1;
+}
+
+inline std::uint64_t merge_round(std::uint64_t acc, std::uint64_t value)
+{
+    acc ^= xxh_round(0, value);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+} // namespace
+
+lru_cache<std::vector<char>>& tile_cache()
+{
+    static lru_cache<std::vector<char>> cache;
+    return cache;
+}
+
+lru_cache<std::string>& layer_cache()
+{
+    static lru_cache<std::string> cache;
+    return cache;
+}
+
+std::uint64_t hash_bytes(char const* data, std::size_t size)
+{
+    char const* p = data;
+    char const* const end = data + size;
+    std::uint64_t h = 0;
+    if (size >= 32)
+    {
+        std::uint64_t v1 = PRIME64_1 + PRIME64_2;
+        std::uint64_t v2 = PRIME64_2;
+        std::uint64_t v3 = 0;
+        std::uint64_t v4 = 0 - PRIME64_1;
+        char const* const limit = end - 32;
+        do
+        {
+            v1 = xxh_round(v1, read64(p));
+            v2 = xxh_round(v2, read64(p + 8));
+            v3 = xxh_round(v3, read64(p + 16));
+            v4 = xxh_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    }
+    else
+    {
+        h = PRIME64_5;
+    }
+    h += size;
+    while (p + 8 <= end)
+    {
+        h ^= xxh_round(0, read64(p));
+        h = rotl(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= std::uint64_t{read32(p)} * PRIME64_1;
+        h = rotl(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        h ^= std::uint64_t{static_cast<unsigned char>(*p)} * PRIME64_5;
+        h = rotl(h, 11) * PRIME64_1;
+        ++p;
+    }
+    h ^= h >> 33U;
+    h *= PRIME64_2;
+    h ^= h >> 29U;
+    h *= PRIME64_3;
+    h ^= h >> 32U;
+    return h;
+}
+
+std::string tile_cache_key(std::string const& id, char const* data, std::size_t size)
+{
+    if (!id.empty())
+    {
+        return "id:" + id;
+    }
+    // '#' followed by the raw bytes of the hash and size: never an id key
+    std::string key(1 + 2 * sizeof(std::uint64_t), '#');
+    std::uint64_t const hash = hash_bytes(data, size);
+    std::uint64_t const length = size;
+    std::memcpy(&key[1], &hash, sizeof(hash));
+    std::memcpy(&key[1 + sizeof(hash)], &length, sizeof(length));
+    return key;
+}
+
+std::string layer_cache_key(std::string const& source_key, std::uint32_t source_z, std::string const& layer_name,
+                            std::uint32_t z, std::uint32_t x, std::uint32_t y, int buffer_size)
+{
+    // fixed-size fields first, then the length of the source key, so that
+    // the variable-length parts can't run into each other
+    std::uint32_t const fields[] = {source_z, z, x, y, static_cast<std::uint32_t>(buffer_size),
+                                    static_cast<std::uint32_t>(source_key.size())};
+    std::string key(sizeof(fields), '\0');
+    std::memcpy(&key[0], fields, sizeof(fields));
+    key += source_key;
+    key += layer_name;
+    return key;
+}
+
+} // namespace vtile
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "lru_cache.hpp"
+// stl
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vtile {
+
+// Process-wide cache of decompressed source tiles, so that a popular source
+// overzoomed into many targets is only decompressed once rather than once per
+// request. Disabled until a budget is set with
+// configure({ tile_cache_size }).
+lru_cache<std::vector<char>>& tile_cache();
+
+// Process-wide cache of overzoomed layers, each serialized as a single-layer
+// tile, so that a source layer overzoomed into the same target by different
+// requests is only clipped once. Disabled until a budget is set with
+// configure({ layer_cache_size }).
+lru_cache<std::string>& layer_cache();
+
+// 64-bit hash of `data` (XXH64 with seed 0).
+std::uint64_t hash_bytes(char const* data, std::size_t size);
+
+// The key of a source tile in tile_cache() and layer_cache_key(): the id
+// supplied by the caller if there is one, otherwise the hash and size of its
+// bytes as given (compressed or not).
+std::string tile_cache_key(std::string const& id, char const* data, std::size_t size);
+
+// The key in layer_cache() of the layer `layer_name` of a source tile at zoom
+// `source_z` with key `source_key` (see tile_cache_key), overzoomed into the
+// tile z/x/y with `buffer_size`.
+std::string layer_cache_key(std::string const& source_key, std::uint32_t source_z, std::string const& layer_name,
+                            std::uint32_t z, std::uint32_t x, std::uint32_t y, int buffer_size);
+
+} // namespace vtile
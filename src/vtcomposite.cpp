@@ -1,12 +1,21 @@
 // vtcomposite
 #include "vtcomposite.hpp"
+#include "allocations.hpp"
+#include "cancellation.hpp"
+#include "codec.hpp"
+#include "drop_features.hpp"
 #include "feature_builder.hpp"
+#include "feature_localizer.hpp"
+#include "localize_keys.hpp"
+#include "memory_budget.hpp"
+#include "module_data.hpp"
+#include "object_pool.hpp"
 #include "module_utils.hpp"
+#include "parallel.hpp"
+#include "stats.hpp"
+#include "tile_cache.hpp"
+#include "worker.hpp"
 #include "zxy_math.hpp"
-// gzip-hpp
-#include <gzip/compress.hpp>
-#include <gzip/decompress.hpp>
-#include <gzip/utils.hpp>
 // vtzero
 #include <vtzero/builder.hpp>
 #include <vtzero/encoded_property_value.hpp>
@@ -18,8 +27,14 @@
 #include <mapbox/geometry/point.hpp>
 // stl
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <sstream>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -34,13 +49,15 @@ struct TileObject
                std::uint32_t x0,
                std::uint32_t y0,
                Napi::Buffer<char> const& buffer,
-               std::vector<std::string> layers0)
+               std::vector<std::string> layers0,
+               std::string id0)
         : z{z0},
           x{x0},
           y{y0},
           data{buffer.Data(), buffer.Length()},
           buffer_ref{Napi::Persistent(buffer)},
-          layers{std::move(layers0)}
+          layers{std::move(layers0)},
+          id{std::move(id0)}
     {
     }
 
@@ -68,15 +85,62 @@ struct TileObject
     vtzero::data_view data;
     Napi::Reference<Napi::Buffer<char>> buffer_ref;
     std::vector<std::string> layers;
+    std::string id; // key of the tile in the tile cache, if not empty
 };
 
-struct BatonType
+// Cancels a call on the abort event of its `signal` option (an AbortSignal),
+// and stops listening once the call is done.
+struct AbortListener
 {
-    explicit BatonType(std::size_t num_tiles)
+    AbortListener(Napi::Object const& signal, std::shared_ptr<std::atomic<bool>> flag)
+    {
+        Napi::Env env = signal.Env();
+        Napi::Function listener = Napi::Function::New(env, [flag](Napi::CallbackInfo const& /*unused*/) {
+            flag->store(true, std::memory_order_relaxed);
+        });
+        signal.Get(js_string(env, js_name::add_event_listener)).As<Napi::Function>().Call(signal, {js_string(env, js_name::abort), listener});
+        signal_ref = Napi::Persistent(signal);
+        listener_ref = Napi::Persistent(listener);
+    }
+
+    ~AbortListener() noexcept
     {
-        tiles.reserve(num_tiles);
+        try
+        {
+            Napi::Env env = signal_ref.Env();
+            Napi::HandleScope scope{env};
+            Napi::Object signal = signal_ref.Value();
+            signal.Get(js_string(env, js_name::remove_event_listener)).As<Napi::Function>().Call(signal, {js_string(env, js_name::abort), listener_ref.Value()});
+            signal_ref.Reset();
+            listener_ref.Reset();
+        }
+        catch (...)
+        {
+        }
     }
 
+    // non-copyable
+    AbortListener(AbortListener const&) = delete;
+    AbortListener& operator=(AbortListener const&) = delete;
+    // non-movable
+    AbortListener(AbortListener&&) = delete;
+    AbortListener& operator=(AbortListener&&) = delete;
+
+    Napi::ObjectReference signal_ref{};
+    Napi::FunctionReference listener_ref{};
+};
+
+// an output tile
+struct TargetTile
+{
+    std::uint32_t z;
+    std::uint32_t x;
+    std::uint32_t y;
+};
+
+struct BatonType
+{
+    BatonType() = default;
     ~BatonType() = default;
     // non-copyable
     BatonType(BatonType const&) = delete;
@@ -91,38 +155,78 @@ struct BatonType
     std::uint32_t x{};
     std::uint32_t y{};
     int buffer_size = 0;
-    bool compress = false;
+    vtile::compression_options compression{};
+    std::uint32_t threads = 1;
+    vtile::priority lane = vtile::priority::interactive;
+    bool stats = false;
+    std::unique_ptr<vtile::localize_options> localize{}; // localizes the output tile if set
+    vtile::drop_options drop{};                          // drops features past drop.max_bytes if set
+    vtile::cancellation cancel{};
+    std::unique_ptr<AbortListener> abort_listener{}; // set by the `signal` option
+
+    // back to the state of a new baton, keeping the capacity of `tiles`; on the
+    // JS thread, as it releases the references to the source buffers
+    void reset()
+    {
+        tiles.clear();
+        z = 0;
+        x = 0;
+        y = 0;
+        buffer_size = 0;
+        compression = vtile::compression_options{};
+        threads = 1;
+        lane = vtile::priority::interactive;
+        stats = false;
+        localize.reset();
+        drop = vtile::drop_options{};
+        abort_listener.reset();
+        cancel = vtile::cancellation{};
+    }
 };
 
-struct LocalizeBatonType
+// The languages and worldviews of one output of localizeBatch
+struct LocalizeVariant
 {
-    LocalizeBatonType(Napi::Buffer<char> const& buffer,
-                      std::string hidden_prefix_,
-                      std::vector<std::string> omit_scripts_,
-                      std::vector<std::string> languages_,
-                      std::string language_property_,
-                      std::vector<std::string> worldviews_,
-                      std::string worldview_property_,
-                      std::string class_property_,
-                      bool return_localized_tile_,
-                      bool compress_)
-        : data{buffer.Data(), buffer.Length()},
-          buffer_ref{Napi::Persistent(buffer)},
-          hidden_prefix{std::move(hidden_prefix_)},
-          omit_scripts{std::move(omit_scripts_)},
-          languages{std::move(languages_)},
-          language_property{std::move(language_property_)},
-          worldviews{std::move(worldviews_)},
-          worldview_property{std::move(worldview_property_)},
-          class_property{std::move(class_property_)},
-          return_localized_tile{return_localized_tile_},
-          compress{compress_}
+    std::vector<std::string> languages{};
+    std::vector<std::string> worldviews{};
+    bool return_localized_tile = false;
+};
+
+// The params of localize that say how features are localized; also the
+// `localize` option of composite
+struct LocalizeSettings
+{
+    std::string hidden_prefix = "_mbx_";
+    std::vector<std::string> omit_scripts{}; // default is undefined
+    std::vector<std::string> languages{};    // default is undefined
+    std::string language_property = "name";
+    std::vector<std::string> worldviews{}; // default is undefined
+    std::string worldview_property = "worldview";
+    std::string worldview_default = "US";
+    std::string class_property = "class";
+    // deduced from the other params: true only if languages or worldviews
+    // exist. It alone dictates whether a localized or non-localized tile is
+    // returned; the existence and value of languages and worldviews does not
+    // matter.
+    bool return_localized_tile = false;
+
+    vtile::localize_options options(std::vector<std::string> const& languages_,
+                                    std::vector<std::string> const& worldviews_,
+                                    bool localized) const
+    {
+        return vtile::make_localize_options(hidden_prefix, omit_scripts, languages_, language_property,
+                                            worldviews_, worldview_property, class_property, localized);
+    }
+
+    vtile::localize_options options() const
     {
-        // Note: for LocalizeBatonType, return_localized_tile_ dictates whether it
-        // will return a localized or non-localized tile; the existence and value of
-        // languages_ and worldviews_ does not matter.
+        return options(languages, worldviews, return_localized_tile);
     }
+};
 
+struct LocalizeBatonType
+{
+    LocalizeBatonType() = default;
     ~LocalizeBatonType() noexcept
     {
         try
@@ -141,29 +245,72 @@ struct LocalizeBatonType
     LocalizeBatonType& operator=(LocalizeBatonType&&) = delete;
 
     // members
-    vtzero::data_view data;
-    Napi::Reference<Napi::Buffer<char>> buffer_ref;
-    std::string hidden_prefix;
-    std::vector<std::string> omit_scripts;
-    std::vector<std::string> languages;
-    std::string language_property;
-    std::vector<std::string> worldviews;
-    std::string worldview_property;
-    std::string class_property;
-    bool return_localized_tile;
-    bool compress;
+    vtzero::data_view data{};
+    Napi::Reference<Napi::Buffer<char>> buffer_ref{};
+    LocalizeSettings settings{};
+    vtile::compression_options compression{};
+    std::vector<LocalizeVariant> variants{}; // set by localizeBatch, in place of languages and worldviews
+    vtile::priority lane = vtile::priority::interactive;
+    bool stats = false;
+    vtile::cancellation cancel{};
+    std::unique_ptr<AbortListener> abort_listener{}; // set by params.signal
+
+    // back to the state of a new baton, keeping the capacity of `variants`;
+    // on the JS thread, as it releases the reference to the buffer
+    void reset()
+    {
+        buffer_ref.Reset();
+        data = vtzero::data_view{};
+        settings = LocalizeSettings{};
+        compression = vtile::compression_options{};
+        variants.clear();
+        lane = vtile::priority::interactive;
+        stats = false;
+        abort_listener.reset();
+        cancel = vtile::cancellation{};
+    }
 };
 
 namespace {
 
+// the most batons of each type kept for reuse by a JS thread
+constexpr std::size_t MAX_POOLED_BATONS = 256;
+
+// The batons of the calls made on this JS thread (the main thread or a worker
+// thread), taken by each call and handed back by its worker once the callback
+// returns, so that calls reuse their memory.
+template <typename Baton>
+vtile::object_pool<Baton>& baton_pool()
+{
+    thread_local vtile::object_pool<Baton> pool{MAX_POOLED_BATONS};
+    return pool;
+}
+
+// Hands `baton` back to baton_pool(); called by the destructor of workers.
+template <typename Baton>
+void release_baton(std::unique_ptr<Baton>& baton) noexcept
+{
+    try
+    {
+        baton_pool<Baton>().release(std::move(baton));
+    }
+    catch (...)
+    {
+    }
+}
+
 template <typename FeatureBuilder>
 struct build_feature_from_v1
 {
-    explicit build_feature_from_v1(FeatureBuilder& builder)
-        : builder_(builder) {}
+    explicit build_feature_from_v1(FeatureBuilder& builder, std::uint64_t* skipped = nullptr,
+                                   vtile::cancellation const* cancel = nullptr)
+        : builder_(builder),
+          skipped_(skipped),
+          cancel_(cancel) {}
 
     bool operator()(vtzero::feature const& feature)
     {
+        vtile::check(cancel_);
         try
         {
             builder_.apply(feature);
@@ -171,306 +318,280 @@ struct build_feature_from_v1
         catch (vtzero::geometry_exception const& ex)
         {
             std::cerr << "Skipping feature with malformed geometry (v1): " << ex.what() << std::endl;
+            if (skipped_ != nullptr)
+            {
+                ++*skipped_;
+            }
         }
         return true;
     }
     FeatureBuilder& builder_;
+    std::uint64_t* skipped_;            // counts skipped features if set
+    vtile::cancellation const* cancel_; // checked before each feature if set
 };
 
 template <typename FeatureBuilder>
 struct build_feature_from_v2
 {
-    explicit build_feature_from_v2(FeatureBuilder& builder)
-        : builder_(builder) {}
+    explicit build_feature_from_v2(FeatureBuilder& builder, vtile::cancellation const* cancel = nullptr)
+        : builder_(builder),
+          cancel_(cancel) {}
 
     bool operator()(vtzero::feature const& feature)
     {
+        vtile::check(cancel_);
         builder_.apply(feature);
         return true;
     }
     FeatureBuilder& builder_;
+    vtile::cancellation const* cancel_; // checked before each feature if set
 };
 
-} // namespace
-
-struct CompositeWorker : Napi::AsyncWorker
+// "interactive" (the default) or "bulk"
+bool parse_priority(Napi::Value const& value, vtile::priority& lane)
 {
-    using Base = Napi::AsyncWorker;
-
-    CompositeWorker(std::unique_ptr<BatonType>&& baton_data, Napi::Function& cb)
-        : Base(cb),
-          baton_data_{std::move(baton_data)},
-          output_buffer_{std::make_unique<std::string>()} {}
+    if (!value.IsString())
+    {
+        return false;
+    }
+    std::string const name = value.As<Napi::String>();
+    if (name == "interactive")
+    {
+        lane = vtile::priority::interactive;
+        return true;
+    }
+    if (name == "bulk")
+    {
+        lane = vtile::priority::bulk;
+        return true;
+    }
+    return false;
+}
 
-    void Execute() override
+// Reads the `deadline_ms` and `signal` options of a call into `cancel`,
+// listening to the signal through `listener`. Errors name the options
+// `deadline_name` and `signal_name`. Returns an error message, or an empty
+// string.
+std::string parse_cancellation(Napi::Object const& options, std::string const& deadline_name, std::string const& signal_name,
+                               vtile::cancellation& cancel, std::unique_ptr<AbortListener>& listener)
+{
+    Napi::Env env = options.Env();
+    if (options.Has(js_string(env, js_name::deadline_ms)))
     {
-        try
+        Napi::Value deadline_value = options.Get(js_string(env, js_name::deadline_ms));
+        if (!deadline_value.IsNumber())
         {
-            vtzero::tile_builder builder;
-            std::vector<vtzero::data_view> names;
-
-            int const buffer_size = baton_data_->buffer_size;
-            std::uint32_t const target_z = baton_data_->z;
-            std::uint32_t const target_x = baton_data_->x;
-            std::uint32_t const target_y = baton_data_->y;
-
-            std::vector<std::unique_ptr<std::vector<char>>> buffer_cache;
-
-            for (auto const& tile_obj : baton_data_->tiles)
-            {
-                if (vtile::within_target(*tile_obj, target_z, target_x, target_y))
-                {
-                    vtzero::data_view tile_view{};
-                    if (gzip::is_compressed(tile_obj->data.data(), tile_obj->data.size()))
-                    {
-                        buffer_cache.push_back(std::make_unique<std::vector<char>>());
-                        gzip::Decompressor decompressor;
-                        decompressor.decompress(*buffer_cache.back(), tile_obj->data.data(), tile_obj->data.size());
-                        tile_view = protozero::data_view{buffer_cache.back()->data(), buffer_cache.back()->size()};
-                    }
-                    else
-                    {
-                        tile_view = tile_obj->data;
-                    }
-
-                    std::uint32_t zoom_factor = 1U << (target_z - tile_obj->z);
-                    std::vector<std::string> include_layers = tile_obj->layers;
-                    vtzero::vector_tile tile{tile_view};
-                    while (auto layer = tile.next_layer())
-                    {
-                        vtzero::data_view const name = layer.name();
-                        std::uint32_t const version = layer.version();
-                        if (std::find(names.begin(), names.end(), name) == names.end())
-                        {
-                            // should we keep this layer?
-                            // if include_layers is empty, keep all layers
-                            // if include_layers is not empty, keep layer if we can find its name in the vector
-                            std::string sname(name);
-                            if (include_layers.empty() || std::find(include_layers.begin(), include_layers.end(), sname) != include_layers.end())
-                            {
-                                names.push_back(name);
-                                std::uint32_t extent = layer.extent();
-                                if (zoom_factor == 1)
-                                {
-                                    builder.add_existing_layer(layer);
-                                }
-                                else
-                                {
-                                    using coordinate_type = std::int64_t;
-                                    using feature_builder_type = vtile::overzoomed_feature_builder<coordinate_type>;
-                                    vtzero::layer_builder layer_builder{builder, name, version, extent};
-                                    vtzero::property_mapper mapper{layer, layer_builder};
-                                    std::uint32_t dx = 0;
-                                    std::uint32_t dy = 0;
-                                    std::tie(dx, dy) = vtile::displacement(tile_obj->z, extent, target_z, target_x, target_y);
-                                    mapbox::geometry::box<coordinate_type> bbox{{-buffer_size, -buffer_size},
-                                                                                {static_cast<int>(extent) + buffer_size,
-                                                                                 static_cast<int>(extent) + buffer_size}};
-                                    feature_builder_type f_builder{layer_builder, mapper, bbox, dx, dy, zoom_factor};
-                                    if (version == MVT_VERSION_1)
-                                    {
-                                        layer.for_each_feature(build_feature_from_v1<feature_builder_type>(f_builder));
-                                    }
-                                    else
-                                    {
-                                        layer.for_each_feature(build_feature_from_v2<feature_builder_type>(f_builder));
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-                else
-                {
-                    std::ostringstream os;
-                    os << "Invalid tile composite request: SOURCE("
-                       << tile_obj->z << "," << tile_obj->x << "," << tile_obj->y << ")"
-                       << " TARGET(" << target_z << "," << target_x << "," << target_y << ")";
-                    SetError(os.str());
-                    return;
-                }
-            }
-
-            std::string& tile_buffer = *output_buffer_;
-            if (baton_data_->compress)
-            {
-                std::string temp;
-                builder.serialize(temp);
-
-                // If the serialized buffer is an empty string, do not
-                // gzip compress it. This will lead to a non-zero byte string
-                // which can be perceived as a valid vector tile.
-                //
-                // Instead do nothing and return an empty, non-gzip-compressed buffer.
-                // If the user wants to handle empty tiles separately from non-empty
-                // tiles, they must check "buffer.length > 0" in the resulting callback.
-                if (!temp.empty())
-                {
-                    tile_buffer = gzip::compress(temp.data(), temp.size());
-                }
-            }
-            else
-            {
-                builder.serialize(tile_buffer);
-            }
+            return deadline_name + " must be a number";
         }
-        // LCOV_EXCL_START
-        catch (std::exception const& e)
+        std::int64_t const deadline_ms = deadline_value.As<Napi::Number>().Int64Value();
+        if (deadline_ms < 1)
         {
-            SetError(e.what());
+            return deadline_name + " must be a positive number";
         }
-        // LCOV_EXCL_STOP
+        cancel.set_deadline(static_cast<std::uint32_t>(std::min<std::int64_t>(deadline_ms, std::numeric_limits<std::uint32_t>::max())));
     }
-    std::vector<napi_value> GetResult(Napi::Env env) override
+    if (options.Has(js_string(env, js_name::signal)))
     {
-        if (output_buffer_)
+        Napi::Value signal_value = options.Get(js_string(env, js_name::signal));
+        if (!signal_value.IsObject())
         {
-            std::string& tile_buffer = *output_buffer_;
-            auto buffer = Napi::Buffer<char>::New(
-                env,
-                tile_buffer.empty() ? nullptr : &tile_buffer[0],
-                tile_buffer.size(),
-                [](Napi::Env env_, char* /*unused*/, std::string* str_ptr) {
-                    if (str_ptr != nullptr)
-                    {
-                        Napi::MemoryManagement::AdjustExternalMemory(env_, -static_cast<std::int64_t>(str_ptr->size()));
-                    }
-                    delete str_ptr;
-                },
-                output_buffer_.release());
-            Napi::MemoryManagement::AdjustExternalMemory(env, static_cast<std::int64_t>(tile_buffer.size()));
-            return {env.Null(), buffer};
+            return signal_name + " must be an AbortSignal";
+        }
+        Napi::Object signal = signal_value.As<Napi::Object>();
+        Napi::Value aborted = signal.Get(js_string(env, js_name::aborted));
+        if (!aborted.IsBoolean() || !signal.Get(js_string(env, js_name::add_event_listener)).IsFunction() || !signal.Get(js_string(env, js_name::remove_event_listener)).IsFunction())
+        {
+            return signal_name + " must be an AbortSignal";
+        }
+        std::shared_ptr<std::atomic<bool>> const& flag = cancel.flag();
+        if (aborted.As<Napi::Boolean>().Value())
+        {
+            flag->store(true, std::memory_order_relaxed);
+        }
+        else
+        {
+            listener = std::make_unique<AbortListener>(signal, flag);
         }
-        return Base::GetResult(env); // returns an empty vector (default)
     }
+    return {};
+}
 
-    std::unique_ptr<BatonType> const baton_data_;
-    std::unique_ptr<std::string> output_buffer_;
-};
-
-Napi::Value composite(Napi::CallbackInfo const& info)
+// `{codec, level, min_bytes}`; returns an error message naming the option
+// `name`, or an empty string
+std::string parse_compression(Napi::Value const& value, std::string const& name, vtile::compression_options& options)
 {
-    // validate callback function
-    std::size_t length = info.Length();
-    if (length == 0)
+    if (!value.IsObject())
     {
-        Napi::Error::New(info.Env(), "last argument must be a callback function").ThrowAsJavaScriptException();
-        return info.Env().Null();
+        return name + " must be an object";
     }
-    Napi::Value callback_val = info[length - 1];
-    if (!callback_val.IsFunction())
+    Napi::Env env = value.Env();
+    Napi::Object object = value.As<Napi::Object>();
+    Napi::Value codec_value = object.Get(js_string(env, js_name::codec));
+    if (!codec_value.IsString() || !vtile::parse_codec(codec_value.As<Napi::String>(), options.codec))
     {
-        Napi::Error::New(info.Env(), "last argument must be a callback function").ThrowAsJavaScriptException();
-        return info.Env().Null();
+        return name + ".codec must be 'gzip', 'zstd' or 'br'";
+    }
+    std::string const codec_name = codec_value.As<Napi::String>();
+    if (!vtile::codec_supported(options.codec))
+    {
+        return name + ".codec '" + codec_name + "' is not supported by this build";
+    }
+    if (object.Has(js_string(env, js_name::level)))
+    {
+        Napi::Value level_value = object.Get(js_string(env, js_name::level));
+        if (!level_value.IsNumber())
+        {
+            return name + ".level must be an int32";
+        }
+        int const level = level_value.As<Napi::Number>().Int32Value();
+        int const min_level = options.codec == vtile::codec::brotli ? 0 : 1;
+        if (level < min_level || level > vtile::max_level(options.codec))
+        {
+            return name + ".level must be between " + std::to_string(min_level) + " and " +
+                   std::to_string(vtile::max_level(options.codec)) + " for " + codec_name;
+        }
+        options.level = level;
     }
+    if (object.Has(js_string(env, js_name::min_bytes)))
+    {
+        Napi::Value min_bytes_value = object.Get(js_string(env, js_name::min_bytes));
+        if (!min_bytes_value.IsNumber())
+        {
+            return name + ".min_bytes must be an int32";
+        }
+        int const min_bytes = min_bytes_value.As<Napi::Number>().Int32Value();
+        if (min_bytes < 0)
+        {
+            return name + ".min_bytes must be a positive int32";
+        }
+        options.min_bytes = static_cast<std::size_t>(min_bytes);
+    }
+    return {};
+}
 
-    Napi::Function callback = callback_val.As<Napi::Function>();
+// Reads the property `name` of `object` into `value` with a single lookup
+// unless it is undefined; returns false if `object` has no such property.
+bool get_property(Napi::Object const& object, Napi::String const& name, Napi::Value& value)
+{
+    value = object.Get(name);
+    return !value.IsUndefined() || object.Has(name);
+}
 
-    // validate tiles
-    if (!info[0].IsArray())
+// Reads the `tiles` argument of composite and compositeBatch into baton.tiles;
+// returns an error message, or an empty string
+std::string parse_tiles(Napi::Value const& value, BatonType& baton)
+{
+    if (!value.IsArray())
     {
-        return utils::CallbackError("first arg 'tiles' must be an array of tile objects", info);
+        return "first arg 'tiles' must be an array of tile objects";
     }
 
-    Napi::Array tiles = info[0].As<Napi::Array>();
+    Napi::Env env = value.Env();
+    Napi::Array tiles = value.As<Napi::Array>();
     std::uint32_t num_tiles = tiles.Length();
 
     if (num_tiles <= 0)
     {
-        return utils::CallbackError("'tiles' array must be of length greater than 0", info);
+        return "'tiles' array must be of length greater than 0";
     }
 
-    std::unique_ptr<BatonType> baton_data = std::make_unique<BatonType>(num_tiles);
+    baton.tiles.reserve(num_tiles);
+    Napi::String const buffer_name = js_string(env, js_name::buffer);
+    Napi::String const z_name = js_string(env, js_name::z);
+    Napi::String const x_name = js_string(env, js_name::x);
+    Napi::String const y_name = js_string(env, js_name::y);
+    Napi::String const layers_name = js_string(env, js_name::layers);
+    Napi::String const id_name = js_string(env, js_name::id);
 
     for (std::uint32_t t = 0; t < num_tiles; ++t)
     {
         Napi::Value tile_val = tiles.Get(t);
         if (!tile_val.IsObject())
         {
-            return utils::CallbackError("items in 'tiles' array must be objects", info);
+            return "items in 'tiles' array must be objects";
         }
 
         Napi::Object tile_obj = tile_val.As<Napi::Object>();
         // check buffer value
-        if (!tile_obj.Has(Napi::String::New(info.Env(), "buffer")))
+        Napi::Value buf_val;
+        if (!get_property(tile_obj, buffer_name, buf_val))
         {
-            return utils::CallbackError("item in 'tiles' array does not include a buffer value", info);
+            return "item in 'tiles' array does not include a buffer value";
         }
-        Napi::Value buf_val = tile_obj.Get(Napi::String::New(info.Env(), "buffer"));
         if (buf_val.IsNull() || buf_val.IsUndefined())
         {
-            return utils::CallbackError("buffer value in 'tiles' array item is null or undefined", info);
+            return "buffer value in 'tiles' array item is null or undefined";
         }
 
         Napi::Object buffer_obj = buf_val.As<Napi::Object>();
         if (!buffer_obj.IsBuffer())
         {
-            return utils::CallbackError("buffer value in 'tiles' array item is not a true buffer", info);
+            return "buffer value in 'tiles' array item is not a true buffer";
         }
 
         Napi::Buffer<char> buffer = buffer_obj.As<Napi::Buffer<char>>();
         // z value
-        if (!tile_obj.Has(Napi::String::New(info.Env(), "z")))
+        Napi::Value z_val;
+        if (!get_property(tile_obj, z_name, z_val))
         {
-            return utils::CallbackError("item in 'tiles' array does not include a 'z' value", info);
+            return "item in 'tiles' array does not include a 'z' value";
         }
-        Napi::Value z_val = tile_obj.Get(Napi::String::New(info.Env(), "z"));
         if (!z_val.IsNumber())
         {
-            return utils::CallbackError("'z' value in 'tiles' array item is not an int32", info);
+            return "'z' value in 'tiles' array item is not an int32";
         }
 
         int z = z_val.As<Napi::Number>().Int32Value();
         if (z < 0)
         {
-            return utils::CallbackError("'z' value must not be less than zero", info);
+            return "'z' value must not be less than zero";
         }
 
         // x value
-        if (!tile_obj.Has(Napi::String::New(info.Env(), "x")))
+        Napi::Value x_val;
+        if (!get_property(tile_obj, x_name, x_val))
         {
-            return utils::CallbackError("item in 'tiles' array does not include a 'x' value", info);
+            return "item in 'tiles' array does not include a 'x' value";
         }
-        Napi::Value x_val = tile_obj.Get(Napi::String::New(info.Env(), "x"));
         if (!x_val.IsNumber())
         {
-            return utils::CallbackError("'x' value in 'tiles' array item is not an int32", info);
+            return "'x' value in 'tiles' array item is not an int32";
         }
 
         int x = x_val.As<Napi::Number>().Int32Value();
         if (x < 0)
         {
-            return utils::CallbackError("'x' value must not be less than zero", info);
+            return "'x' value must not be less than zero";
         }
 
         // y value
-        if (!tile_obj.Has(Napi::String::New(info.Env(), "y")))
+        Napi::Value y_val;
+        if (!get_property(tile_obj, y_name, y_val))
         {
-            return utils::CallbackError("item in 'tiles' array does not include a 'y' value", info);
+            return "item in 'tiles' array does not include a 'y' value";
         }
-        Napi::Value y_val = tile_obj.Get(Napi::String::New(info.Env(), "y"));
         if (!y_val.IsNumber())
         {
-            return utils::CallbackError("'y' value in 'tiles' array item is not an int32", info);
+            return "'y' value in 'tiles' array item is not an int32";
         }
 
         int y = y_val.As<Napi::Number>().Int32Value();
         if (y < 0)
         {
-            return utils::CallbackError("'y' value must not be less than zero", info);
+            return "'y' value must not be less than zero";
         }
 
         // layers array value
         // does the layers key exist?
         std::vector<std::string> layers;
-        if (tile_obj.Has(Napi::String::New(info.Env(), "layers")))
+        if (tile_obj.Has(layers_name))
         {
-            Napi::Value layers_val = tile_obj.Get(Napi::String::New(info.Env(), "layers"));
+            Napi::Value layers_val = tile_obj.Get(layers_name);
 
             // is the layers property an array?
             if (!layers_val.IsArray())
             {
-                return utils::CallbackError("'layers' value in the 'tiles' array must be an array", info);
+                return "'layers' value in the 'tiles' array must be an array";
             }
 
             Napi::Array layers_array = layers_val.As<Napi::Array>();
@@ -478,7 +599,7 @@ Napi::Value composite(Napi::CallbackInfo const& info)
             // does the layers array have length > 0?
             if (num_layers == 0)
             {
-                return utils::CallbackError("'layers' array must be of length greater than 0", info);
+                return "'layers' array must be of length greater than 0";
             }
             layers.reserve(num_layers);
 
@@ -490,7 +611,7 @@ Napi::Value composite(Napi::CallbackInfo const& info)
                 // is the layers array filled with strings?
                 if (!layer_val.IsString())
                 {
-                    return utils::CallbackError("items in 'layers' array must be strings", info);
+                    return "items in 'layers' array must be strings";
                 }
 
                 // create string and emplace into layer vector
@@ -499,578 +620,2515 @@ Napi::Value composite(Napi::CallbackInfo const& info)
             }
         }
 
-        baton_data->tiles.push_back(std::make_unique<TileObject>(z, x, y, buffer, layers));
+        // id value (optional)
+        std::string id;
+        if (tile_obj.Has(id_name))
+        {
+            Napi::Value id_val = tile_obj.Get(id_name);
+            if (!id_val.IsString() || id_val.As<Napi::String>().Utf8Value().empty())
+            {
+                return "'id' value in 'tiles' array item must be a non-empty string";
+            }
+            id = id_val.As<Napi::String>();
+        }
+
+        baton.tiles.push_back(std::make_unique<TileObject>(z, x, y, buffer, std::move(layers), std::move(id)));
     }
+    return {};
+}
+
+// Reads the `buffers` and `coords` arguments of compositePacked into
+// baton.tiles and baton.z/x/y: the source tiles as an array of buffers, and a
+// Uint32Array of the z, x, y of the target tile followed by the z, x, y of each
+// buffer. Returns an error message, or an empty string.
+std::string parse_packed_tiles(Napi::Value const& buffers_value, Napi::Value const& coords_value, BatonType& baton)
+{
+    if (!buffers_value.IsArray())
+    {
+        return "first arg 'buffers' must be an array of buffers";
+    }
+    Napi::Array buffers = buffers_value.As<Napi::Array>();
+    std::uint32_t const num_tiles = buffers.Length();
+    if (num_tiles == 0)
+    {
+        return "'buffers' array must be of length greater than 0";
+    }
+
+    if (!coords_value.IsTypedArray() || coords_value.As<Napi::TypedArray>().TypedArrayType() != napi_uint32_array)
+    {
+        return "second arg 'coords' must be a Uint32Array";
+    }
+    Napi::Uint32Array coords = coords_value.As<Napi::Uint32Array>();
+    std::size_t const num_coords = coords.ElementLength();
+    if (num_coords != 3 * (std::size_t{num_tiles} + 1))
+    {
+        return "'coords' must hold the z, x, y of the target tile and of each buffer";
+    }
+    std::uint32_t const* const zxy = coords.Data();
+    for (std::size_t i = 0; i < num_coords; i += 3)
+    {
+        if (zxy[i] > 31 || (zxy[i + 1] >> zxy[i]) != 0 || (zxy[i + 2] >> zxy[i]) != 0)
+        {
+            return "'coords' must hold the z, x, y of valid tiles";
+        }
+    }
+    baton.z = zxy[0];
+    baton.x = zxy[1];
+    baton.y = zxy[2];
+
+    baton.tiles.reserve(num_tiles);
+    for (std::uint32_t t = 0; t < num_tiles; ++t)
+    {
+        Napi::Value buffer_val = buffers.Get(t);
+        if (!buffer_val.IsBuffer())
+        {
+            return "items in 'buffers' array must be buffers";
+        }
+        std::uint32_t const* const tile = zxy + 3 * (std::size_t{t} + 1);
+        baton.tiles.push_back(std::make_unique<TileObject>(tile[0], tile[1], tile[2], buffer_val.As<Napi::Buffer<char>>(),
+                                                           std::vector<std::string>{}, std::string{}));
+    }
+    return {};
+}
+
+// Reads the `zxy` argument of composite into baton.z/x/y; returns an error
+// message, or an empty string
+std::string parse_zxy(Napi::Value const& value, BatonType& baton)
+{
+    Napi::Env env = value.Env();
 
     // validate zxy maprequest object
-    if (!info[1].IsObject())
+    if (!value.IsObject())
     {
-        return utils::CallbackError("'zxy_maprequest' must be an object", info);
+        return "'zxy_maprequest' must be an object";
     }
-    Napi::Object zxy_maprequest = info[1].As<Napi::Object>();
+    Napi::Object zxy_maprequest = value.As<Napi::Object>();
 
     // z value of map request object
-    if (!zxy_maprequest.Has(Napi::String::New(info.Env(), "z")))
+    Napi::Value z_val_maprequest;
+    if (!get_property(zxy_maprequest, js_string(env, js_name::z), z_val_maprequest))
     {
-        return utils::CallbackError("item in 'tiles' array does not include a 'z' value", info);
+        return "item in 'tiles' array does not include a 'z' value";
     }
-    Napi::Value z_val_maprequest = zxy_maprequest.Get(Napi::String::New(info.Env(), "z"));
     if (!z_val_maprequest.IsNumber())
     {
-        return utils::CallbackError("'z' value in 'tiles' array item is not an int32", info);
+        return "'z' value in 'tiles' array item is not an int32";
     }
 
     int z_maprequest = z_val_maprequest.As<Napi::Number>().Int32Value();
     if (z_maprequest < 0)
     {
-        return utils::CallbackError("'z' value must not be less than zero", info);
+        return "'z' value must not be less than zero";
     }
-    baton_data->z = static_cast<std::uint32_t>(z_maprequest);
+    baton.z = static_cast<std::uint32_t>(z_maprequest);
 
     // x value of map request object
-    if (!zxy_maprequest.Has(Napi::String::New(info.Env(), "x")))
+    Napi::Value x_val_maprequest;
+    if (!get_property(zxy_maprequest, js_string(env, js_name::x), x_val_maprequest))
     {
-        return utils::CallbackError("item in 'tiles' array does not include a 'x' value", info);
+        return "item in 'tiles' array does not include a 'x' value";
     }
-    Napi::Value x_val_maprequest = zxy_maprequest.Get(Napi::String::New(info.Env(), "x"));
     if (!x_val_maprequest.IsNumber())
     {
-        return utils::CallbackError("'x' value in 'tiles' array item is not an int32", info);
+        return "'x' value in 'tiles' array item is not an int32";
     }
 
     int x_maprequest = x_val_maprequest.As<Napi::Number>().Int32Value();
     if (x_maprequest < 0)
     {
-        return utils::CallbackError("'x' value must not be less than zero", info);
+        return "'x' value must not be less than zero";
     }
 
-    baton_data->x = static_cast<std::uint32_t>(x_maprequest);
+    baton.x = static_cast<std::uint32_t>(x_maprequest);
 
     // y value of maprequest object
-    if (!zxy_maprequest.Has(Napi::String::New(info.Env(), "y")))
+    Napi::Value y_val_maprequest;
+    if (!get_property(zxy_maprequest, js_string(env, js_name::y), y_val_maprequest))
     {
-        return utils::CallbackError("item in 'tiles' array does not include a 'y' value", info);
+        return "item in 'tiles' array does not include a 'y' value";
     }
-    Napi::Value y_val_maprequest = zxy_maprequest.Get(Napi::String::New(info.Env(), "y"));
     if (!y_val_maprequest.IsNumber())
     {
-        return utils::CallbackError("'y' value in 'tiles' array item is not an int32", info);
+        return "'y' value in 'tiles' array item is not an int32";
     }
 
     int y_maprequest = y_val_maprequest.As<Napi::Number>().Int32Value();
     if (y_maprequest < 0)
     {
-        return utils::CallbackError("'y' value must not be less than zero", info);
+        return "'y' value must not be less than zero";
     }
 
-    baton_data->y = static_cast<std::uint32_t>(y_maprequest);
+    baton.y = static_cast<std::uint32_t>(y_maprequest);
+    return {};
+}
 
-    if (info.Length() > 3) // options
+// Reads the array of non-empty strings `key` of `object` into `result`;
+// returns an error message naming it `name`, or an empty string
+std::string parse_string_array(Napi::Object const& object, js_name key, std::string const& name, std::vector<std::string>& result)
+{
+    Napi::Value value = object.Get(js_string(object.Env(), key));
+    if (!value.IsArray())
     {
-        if (!info[2].IsObject())
-        {
-            return utils::CallbackError("'options' arg must be an object", info);
-        }
-
-        Napi::Object options = info[2].As<Napi::Object>();
-        if (options.Has(Napi::String::New(info.Env(), "buffer_size")))
-        {
-            Napi::Value bs_value = options.Get(Napi::String::New(info.Env(), "buffer_size"));
-            if (!bs_value.IsNumber())
-            {
-                return utils::CallbackError("'buffer_size' must be an int32", info);
-            }
-
-            int buffer_size = bs_value.As<Napi::Number>().Int32Value();
-            if (buffer_size < 0)
-            {
-                return utils::CallbackError("'buffer_size' must be a positive int32", info);
-            }
-            baton_data->buffer_size = buffer_size;
-        }
-        if (options.Has(Napi::String::New(info.Env(), "compress")))
+        return name + " must be an array";
+    }
+    Napi::Array array = value.As<Napi::Array>();
+    std::uint32_t const length = array.Length();
+    result.reserve(length);
+    for (std::uint32_t i = 0; i < length; ++i)
+    {
+        Napi::Value item = array.Get(i);
+        if (!item.IsString() || item.As<Napi::String>().Utf8Value().empty())
         {
-            Napi::Value comp_value = options.Get(Napi::String::New(info.Env(), "compress"));
-            if (!comp_value.IsBoolean())
-            {
-                return utils::CallbackError("'compress' must be a boolean", info);
-            }
-
-            baton_data->compress = comp_value.As<Napi::Boolean>().Value();
+            return name + " must be an array of non-empty strings";
         }
+        result.push_back(item.As<Napi::String>());
     }
-    auto* worker = new CompositeWorker{std::move(baton_data), callback};
-    worker->Queue();
-    return info.Env().Undefined();
+    return {};
 }
 
-struct LocalizeWorker : Napi::AsyncWorker
+// Reads the params of `object` that say how features are localized into
+// `settings`; returns an error message naming `object` as `name`, or an
+// empty string
+std::string parse_localize_settings(Napi::Object const& object, std::string const& name, LocalizeSettings& settings)
 {
-    using Base = Napi::AsyncWorker;
+    Napi::Env env = object.Env();
 
-    LocalizeWorker(std::unique_ptr<LocalizeBatonType>&& baton_data, Napi::Function& cb)
-        : Base(cb),
-          baton_data_{std::move(baton_data)},
-          output_buffer_{std::make_unique<std::string>()} {}
+    // empty string to check against
+    Napi::String empty_string = Napi::String::New(env, "");
 
-    // create a feature with new properties from a template feature
-    static void build_new_feature(
-        vtzero::feature const& template_feature,
-        std::vector<std::pair<std::string, vtzero::property_value>> const& properties,
-        std::string const& worldview_key,
-        std::string const& worldview_val,
-        vtzero::layer_builder& lbuilder)
+    // hidden_prefix (optional)
+    if (object.Has(js_string(env, js_name::hidden_prefix)))
     {
-        vtzero::geometry_feature_builder fbuilder{lbuilder};
-        fbuilder.copy_id(template_feature); // TODO: deduplicate this (vector tile spec says SHOULD be unique)
-        fbuilder.set_geometry(template_feature.geometry());
-
-        // add property to feature
-        for (auto const& property : properties)
+        Napi::Value hidden_prefix_val = object.Get(js_string(env, js_name::hidden_prefix));
+        if (!hidden_prefix_val.IsString() || hidden_prefix_val == empty_string)
         {
-            if (property.first == worldview_key) // safeguard – should always evaluate to false
-            {
-                continue;
-            }
-            fbuilder.add_property(property.first, property.second);
+            return name + ".hidden_prefix must be a non-empty string";
         }
+        settings.hidden_prefix = hidden_prefix_val.As<Napi::String>();
+    }
 
-        if (!worldview_key.empty())
+    // omit_scripts (optional)
+    if (object.Has(js_string(env, js_name::omit_scripts)))
+    {
+        std::string const error = parse_string_array(object, js_name::omit_scripts, name + ".omit_scripts", settings.omit_scripts);
+        if (!error.empty())
         {
-            fbuilder.add_property(worldview_key, worldview_val);
+            return error;
         }
+    }
 
-        fbuilder.commit();
+    // language is an invalid param
+    if (object.Has(js_string(env, js_name::language)))
+    {
+        return name + ".language is an invalid param... do you mean " + name + ".languages?";
+    }
+    // languages (optional)
+    if (object.Has(js_string(env, js_name::languages)))
+    {
+        std::string const error = parse_string_array(object, js_name::languages, name + ".languages", settings.languages);
+        if (!error.empty())
+        {
+            return error;
+        }
+        settings.return_localized_tile = true;
     }
 
-    // returns a vector of requested worldviews that the feature exists in
-    static std::vector<std::string> worldviews_for_feature(std::vector<std::string> available_worldviews, std::vector<std::string> target_worldviews)
+    // language_property (optional)
+    if (object.Has(js_string(env, js_name::language_property)))
     {
-        target_worldviews.emplace_back("all");
+        Napi::Value language_property_val = object.Get(js_string(env, js_name::language_property));
+        if (!language_property_val.IsString() || language_property_val == empty_string)
+        {
+            return name + ".language_property must be a non-empty string";
+        }
+        settings.language_property = language_property_val.As<Napi::String>();
+    }
 
-        std::vector<std::string> matching_worldviews;
-        utils::intersection(available_worldviews, target_worldviews, matching_worldviews);
-        return matching_worldviews;
+    // worldview is an invalid param
+    if (object.Has(js_string(env, js_name::worldview)))
+    {
+        return name + ".worldview is an invalid param... do you mean " + name + ".worldviews?";
+    }
+    // worldviews (optional)
+    if (object.Has(js_string(env, js_name::worldviews)))
+    {
+        std::string const error = parse_string_array(object, js_name::worldviews, name + ".worldviews", settings.worldviews);
+        if (!error.empty())
+        {
+            return error;
+        }
+        settings.return_localized_tile = true;
     }
 
-    static std::string remove_hidden_prefix(std::string property_key, std::string& hidden_prefix)
+    // worldview_property (optional)
+    if (object.Has(js_string(env, js_name::worldview_property)))
     {
-        bool has_hidden_prefix = utils::startswith(property_key, hidden_prefix);
+        Napi::Value worldview_property_val = object.Get(js_string(env, js_name::worldview_property));
+        if (!worldview_property_val.IsString() || worldview_property_val == empty_string)
+        {
+            return name + ".worldview_property must be a non-empty string";
+        }
+        settings.worldview_property = worldview_property_val.As<Napi::String>();
+    }
 
-        if (has_hidden_prefix)
+    // worldview_default (optional)
+    if (object.Has(js_string(env, js_name::worldview_default)))
+    {
+        Napi::Value worldview_default_val = object.Get(js_string(env, js_name::worldview_default));
+        if (!worldview_default_val.IsString() || worldview_default_val == empty_string)
         {
-            return property_key.substr(hidden_prefix.length());
+            return name + ".worldview_default must be a non-empty string";
         }
+        settings.worldview_default = worldview_default_val.As<Napi::String>();
+    }
 
-        return property_key;
+    // class_property (optional)
+    if (object.Has(js_string(env, js_name::class_property)))
+    {
+        Napi::Value class_property_val = object.Get(js_string(env, js_name::class_property));
+        if (!class_property_val.IsString() || class_property_val == empty_string)
+        {
+            return name + ".class_property must be a non-empty string";
+        }
+        settings.class_property = class_property_val.As<Napi::String>();
     }
 
-    void Execute() override
+    // This if block must be validated *after* languages and worldviews
+    // because it checks return_localized_tile which is dictated by the
+    // value of both languages and worldviews.
+    if (settings.return_localized_tile)
     {
-        try
+        if (settings.worldviews.empty())
         {
-            bool keep_all_non_hidden_worldviews = true;
-            std::string incompatible_worldview_key;
-            std::string compatible_worldview_key;
-            std::vector<std::string> class_key_precedence;
-            bool keep_all_non_hidden_languages = true;
-            bool is_localized_tile_with_all_languages = false;
-            bool is_localized_tile_with_all_worldviews = false;
-            std::vector<std::string> language_key_precedence;
+            settings.worldviews.push_back(settings.worldview_default);
+        }
+        // else do nothing – already knows which worldview to return
+    }
+    return {};
+}
 
-            if (baton_data_->return_localized_tile)
-            {
-                keep_all_non_hidden_worldviews = false;
-                incompatible_worldview_key = baton_data_->worldview_property;
-                compatible_worldview_key = baton_data_->hidden_prefix + baton_data_->worldview_property;
+// Reads the `options` argument of composite and compositeBatch into `baton`;
+// returns an error message, or an empty string
+std::string parse_composite_options(Napi::Value const& value, BatonType& baton)
+{
+    if (!value.IsObject())
+    {
+        return "'options' arg must be an object";
+    }
 
-                class_key_precedence.push_back(baton_data_->hidden_prefix + baton_data_->class_property);
-                class_key_precedence.push_back(baton_data_->class_property);
+    Napi::Env env = value.Env();
+    Napi::Object options = value.As<Napi::Object>();
+    if (options.Has(js_string(env, js_name::buffer_size)))
+    {
+        Napi::Value bs_value = options.Get(js_string(env, js_name::buffer_size));
+        if (!bs_value.IsNumber())
+        {
+            return "'buffer_size' must be an int32";
+        }
 
-                keep_all_non_hidden_languages = false;
-                if (baton_data_->languages.size() == 1 && baton_data_->languages[0] == "all")
+        int buffer_size = bs_value.As<Napi::Number>().Int32Value();
+        if (buffer_size < 0)
+        {
+            return "'buffer_size' must be a positive int32";
+        }
+        baton.buffer_size = buffer_size;
+    }
+    if (options.Has(js_string(env, js_name::compress)))
+    {
+        Napi::Value comp_value = options.Get(js_string(env, js_name::compress));
+        if (!comp_value.IsBoolean())
+        {
+            return "'compress' must be a boolean";
+        }
+
+        if (comp_value.As<Napi::Boolean>().Value())
+        {
+            baton.compression.codec = vtile::codec::gzip;
+        }
+    }
+    // 'compression' takes precedence over 'compress'
+    if (options.Has(js_string(env, js_name::compression)))
+    {
+        vtile::compression_options compression{};
+        std::string const error = parse_compression(options.Get(js_string(env, js_name::compression)), "compression", compression);
+        if (!error.empty())
+        {
+            return error;
+        }
+        baton.compression = compression;
+    }
+    if (options.Has(js_string(env, js_name::threads)))
+    {
+        Napi::Value threads_value = options.Get(js_string(env, js_name::threads));
+        if (!threads_value.IsNumber())
+        {
+            return "'threads' must be an int32";
+        }
+
+        int threads = threads_value.As<Napi::Number>().Int32Value();
+        if (threads < 1)
+        {
+            return "'threads' must be a positive int32";
+        }
+        // more threads than the hardware (or the pool) has would only add
+        // short-lived threads competing for the same cores
+        std::size_t const max_threads = vtile::max_threads(vtile::worker_pool());
+        baton.threads = static_cast<std::uint32_t>(std::min(static_cast<std::size_t>(threads), max_threads));
+    }
+    if (options.Has(js_string(env, js_name::priority)))
+    {
+        if (!parse_priority(options.Get(js_string(env, js_name::priority)), baton.lane))
+        {
+            return "'priority' must be 'interactive' or 'bulk'";
+        }
+    }
+    if (options.Has(js_string(env, js_name::stats)))
+    {
+        Napi::Value stats_value = options.Get(js_string(env, js_name::stats));
+        if (!stats_value.IsBoolean())
+        {
+            return "'stats' must be a boolean";
+        }
+        baton.stats = stats_value.As<Napi::Boolean>().Value();
+    }
+    if (options.Has(js_string(env, js_name::localize)))
+    {
+        Napi::Value localize_value = options.Get(js_string(env, js_name::localize));
+        if (!localize_value.IsObject() || localize_value.IsArray())
+        {
+            return "'localize' must be an object";
+        }
+        LocalizeSettings settings;
+        std::string const error = parse_localize_settings(localize_value.As<Napi::Object>(), "localize", settings);
+        if (!error.empty())
+        {
+            return error;
+        }
+        baton.localize = std::make_unique<vtile::localize_options>(settings.options());
+    }
+    if (options.Has(js_string(env, js_name::max_bytes)))
+    {
+        Napi::Value max_bytes_value = options.Get(js_string(env, js_name::max_bytes));
+        if (!max_bytes_value.IsNumber())
+        {
+            return "'max_bytes' must be a number";
+        }
+        std::int64_t const max_bytes = max_bytes_value.As<Napi::Number>().Int64Value();
+        if (max_bytes < 1)
+        {
+            return "'max_bytes' must be a positive number";
+        }
+        baton.drop.max_bytes = static_cast<std::size_t>(max_bytes);
+    }
+    if (options.Has(js_string(env, js_name::drop_priority)))
+    {
+        Napi::Value priority_value = options.Get(js_string(env, js_name::drop_priority));
+        if (!priority_value.IsObject() || priority_value.IsArray())
+        {
+            return "'drop_priority' must be an object";
+        }
+        Napi::Object priorities = priority_value.As<Napi::Object>();
+        Napi::Array names = priorities.GetPropertyNames();
+        for (std::uint32_t i = 0; i < names.Length(); ++i)
+        {
+            Napi::Value name = names.Get(i);
+            Napi::Value priority = priorities.Get(name);
+            if (!priority.IsNumber() || std::isnan(priority.As<Napi::Number>().DoubleValue()))
+            {
+                return "values of 'drop_priority' must be numbers";
+            }
+            baton.drop.layer_priority[name.As<Napi::String>()] = priority.As<Napi::Number>().DoubleValue();
+        }
+    }
+    if (options.Has(js_string(env, js_name::drop_property)))
+    {
+        Napi::Value property_value = options.Get(js_string(env, js_name::drop_property));
+        if (!property_value.IsString())
+        {
+            return "'drop_property' must be a string";
+        }
+        baton.drop.rank_property = property_value.As<Napi::String>();
+    }
+    return parse_cancellation(options, "'deadline_ms'", "'signal'", baton.cancel, baton.abort_listener);
+}
+
+// number of features clipped by a single task when compositing with threads > 1
+constexpr std::size_t PARALLEL_CHUNK_SIZE = 4096;
+
+// upper bound on the number of target tiles of a single compositeBatch call
+constexpr std::size_t MAX_BATCH_TARGETS = 4096;
+
+// reads a {z, x, y} object; returns false unless it is a valid tile
+bool parse_target(Napi::Value const& value, TargetTile& target)
+{
+    if (!value.IsObject())
+    {
+        return false;
+    }
+    Napi::Env env = value.Env();
+    Napi::Object object = value.As<Napi::Object>();
+    Napi::Value z_val = object.Get(js_string(env, js_name::z));
+    Napi::Value x_val = object.Get(js_string(env, js_name::x));
+    Napi::Value y_val = object.Get(js_string(env, js_name::y));
+    if (!z_val.IsNumber() || !x_val.IsNumber() || !y_val.IsNumber())
+    {
+        return false;
+    }
+    int const z = z_val.As<Napi::Number>().Int32Value();
+    int const x = x_val.As<Napi::Number>().Int32Value();
+    int const y = y_val.As<Napi::Number>().Int32Value();
+    if (z < 0 || z > 31 || x < 0 || y < 0)
+    {
+        return false;
+    }
+    target = {static_cast<std::uint32_t>(z), static_cast<std::uint32_t>(x), static_cast<std::uint32_t>(y)};
+    return (target.x >> target.z) == 0 && (target.y >> target.z) == 0;
+}
+
+// Reads the `targets` argument of compositeBatch: an array of {z, x, y}
+// objects, or a single {z, x, y, max_z} object standing for that tile and all
+// of its descendants down to zoom max_z (by zoom, then row by row). Returns an
+// error message, or an empty string.
+std::string parse_targets(Napi::Value const& value, std::vector<TargetTile>& targets)
+{
+    if (value.IsArray())
+    {
+        Napi::Array array = value.As<Napi::Array>();
+        std::uint32_t const num_targets = array.Length();
+        if (num_targets == 0)
+        {
+            return "'targets' array must be of length greater than 0";
+        }
+        if (num_targets > MAX_BATCH_TARGETS)
+        {
+            return "'targets' must not contain more than " + std::to_string(MAX_BATCH_TARGETS) + " tiles";
+        }
+        targets.resize(num_targets);
+        for (std::uint32_t t = 0; t < num_targets; ++t)
+        {
+            if (!parse_target(array.Get(t), targets[t]))
+            {
+                return "items in 'targets' array must be {z, x, y} objects of valid tiles";
+            }
+        }
+        return {};
+    }
+
+    TargetTile root{};
+    if (!value.IsObject() || !parse_target(value, root))
+    {
+        return "'targets' must be an array of {z, x, y} objects or a {z, x, y, max_z} object";
+    }
+    Napi::Value max_z_val = value.As<Napi::Object>().Get(js_string(value.Env(), js_name::max_z));
+    if (!max_z_val.IsNumber())
+    {
+        return "'targets.max_z' must be an int32";
+    }
+    int const max_z = max_z_val.As<Napi::Number>().Int32Value();
+    if (max_z < static_cast<int>(root.z) || max_z > 31)
+    {
+        return "'targets.max_z' must be between 'targets.z' and 31";
+    }
+    std::size_t num_targets = 0;
+    for (std::uint32_t dz = 0; dz <= static_cast<std::uint32_t>(max_z) - root.z; ++dz)
+    {
+        num_targets += std::size_t{1} << (2 * dz);
+        if (num_targets > MAX_BATCH_TARGETS)
+        {
+            return "'targets' must not contain more than " + std::to_string(MAX_BATCH_TARGETS) + " tiles";
+        }
+    }
+    targets.reserve(num_targets);
+    for (std::uint32_t dz = 0; dz <= static_cast<std::uint32_t>(max_z) - root.z; ++dz)
+    {
+        std::uint32_t const size = 1U << dz;
+        for (std::uint32_t y = 0; y < size; ++y)
+        {
+            for (std::uint32_t x = 0; x < size; ++x)
+            {
+                targets.push_back({root.z + dz, (root.x << dz) + x, (root.y << dz) + y});
+            }
+        }
+    }
+    return {};
+}
+
+// Layers are overzoomed with 32-bit coordinates when the source tile, with a
+// buffer of up to one extent around it, stays within the range the 32-bit
+// clipper can handle; this is the case for all but the largest zoom factors.
+// Single features reaching further out are still clipped with 64-bit
+// coordinates (see overzoomed_feature_clipper::max_coordinate).
+bool use_narrow_coordinates(std::uint32_t extent, std::uint32_t zoom_factor, int buffer_size)
+{
+    std::int64_t const reach = 2 * std::int64_t{extent} * zoom_factor + buffer_size;
+    return reach <= vtile::overzoomed_feature_clipper<std::int32_t>::max_coordinate;
+}
+
+template <typename CoordinateType>
+mapbox::geometry::box<CoordinateType> overzoom_bbox(std::uint32_t extent, int buffer_size)
+{
+    return {{-buffer_size, -buffer_size},
+            {static_cast<int>(extent) + buffer_size,
+             static_cast<int>(extent) + buffer_size}};
+}
+
+template <typename CoordinateType>
+void overzoom_layer(vtzero::layer& layer, vtzero::layer_builder& layer_builder, vtzero::property_mapper& mapper,
+                    std::uint32_t dx, std::uint32_t dy, std::uint32_t zoom_factor, int buffer_size,
+                    vtile::layer_stats* stats, vtile::property_writer* writer, vtile::cancellation const* cancel)
+{
+    using feature_builder_type = vtile::overzoomed_feature_builder<CoordinateType>;
+    auto const bbox = overzoom_bbox<CoordinateType>(layer.extent(), buffer_size);
+    feature_builder_type f_builder{layer_builder, mapper, bbox, dx, dy, zoom_factor};
+    f_builder.stats_ = stats;
+    f_builder.writer_ = writer;
+    if (layer.version() == MVT_VERSION_1)
+    {
+        layer.for_each_feature(build_feature_from_v1<feature_builder_type>(f_builder, stats != nullptr ? &stats->skipped : nullptr, cancel));
+    }
+    else
+    {
+        layer.for_each_feature(build_feature_from_v2<feature_builder_type>(f_builder, cancel));
+    }
+}
+
+// The localizer of the features of `layer` overzoomed into `layer_builder`
+// with the `localize` option of composite, if set; null if the properties of
+// the layer are copied as they are.
+std::unique_ptr<feature_localizer> overzoom_localizer(vtzero::layer const& layer, vtzero::layer_builder& layer_builder,
+                                                      vtile::localize_options const* localize,
+                                                      std::vector<vtile::localize_key>& keys)
+{
+    if (localize == nullptr)
+    {
+        return nullptr;
+    }
+    keys = vtile::classify_keys(layer.key_table(), *localize);
+    if (vtile::keeps_all(keys))
+    {
+        return nullptr;
+    }
+    return std::make_unique<feature_localizer>(layer, keys, *localize, layer_builder);
+}
+
+// overzooms `layer` into a new layer of `builder`, localizing it if `localize` is set
+void overzoom_into(vtzero::tile_builder& builder, vtzero::layer& layer,
+                   std::uint32_t dx, std::uint32_t dy, std::uint32_t zoom_factor, int buffer_size,
+                   vtile::layer_stats* stats, vtile::localize_options const* localize, vtile::cancellation const* cancel)
+{
+    std::uint32_t const extent = layer.extent();
+    vtzero::layer_builder layer_builder{builder, layer.name(), layer.version(), extent};
+    vtzero::property_mapper mapper{layer, layer_builder};
+    std::vector<vtile::localize_key> keys;
+    std::unique_ptr<feature_localizer> const localizer = overzoom_localizer(layer, layer_builder, localize, keys);
+    if (use_narrow_coordinates(extent, zoom_factor, buffer_size))
+    {
+        overzoom_layer<std::int32_t>(layer, layer_builder, mapper, dx, dy, zoom_factor, buffer_size, stats, localizer.get(), cancel);
+    }
+    else
+    {
+        overzoom_layer<std::int64_t>(layer, layer_builder, mapper, dx, dy, zoom_factor, buffer_size, stats, localizer.get(), cancel);
+    }
+}
+
+// Counts the features of `layer` and their vertices. Features with malformed
+// geometries count no vertices.
+void count_features(vtzero::layer layer, std::uint64_t& features, std::uint64_t& vertices)
+{
+    while (auto feature = layer.next_feature())
+    {
+        ++features;
+        try
+        {
+            vertices += vtile::count_vertices(feature);
+        }
+        catch (vtzero::geometry_exception const& /*unused*/)
+        {
+        }
+    }
+}
+
+// counts a feature added to a layer of the output tile, if stats are collected
+void count_output_feature(vtile::layer_stats* stats, vtzero::feature const& feature)
+{
+    if (stats == nullptr)
+    {
+        return;
+    }
+    ++stats->features_out;
+    try
+    {
+        stats->vertices_out += vtile::count_vertices(feature);
+    }
+    catch (vtzero::geometry_exception const& /*unused*/)
+    {
+    }
+}
+
+// Adds the stats of a layer of the output tile to `stats`, counting its input
+// features and vertices. Returns null if stats are not collected.
+vtile::layer_stats* add_layer_stats(vtile::call_stats* stats, vtzero::layer const& layer)
+{
+    if (stats == nullptr)
+    {
+        return nullptr;
+    }
+    stats->layers.emplace_back();
+    vtile::layer_stats& result = stats->layers.back();
+    result.name = std::string(layer.name());
+    result.bytes_in = layer.data().size();
+    count_features(layer, result.features_in, result.vertices_in);
+    return &result;
+}
+
+// as add_layer_stats, for a layer copied to the output as it is
+void copy_layer_stats(vtile::call_stats* stats, vtzero::layer const& layer)
+{
+    vtile::layer_stats* result = add_layer_stats(stats, layer);
+    if (result != nullptr)
+    {
+        result->features_out = result->features_in;
+        result->vertices_out = result->vertices_in;
+    }
+}
+
+// as add_layer_stats, for a layer of a composite: layers that are not
+// overzoomed are added to the output as they are
+vtile::layer_stats* add_composite_layer_stats(vtile::call_stats* stats, vtzero::layer const& layer, std::uint32_t zoom_factor)
+{
+    vtile::layer_stats* result = add_layer_stats(stats, layer);
+    if (result != nullptr)
+    {
+        result->overzoomed = zoom_factor != 1;
+        if (!result->overzoomed)
+        {
+            result->features_out = result->features_in;
+            result->vertices_out = result->vertices_in;
+        }
+    }
+    return result;
+}
+
+// Adds `layer` to `builder` as localize would write it with `options`: as it
+// is if all its properties are kept as they are, otherwise rewritten. Empty
+// layers are left out. The features written replace the output counted in
+// `stats`, if set.
+void add_localized_layer(vtzero::tile_builder& builder, vtzero::layer layer,
+                         vtile::localize_options const& options, vtile::layer_stats* stats)
+{
+    if (layer.empty())
+    {
+        return;
+    }
+    std::vector<vtile::localize_key> const keys = vtile::classify_keys(layer.key_table(), options);
+    if (vtile::keeps_all(keys))
+    {
+        builder.add_existing_layer(layer);
+        return;
+    }
+    if (stats != nullptr)
+    {
+        stats->features_out = 0;
+        stats->vertices_out = 0;
+    }
+    vtzero::layer_builder lbuilder{builder, layer.name(), layer.version(), layer.extent()};
+    feature_localizer localizer{layer, keys, options, lbuilder};
+    while (auto feature = layer.next_feature())
+    {
+        if (localizer.accept(feature))
+        {
+            for (std::size_t copy = 0; copy < localizer.copies(); ++copy)
+            {
+                add_localized_feature(lbuilder, feature, localizer.properties(copy));
+                count_output_feature(stats, feature);
+            }
+        }
+    }
+}
+
+// an overzoomed layer encoded as a single-layer tile, shared with the layer cache
+using cached_layer = vtile::lru_cache<std::string>::value_type;
+
+// counts the output of an overzoomed layer taken from the layer cache
+void count_cached_layer(std::string const& data, vtile::layer_stats* stats)
+{
+    if (stats == nullptr)
+    {
+        return;
+    }
+    stats->cached = true;
+    if (!data.empty())
+    {
+        vtzero::vector_tile layer_tile{data};
+        count_features(layer_tile.next_layer(), stats->features_out, stats->vertices_out);
+    }
+}
+
+// Returns the overzoomed layer cached under `key`, or overzooms `layer` and
+// caches the result. Layers left without features are cached too (as empty
+// tiles), so that they are not clipped again either.
+cached_layer overzoom_through_cache(vtzero::layer layer, std::string const& key,
+                                    std::uint32_t dx, std::uint32_t dy, std::uint32_t zoom_factor, int buffer_size,
+                                    vtile::layer_stats* stats, vtile::cancellation const* cancel)
+{
+    auto& cache = vtile::layer_cache();
+    cached_layer cached = cache.get(key);
+    if (cached)
+    {
+        count_cached_layer(*cached, stats);
+        return cached;
+    }
+    vtzero::tile_builder layer_tile;
+    overzoom_into(layer_tile, layer, dx, dy, zoom_factor, buffer_size, stats, nullptr, cancel);
+    auto data = std::make_shared<std::string>();
+    layer_tile.serialize(*data);
+    cached = data;
+    cache.put(key, cached, data->size() + key.size());
+    return cached;
+}
+
+// adds the layer of a single-layer tile to `builder`, localizing it if
+// `localize` is set; empty tiles add nothing
+void add_layer_tile(vtzero::tile_builder& builder, std::string const& data,
+                    vtile::localize_options const* localize, vtile::layer_stats* stats)
+{
+    if (data.empty())
+    {
+        return;
+    }
+    vtzero::vector_tile layer_tile{data};
+    if (localize != nullptr)
+    {
+        add_localized_layer(builder, layer_tile.next_layer(), *localize, stats);
+    }
+    else
+    {
+        builder.add_existing_layer(layer_tile.next_layer());
+    }
+}
+
+template <typename CoordinateType>
+using feature_chunks = std::vector<std::vector<vtile::clipped_feature<CoordinateType>>>;
+
+// a layer picked for the output tile by CompositeWorker::composite_parallel
+struct composite_layer
+{
+    composite_layer(vtzero::layer const& layer_, std::uint32_t zoom_factor_)
+        : layer{layer_},
+          zoom_factor{zoom_factor_} {}
+
+    vtzero::layer layer;
+    std::uint32_t zoom_factor;
+    std::uint32_t dx = 0;
+    std::uint32_t dy = 0;
+    bool narrow = false; // overzoomed with 32-bit coordinates
+    std::vector<vtzero::feature> features{};
+    // clipped features, in narrow_chunks or wide_chunks depending on `narrow`
+    feature_chunks<std::int32_t> narrow_chunks{};
+    feature_chunks<std::int64_t> wide_chunks{};
+    std::string data{}; // the overzoomed layer encoded as a single-layer tile
+    std::string cache_key{}; // key in the layer cache, if enabled
+    cached_layer cached{};   // replaces `data` once found in or added to the layer cache
+    vtile::layer_stats* stats = nullptr;
+    std::vector<std::uint64_t> skipped{}; // by chunk, if stats are collected
+};
+
+template <typename CoordinateType>
+feature_chunks<CoordinateType>& chunks_of(composite_layer& l);
+
+template <>
+feature_chunks<std::int32_t>& chunks_of<std::int32_t>(composite_layer& l)
+{
+    return l.narrow_chunks;
+}
+
+template <>
+feature_chunks<std::int64_t>& chunks_of<std::int64_t>(composite_layer& l)
+{
+    return l.wide_chunks;
+}
+
+template <typename CoordinateType>
+void clip_layer_chunk(composite_layer& l, std::size_t chunk, int buffer_size, vtile::cancellation const* cancel)
+{
+    using collector_type = vtile::overzoomed_feature_collector<CoordinateType>;
+    auto const bbox = overzoom_bbox<CoordinateType>(l.layer.extent(), buffer_size);
+    collector_type collector{chunks_of<CoordinateType>(l)[chunk], bbox, l.dx, l.dy, l.zoom_factor};
+    auto const begin = l.features.begin() + static_cast<std::ptrdiff_t>(chunk * PARALLEL_CHUNK_SIZE);
+    auto const end = l.features.begin() + static_cast<std::ptrdiff_t>(std::min(l.features.size(), (chunk + 1) * PARALLEL_CHUNK_SIZE));
+    if (l.layer.version() == MVT_VERSION_1)
+    {
+        std::for_each(begin, end, build_feature_from_v1<collector_type>(collector, l.stats != nullptr ? &l.skipped[chunk] : nullptr, cancel));
+    }
+    else
+    {
+        std::for_each(begin, end, build_feature_from_v2<collector_type>(collector, cancel));
+    }
+}
+
+// encodes the clipped features of an overzoomed layer into l.data, localizing
+// them if `localize` is set
+template <typename CoordinateType>
+void encode_overzoomed_layer(composite_layer& l, int buffer_size, vtile::localize_options const* localize,
+                             vtile::cancellation const* cancel)
+{
+    using feature_builder_type = vtile::overzoomed_feature_builder<CoordinateType>;
+    vtzero::tile_builder layer_tile;
+    vtzero::layer_builder layer_builder{layer_tile, l.layer.name(), l.layer.version(), l.layer.extent()};
+    vtzero::property_mapper mapper{l.layer, layer_builder};
+    std::vector<vtile::localize_key> keys;
+    std::unique_ptr<feature_localizer> const localizer = overzoom_localizer(l.layer, layer_builder, localize, keys);
+    auto const bbox = overzoom_bbox<CoordinateType>(l.layer.extent(), buffer_size);
+    feature_builder_type f_builder{layer_builder, mapper, bbox, l.dx, l.dy, l.zoom_factor};
+    f_builder.stats_ = l.stats;
+    f_builder.writer_ = localizer.get();
+    auto& chunks = chunks_of<CoordinateType>(l);
+    for (auto& chunk : chunks)
+    {
+        vtile::check(cancel);
+        for (auto& clipped : chunk)
+        {
+            f_builder.emit(clipped);
+            vtile::recycle(clipped);
+        }
+    }
+    chunks.clear();
+    layer_tile.serialize(l.data);
+}
+
+// Holds the decompressed data of a source tile: a buffer of the calling
+// thread, or a tile shared with the tile cache.
+struct source_buffer
+{
+    vtile::pooled_buffer buffer{};
+    vtile::lru_cache<std::vector<char>>::value_type cached{};
+};
+
+// Returns the uncompressed data of a source tile, decompressing it into
+// `holder` if needed. With the tile cache enabled, compressed tiles are looked
+// up in the cache first and cached once decompressed. Brotli candidates that
+// do not decode are returned as they are.
+vtzero::data_view decompress_source(TileObject const& tile_obj, source_buffer& holder, vtile::call_stats* stats)
+{
+    vtile::codec const source_codec = vtile::detect_codec(tile_obj.data.data(), tile_obj.data.size());
+    if (source_codec == vtile::codec::none)
+    {
+        return tile_obj.data;
+    }
+    vtile::phase_timer const timer{vtile::phase(stats, &vtile::call_stats::decompress)};
+    auto& cache = vtile::tile_cache();
+    if (cache.enabled())
+    {
+        std::string const key = vtile::tile_cache_key(tile_obj.id, tile_obj.data.data(), tile_obj.data.size());
+        holder.cached = cache.get(key);
+        if (!holder.cached)
+        {
+            auto tile = std::make_shared<std::vector<char>>();
+            if (!vtile::decompress(source_codec, tile_obj.data.data(), tile_obj.data.size(), *tile))
+            {
+                return tile_obj.data;
+            }
+            holder.cached = tile;
+            cache.put(key, holder.cached, tile->size());
+        }
+        return {holder.cached->data(), holder.cached->size()};
+    }
+    holder.buffer = vtile::take_buffer();
+    if (!vtile::decompress(source_codec, tile_obj.data.data(), tile_obj.data.size(), *holder.buffer))
+    {
+        return tile_obj.data;
+    }
+    return {holder.buffer->data(), holder.buffer->size()};
+}
+
+// Decompresses the source tiles that need it into buffer_cache, on up to
+// `threads` threads. tile_views[i] is the uncompressed data of tiles[i].
+void decompress_sources(std::vector<std::unique_ptr<TileObject>> const& tiles,
+                        std::size_t threads,
+                        std::vector<source_buffer>& buffer_cache,
+                        std::vector<vtzero::data_view>& tile_views,
+                        vtile::call_stats* stats)
+{
+    tile_views.resize(tiles.size());
+    buffer_cache.resize(tiles.size());
+    auto const decompress_tile = [&](std::size_t i) {
+        tile_views[i] = decompress_source(*tiles[i], buffer_cache[i], stats);
+    };
+    vtile::parallel_for(tiles.size(), threads, decompress_tile, vtile::worker_pool());
+}
+
+// Calls func(layer, i) for the layers of the output tile in output order,
+// where `i` is the index of the source tile supplying the layer: the first
+// source to supply a layer name wins.
+template <typename Func>
+void for_each_output_layer(std::vector<std::unique_ptr<TileObject>> const& tiles,
+                           std::vector<vtzero::data_view> const& tile_views,
+                           Func&& func)
+{
+    std::vector<vtzero::data_view> names;
+    for (std::size_t i = 0; i < tiles.size(); ++i)
+    {
+        auto const& include_layers = tiles[i]->layers;
+        vtzero::vector_tile tile{tile_views[i]};
+        while (auto layer = tile.next_layer())
+        {
+            vtzero::data_view const name = layer.name();
+            if (std::find(names.begin(), names.end(), name) == names.end())
+            {
+                std::string sname(name);
+                if (include_layers.empty() || std::find(include_layers.begin(), include_layers.end(), sname) != include_layers.end())
+                {
+                    names.push_back(name);
+                    func(layer, i);
+                }
+            }
+        }
+    }
+}
+
+// Serializes `builder` into `output`, compressed as requested.
+void serialize_tile(vtzero::tile_builder& builder, vtile::compression_options const& compression, std::string& output,
+                    vtile::call_stats* stats)
+{
+    if (compression.codec != vtile::codec::none)
+    {
+        std::string& temp = vtile::serialize_buffer();
+        {
+            vtile::phase_timer const timer{vtile::phase(stats, &vtile::call_stats::serialize)};
+            builder.serialize(temp);
+        }
+
+        // If the serialized buffer is an empty string, do not
+        // compress it. This will lead to a non-zero byte string
+        // which can be perceived as a valid vector tile.
+        //
+        // Instead do nothing and return an empty, uncompressed buffer.
+        // If the user wants to handle empty tiles separately from non-empty
+        // tiles, they must check "buffer.length > 0" in the resulting callback.
+        // The same goes for tiles below compression.min_bytes, which are
+        // returned uncompressed.
+        vtile::phase_timer const timer{vtile::phase(stats, &vtile::call_stats::compress)};
+        if (!vtile::compress(compression, temp.data(), temp.size(), output))
+        {
+            output.assign(temp);
+        }
+        vtile::release_serialize_buffer();
+    }
+    else
+    {
+        vtile::phase_timer const timer{vtile::phase(stats, &vtile::call_stats::serialize)};
+        builder.serialize(output);
+    }
+}
+
+// Writes the serialized `tile` into `output`, compressed as requested (see
+// serialize_tile).
+void output_tile(vtzero::data_view tile, vtile::compression_options const& compression, std::string& output,
+                 vtile::call_stats* stats)
+{
+    if (compression.codec != vtile::codec::none)
+    {
+        vtile::phase_timer const timer{vtile::phase(stats, &vtile::call_stats::compress)};
+        if (vtile::compress(compression, tile.data(), tile.size(), output))
+        {
+            return;
+        }
+    }
+    output.assign(tile.data(), tile.size());
+}
+
+// Takes the features dropped to fit `max_bytes` (see vtile::capped_tile) off
+// the output counts of their layers.
+void count_dropped_features(vtile::call_stats* stats, std::vector<vtile::dropped_layer> const& dropped)
+{
+    if (stats == nullptr)
+    {
+        return;
+    }
+    for (auto const& d : dropped)
+    {
+        auto const layer = std::find_if(stats->layers.begin(), stats->layers.end(), [&d](vtile::layer_stats const& l) {
+            return l.name == d.name;
+        });
+        if (layer != stats->layers.end())
+        {
+            layer->dropped = d.features;
+            layer->features_out -= std::min(layer->features_out, d.features);
+            layer->vertices_out -= std::min(layer->vertices_out, d.vertices);
+        }
+    }
+}
+
+// True if a source tile compressed with `source_codec` (and `tile_size`
+// bytes once decompressed) can be returned as it is where `compression` is
+// requested: same codec, no explicit level, and not small enough to be
+// returned uncompressed. Zlib streams, which are read as gzip, don't match.
+bool source_compression_matches(vtile::codec source_codec, vtzero::data_view source, std::size_t tile_size,
+                                vtile::compression_options const& compression)
+{
+    if (source_codec != compression.codec || compression.level >= 0 || tile_size < compression.min_bytes)
+    {
+        return false;
+    }
+    if (source_codec == vtile::codec::gzip)
+    {
+        return source.size() > 2 && static_cast<unsigned char>(source.data()[0]) == 0x1f && static_cast<unsigned char>(source.data()[1]) == 0x8b;
+    }
+    return true;
+}
+
+// Hands `data` over to a JS buffer without copying it.
+Napi::Buffer<char> external_buffer(Napi::Env env, std::unique_ptr<std::string> data)
+{
+    std::string& tile_buffer = *data;
+    auto buffer = Napi::Buffer<char>::New(
+        env,
+        tile_buffer.empty() ? nullptr : &tile_buffer[0],
+        tile_buffer.size(),
+        [](Napi::Env env_, char* /*unused*/, std::string* str_ptr) {
+            if (str_ptr != nullptr)
+            {
+                Napi::MemoryManagement::AdjustExternalMemory(env_, -static_cast<std::int64_t>(str_ptr->size()));
+            }
+            delete str_ptr;
+        },
+        data.release());
+    Napi::MemoryManagement::AdjustExternalMemory(env, static_cast<std::int64_t>(tile_buffer.size()));
+    return buffer;
+}
+
+// the total size of the source tiles, as given
+std::uint64_t source_bytes(std::vector<std::unique_ptr<TileObject>> const& tiles)
+{
+    std::uint64_t bytes = 0;
+    for (auto const& tile_obj : tiles)
+    {
+        bytes += tile_obj->data.size();
+    }
+    return bytes;
+}
+
+Napi::Object phase_object(Napi::Env env, vtile::phase_time const& time)
+{
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("wall", Napi::Number::New(env, static_cast<double>(time.wall_ns.load()) / 1e6));
+    result.Set("cpu", Napi::Number::New(env, static_cast<double>(time.cpu_ns.load()) / 1e6));
+    return result;
+}
+
+// the features dropped to fit `max_bytes` and the bytes the tile lost
+Napi::Object dropped_object(Napi::Env env, std::uint64_t features, std::uint64_t bytes)
+{
+    Napi::Object dropped = Napi::Object::New(env);
+    dropped.Set("features", Napi::Number::New(env, static_cast<double>(features)));
+    dropped.Set("bytes", Napi::Number::New(env, static_cast<double>(bytes)));
+    return dropped;
+}
+
+// The stats object passed to the callback of a call made with `stats: true`.
+// Times are in milliseconds.
+Napi::Object stats_object(Napi::Env env, vtile::call_stats const& stats)
+{
+    Napi::Object time = Napi::Object::New(env);
+    time.Set("decompress", phase_object(env, stats.decompress));
+    time.Set("overzoom", phase_object(env, stats.overzoom));
+    time.Set("localize", phase_object(env, stats.localize));
+    time.Set("serialize", phase_object(env, stats.serialize));
+    time.Set("compress", phase_object(env, stats.compress));
+    std::uint64_t properties_ns = 0;
+    std::uint64_t features_dropped = 0;
+    Napi::Array layers = Napi::Array::New(env, stats.layers.size());
+    std::uint32_t index = 0;
+    for (auto const& l : stats.layers)
+    {
+        properties_ns += l.properties_ns;
+        Napi::Object layer = Napi::Object::New(env);
+        layer.Set("name", Napi::String::New(env, l.name));
+        layer.Set("overzoomed", Napi::Boolean::New(env, l.overzoomed));
+        layer.Set("cached", Napi::Boolean::New(env, l.cached));
+        layer.Set("bytes_in", Napi::Number::New(env, static_cast<double>(l.bytes_in)));
+        layer.Set("features_in", Napi::Number::New(env, static_cast<double>(l.features_in)));
+        layer.Set("features_out", Napi::Number::New(env, static_cast<double>(l.features_out)));
+        layer.Set("vertices_in", Napi::Number::New(env, static_cast<double>(l.vertices_in)));
+        layer.Set("vertices_out", Napi::Number::New(env, static_cast<double>(l.vertices_out)));
+        layer.Set("skipped", Napi::Number::New(env, static_cast<double>(l.skipped)));
+        layer.Set("dropped", Napi::Number::New(env, static_cast<double>(l.dropped)));
+        features_dropped += l.dropped;
+        layers.Set(index++, layer);
+    }
+    // wall time only: properties are timed per feature, on the steady clock
+    Napi::Object properties = Napi::Object::New(env);
+    properties.Set("wall", Napi::Number::New(env, static_cast<double>(properties_ns) / 1e6));
+    time.Set("properties", properties);
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("time", time);
+    result.Set("bytes_in", Napi::Number::New(env, static_cast<double>(stats.bytes_in)));
+    result.Set("bytes_out", Napi::Number::New(env, static_cast<double>(stats.bytes_out)));
+    result.Set("dropped", dropped_object(env, features_dropped, stats.bytes_dropped));
+    result.Set("layers", layers);
+    return result;
+}
+
+// Appends the stats argument of the callback to `result` if the call collects
+// stats, or if allocations are counted.
+void add_stats_argument(Napi::Env env, vtile::call_stats const* stats, vtile::allocation_counter const* allocations,
+                        std::vector<napi_value>& result)
+{
+    Napi::Object object = stats != nullptr ? stats_object(env, *stats) : Napi::Object{};
+#ifdef VTCOMPOSITE_COUNT_ALLOCATIONS
+    if (allocations != nullptr)
+    {
+        if (object.IsEmpty())
+        {
+            object = Napi::Object::New(env);
+        }
+        object.Set("allocations", Napi::Number::New(env, static_cast<double>(allocations->count.load())));
+    }
+#else
+    static_cast<void>(allocations);
+#endif
+    if (!object.IsEmpty())
+    {
+        result.push_back(object);
+    }
+}
+
+std::string invalid_request_message(TileObject const& tile_obj, TargetTile const& target)
+{
+    std::ostringstream os;
+    os << "Invalid tile composite request: SOURCE("
+       << tile_obj.z << "," << tile_obj.x << "," << tile_obj.y << ")"
+       << " TARGET(" << target.z << "," << target.x << "," << target.y << ")";
+    return os.str();
+}
+
+// a source layer overzoomed into one of the target tiles of compositeBatch
+template <typename CoordinateType>
+struct batch_layer_target
+{
+    batch_layer_target(vtzero::tile_builder& tile, vtzero::layer const& layer,
+                       std::uint32_t dx, std::uint32_t dy, std::uint32_t zoom_factor, int buffer_size)
+        : layer_builder{tile, layer.name(), layer.version(), layer.extent()},
+          mapper{layer, layer_builder},
+          bbox{overzoom_bbox<CoordinateType>(layer.extent(), buffer_size)},
+          f_builder{layer_builder, mapper, bbox, dx, dy, zoom_factor} {}
+
+    vtzero::layer_builder layer_builder;
+    vtzero::property_mapper mapper;
+    mapbox::geometry::box<CoordinateType> bbox;
+    vtile::overzoomed_feature_builder<CoordinateType> f_builder;
+};
+
+// a layer of the output tiles of compositeBatch, with the targets it is
+// overzoomed into
+struct batch_layer
+{
+    batch_layer(vtzero::layer const& layer_, std::size_t source_, std::uint32_t source_z_)
+        : layer{layer_},
+          source{source_},
+          source_z{source_z_} {}
+
+    // The envelope of each feature is computed once for all targets, and the
+    // feature is only decoded and clipped for the targets it touches.
+    void apply(vtzero::feature const& feature)
+    {
+        auto const extent = vtile::source_envelope(feature);
+        for (auto& target : narrow_targets)
+        {
+            target->f_builder.apply(feature, extent);
+        }
+        for (auto& target : wide_targets)
+        {
+            target->f_builder.apply(feature, extent);
+        }
+    }
+
+    void overzoom()
+    {
+        if (narrow_targets.empty() && wide_targets.empty())
+        {
+            return;
+        }
+        for (auto& target : narrow_targets)
+        {
+            target->f_builder.stats_ = stats;
+        }
+        for (auto& target : wide_targets)
+        {
+            target->f_builder.stats_ = stats;
+        }
+        if (layer.version() == MVT_VERSION_1)
+        {
+            layer.for_each_feature(build_feature_from_v1<batch_layer>(*this, stats != nullptr ? &stats->skipped : nullptr, cancel));
+        }
+        else
+        {
+            layer.for_each_feature(build_feature_from_v2<batch_layer>(*this, cancel));
+        }
+        for (std::size_t m = 0; m < misses.size(); ++m)
+        {
+            auto data = std::make_shared<std::string>();
+            miss_tiles[m].serialize(*data);
+            std::string const& key = misses[m].second;
+            cached[misses[m].first] = data;
+            vtile::layer_cache().put(key, cached[misses[m].first], data->size() + key.size());
+        }
+    }
+
+    vtzero::layer layer;
+    std::size_t source; // index of the source tile
+    std::uint32_t source_z;
+    std::vector<std::unique_ptr<batch_layer_target<std::int32_t>>> narrow_targets{};
+    std::vector<std::unique_ptr<batch_layer_target<std::int64_t>>> wide_targets{};
+    // With the layer cache enabled, the layer is overzoomed into a tile of its
+    // own for every target that missed the cache, and these tiles are cached.
+    std::vector<vtzero::tile_builder> miss_tiles{};
+    std::vector<std::pair<std::size_t, std::string>> misses{}; // target index and cache key
+    std::vector<cached_layer> cached{};                         // by target, for hits and misses
+    vtile::layer_stats* stats = nullptr;                        // summed over targets
+    vtile::cancellation const* cancel = nullptr;                // checked before each feature if set
+};
+
+// The work estimate of a composite call compared with inline_threshold(): the
+// size of its source tiles, unless they need to be overzoomed or the call asks
+// for several threads, which are never run inline.
+std::size_t composite_work(BatonType const& baton)
+{
+    std::size_t work = 0;
+    if (baton.threads > 1)
+    {
+        return std::numeric_limits<std::size_t>::max();
+    }
+    for (auto const& tile_obj : baton.tiles)
+    {
+        if (tile_obj->z != baton.z)
+        {
+            return std::numeric_limits<std::size_t>::max();
+        }
+        work += tile_obj->data.size();
+    }
+    return work;
+}
+
+// Memory estimates of calls reserved in vtile::native_memory(), as multiples
+// of the decompressed size of their tiles: overzooming a tile by one zoom
+// level takes about twice its size in features being clipped and layer
+// builders. Coordinates grow by a bit with each further zoom level, which
+// adds about one more tile size every OVERZOOM_MEMORY_DZ_STEP levels (a
+// byte per varint), up to MAX_OVERZOOM_MEMORY_DZ, by which point features
+// are clipped with 64-bit coordinates. All of this doubles when the layers
+// of a tile are overzoomed on several threads at once.
+constexpr std::size_t OVERZOOM_MEMORY_FACTOR = 2;
+constexpr std::uint32_t OVERZOOM_MEMORY_DZ_STEP = 7;
+constexpr std::uint32_t MAX_OVERZOOM_MEMORY_DZ = 21;
+
+// the memory of overzooming a tile by `dz` zoom levels, as a multiple of its
+// decompressed size
+std::size_t overzoom_memory_factor(std::uint32_t dz, std::uint32_t threads)
+{
+    std::size_t const factor = OVERZOOM_MEMORY_FACTOR + std::min(dz, MAX_OVERZOOM_MEMORY_DZ) / OVERZOOM_MEMORY_DZ_STEP;
+    return threads > 1 ? 2 * factor : factor;
+}
+
+// The decompressed size of `data`, added to `memory` as a buffer of its own if
+// `data` is compressed.
+std::size_t source_memory(vtzero::data_view data, std::size_t& memory)
+{
+    vtile::codec const source_codec = vtile::detect_codec(data.data(), data.size());
+    if (source_codec == vtile::codec::none)
+    {
+        return data.size();
+    }
+    std::size_t const size = vtile::decompressed_size(source_codec, data.data(), data.size());
+    memory += size;
+    return size;
+}
+
+// The memory of writing `outputs` tiles of `size` bytes, compressed or not.
+std::size_t output_memory(std::size_t outputs, std::size_t size, vtile::compression_options const& compression)
+{
+    std::size_t const copies = compression.codec == vtile::codec::none ? 1 : 2;
+    return outputs * size * copies;
+}
+
+// The memory estimate of a composite call: its decompressed sources, the
+// overzoomed ones several times over, and its output, which is at most as
+// large as the sources (held once more as layers with `max_bytes`).
+std::size_t composite_memory(BatonType const& baton)
+{
+    std::size_t memory = 0;
+    std::size_t tiles_size = 0;
+    for (auto const& tile_obj : baton.tiles)
+    {
+        std::size_t const size = source_memory(tile_obj->data, memory);
+        tiles_size += size;
+        if (tile_obj->z < baton.z)
+        {
+            memory += overzoom_memory_factor(baton.z - tile_obj->z, baton.threads) * size;
+        }
+    }
+    std::size_t const outputs = baton.drop.max_bytes > 0 ? 2 : 1;
+    return memory + output_memory(outputs, tiles_size, baton.compression);
+}
+
+// The memory estimate of a compositeBatch call: as composite, with one output
+// per target zoom level, since the targets at one zoom level together cover
+// the sources at most once.
+std::size_t composite_batch_memory(BatonType const& baton, std::vector<TargetTile> const& targets)
+{
+    std::vector<std::uint32_t> zooms;
+    zooms.reserve(targets.size());
+    for (auto const& target : targets)
+    {
+        zooms.push_back(target.z);
+    }
+    std::sort(zooms.begin(), zooms.end());
+    auto const num_zooms = static_cast<std::size_t>(std::distance(zooms.begin(), std::unique(zooms.begin(), zooms.end())));
+    std::uint32_t const max_z = zooms.empty() ? 0 : zooms.back();
+    std::size_t memory = 0;
+    std::size_t tiles_size = 0;
+    for (auto const& tile_obj : baton.tiles)
+    {
+        std::size_t const size = source_memory(tile_obj->data, memory);
+        tiles_size += size;
+        // as deep as the deepest target, and at least one zoom level
+        std::uint32_t const dz = tile_obj->z < max_z ? max_z - tile_obj->z : 1;
+        memory += overzoom_memory_factor(dz, baton.threads) * size;
+    }
+    return memory + output_memory(num_zooms, tiles_size, baton.compression);
+}
+
+// The memory estimate of a localize or localizeBatch call: its decompressed
+// tile and one output of about the same size per variant.
+std::size_t localize_memory(LocalizeBatonType const& baton)
+{
+    std::size_t memory = 0;
+    std::size_t const size = source_memory(baton.data, memory);
+    return memory + output_memory(std::max<std::size_t>(baton.variants.size(), 1), size, baton.compression);
+}
+
+} // namespace
+
+struct CompositeWorker : vtile::Worker
+{
+    using Base = vtile::Worker;
+
+    CompositeWorker(std::unique_ptr<BatonType>&& baton_data, Napi::Function& cb)
+        : Base(cb, baton_data->lane),
+          baton_data_{std::move(baton_data)},
+          output_buffer_{std::make_unique<std::string>()} {}
+
+    CompositeWorker(std::unique_ptr<BatonType>&& baton_data, Napi::Env env)
+        : Base(env),
+          baton_data_{std::move(baton_data)},
+          output_buffer_{std::make_unique<std::string>()} {}
+
+    ~CompositeWorker() override
+    {
+        release_baton(baton_data_);
+    }
+
+    std::string invalid_request_message(TileObject const& tile_obj) const
+    {
+        return vtile::invalid_request_message(tile_obj, {baton_data_->z, baton_data_->x, baton_data_->y});
+    }
+
+    bool composite_sequential(vtzero::tile_builder& builder,
+                              std::vector<source_buffer>& buffer_cache,
+                              std::vector<cached_layer>& cached_layers)
+    {
+        bool const use_layer_cache = vtile::layer_cache().enabled();
+        vtile::localize_options const* const localize = baton_data_->localize.get();
+        vtile::cancellation const* const cancel = baton_data_->cancel.if_active();
+        std::vector<vtzero::data_view> names;
+
+        int const buffer_size = baton_data_->buffer_size;
+        std::uint32_t const target_z = baton_data_->z;
+        std::uint32_t const target_x = baton_data_->x;
+        std::uint32_t const target_y = baton_data_->y;
+
+        for (auto const& tile_obj : baton_data_->tiles)
+        {
+            if (vtile::within_target(*tile_obj, target_z, target_x, target_y))
+            {
+                buffer_cache.emplace_back();
+                vtzero::data_view const tile_view = decompress_source(*tile_obj, buffer_cache.back(), stats_.get());
+
+                std::uint32_t zoom_factor = 1U << (target_z - tile_obj->z);
+                std::string const source_key = use_layer_cache && zoom_factor != 1
+                                                   ? vtile::tile_cache_key(tile_obj->id, tile_obj->data.data(), tile_obj->data.size())
+                                                   : std::string{};
+                std::vector<std::string> include_layers = tile_obj->layers;
+                vtzero::vector_tile tile{tile_view};
+                while (auto layer = tile.next_layer())
+                {
+                    vtile::check(cancel);
+                    vtzero::data_view const name = layer.name();
+                    if (std::find(names.begin(), names.end(), name) == names.end())
+                    {
+                        // should we keep this layer?
+                        // if include_layers is empty, keep all layers
+                        // if include_layers is not empty, keep layer if we can find its name in the vector
+                        std::string sname(name);
+                        if (include_layers.empty() || std::find(include_layers.begin(), include_layers.end(), sname) != include_layers.end())
+                        {
+                            names.push_back(name);
+                            vtile::layer_stats* const lstats = add_composite_layer_stats(stats_.get(), layer, zoom_factor);
+                            if (zoom_factor == 1)
+                            {
+                                add_source_layer(builder, layer, lstats);
+                                continue;
+                            }
+                            vtile::phase_timer const timer{vtile::phase(stats_.get(), &vtile::call_stats::overzoom)};
+                            std::uint32_t dx = 0;
+                            std::uint32_t dy = 0;
+                            std::tie(dx, dy) = vtile::displacement(tile_obj->z, layer.extent(), target_z, target_x, target_y);
+                            if (use_layer_cache)
+                            {
+                                std::string const key = vtile::layer_cache_key(source_key, tile_obj->z, sname, target_z, target_x, target_y, buffer_size);
+                                // cached layers are not localized, so that they are shared by all languages
+                                cached_layers.push_back(overzoom_through_cache(layer, key, dx, dy, zoom_factor, buffer_size, lstats, cancel));
+                                output_layer_tile(builder, *cached_layers.back(), localize, lstats);
+                            }
+                            else
+                            {
+                                output_layers(builder, [&](vtzero::tile_builder& b) {
+                                    overzoom_into(b, layer, dx, dy, zoom_factor, buffer_size, lstats, localize, cancel);
+                                });
+                            }
+                        }
+                    }
+                }
+            }
+            else
+            {
+                SetError(invalid_request_message(*tile_obj));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Same output as composite_sequential, but source tiles are decompressed
+    // concurrently and overzoomed layers are clipped in chunks of features on
+    // up to `threads` threads. Layers are then encoded concurrently into their
+    // own buffers and added to `builder` in the order composite_sequential
+    // would have produced them, so the resulting tile is byte-identical.
+    bool composite_parallel(vtzero::tile_builder& builder,
+                            std::vector<source_buffer>& buffer_cache,
+                            std::vector<composite_layer>& layers)
+    {
+        int const buffer_size = baton_data_->buffer_size;
+        std::uint32_t const target_z = baton_data_->z;
+        std::uint32_t const target_x = baton_data_->x;
+        std::uint32_t const target_y = baton_data_->y;
+        std::size_t const threads = baton_data_->threads;
+        vtile::thread_pool* const pool = vtile::worker_pool();
+        vtile::cancellation const* const cancel = baton_data_->cancel.if_active();
+        auto const& tiles = baton_data_->tiles;
+
+        for (auto const& tile_obj : tiles)
+        {
+            if (!vtile::within_target(*tile_obj, target_z, target_x, target_y))
+            {
+                SetError(invalid_request_message(*tile_obj));
+                return false;
+            }
+        }
+
+        // decompress all source tiles
+        std::vector<vtzero::data_view> tile_views;
+        decompress_sources(tiles, threads, buffer_cache, tile_views, stats_.get());
+
+        // pick layers in output order
+        bool const use_layer_cache = vtile::layer_cache().enabled();
+        std::vector<std::string> source_keys(tiles.size());
+        for_each_output_layer(tiles, tile_views, [&](vtzero::layer const& layer, std::size_t i) {
+            std::uint32_t const source_z = tiles[i]->z;
+            layers.emplace_back(layer, 1U << (target_z - source_z));
+            composite_layer& l = layers.back();
+            l.stats = add_composite_layer_stats(stats_.get(), layer, l.zoom_factor);
+            if (l.zoom_factor != 1)
+            {
+                std::tie(l.dx, l.dy) = vtile::displacement(source_z, layer.extent(), target_z, target_x, target_y);
+                if (use_layer_cache)
+                {
+                    if (source_keys[i].empty())
+                    {
+                        source_keys[i] = vtile::tile_cache_key(tiles[i]->id, tiles[i]->data.data(), tiles[i]->data.size());
+                    }
+                    l.cache_key = vtile::layer_cache_key(source_keys[i], source_z, std::string(layer.name()), target_z, target_x, target_y, buffer_size);
+                }
+            }
+        });
+
+        // split overzoomed layers into chunks of features. `layers` does not change size from
+        // here on, so the features can safely refer to their layer.
+        struct chunk_task
+        {
+            composite_layer* layer;
+            std::size_t chunk;
+        };
+        std::vector<chunk_task> chunk_tasks;
+        std::vector<composite_layer*> overzoomed_layers;
+        for (auto& l : layers)
+        {
+            if (l.zoom_factor == 1)
+            {
+                continue;
+            }
+            if (!l.cache_key.empty())
+            {
+                l.cached = vtile::layer_cache().get(l.cache_key);
+                if (l.cached)
+                {
+                    count_cached_layer(*l.cached, l.stats);
+                    continue;
+                }
+            }
+            l.features.reserve(l.layer.num_features());
+            while (auto feature = l.layer.next_feature())
+            {
+                l.features.push_back(feature);
+            }
+            std::size_t const num_chunks = (l.features.size() + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+            if (l.stats != nullptr)
+            {
+                l.skipped.resize(num_chunks);
+            }
+            l.narrow = use_narrow_coordinates(l.layer.extent(), l.zoom_factor, buffer_size);
+            if (l.narrow)
+            {
+                l.narrow_chunks.resize(num_chunks);
+            }
+            else
+            {
+                l.wide_chunks.resize(num_chunks);
+            }
+            for (std::size_t c = 0; c < num_chunks; ++c)
+            {
+                chunk_tasks.push_back({&l, c});
+            }
+            overzoomed_layers.push_back(&l);
+        }
+
+        // clip
+        vtile::phase_time* const overzoom_time = vtile::phase(stats_.get(), &vtile::call_stats::overzoom);
+        auto const clip_chunk = [&](std::size_t i) {
+            vtile::phase_timer const timer{overzoom_time};
+            composite_layer& l = *chunk_tasks[i].layer;
+            if (l.narrow)
+            {
+                clip_layer_chunk<std::int32_t>(l, chunk_tasks[i].chunk, buffer_size, cancel);
+            }
+            else
+            {
+                clip_layer_chunk<std::int64_t>(l, chunk_tasks[i].chunk, buffer_size, cancel);
+            }
+        };
+        vtile::parallel_for(chunk_tasks.size(), threads, clip_chunk, pool);
+
+        // encode every overzoomed layer into its own single-layer tile
+        auto const encode_layer = [&](std::size_t i) {
+            vtile::phase_timer const timer{overzoom_time};
+            composite_layer& l = *overzoomed_layers[i];
+            if (l.stats != nullptr)
+            {
+                l.stats->skipped = std::accumulate(l.skipped.begin(), l.skipped.end(), std::uint64_t{0});
+            }
+            // layers going to the layer cache are localized once cached (as
+            // in composite_sequential)
+            vtile::localize_options const* const localize = l.cache_key.empty() ? baton_data_->localize.get() : nullptr;
+            if (l.narrow)
+            {
+                encode_overzoomed_layer<std::int32_t>(l, buffer_size, localize, cancel);
+            }
+            else
+            {
+                encode_overzoomed_layer<std::int64_t>(l, buffer_size, localize, cancel);
+            }
+        };
+        vtile::parallel_for(overzoomed_layers.size(), threads, encode_layer, pool);
+
+        for (composite_layer* l : overzoomed_layers)
+        {
+            if (!l->cache_key.empty())
+            {
+                auto data = std::make_shared<std::string const>(std::move(l->data));
+                l->cached = data;
+                vtile::layer_cache().put(l->cache_key, data, data->size() + l->cache_key.size());
+            }
+        }
+
+        // stitch
+        for (auto const& l : layers)
+        {
+            vtile::check(cancel);
+            if (l.zoom_factor == 1)
+            {
+                add_source_layer(builder, l.layer, l.stats);
+            }
+            else if (l.cached)
+            {
+                vtile::phase_timer const timer{vtile::phase(stats_.get(), &vtile::call_stats::localize)};
+                output_layer_tile(builder, *l.cached, baton_data_->localize.get(), l.stats);
+            }
+            else
+            {
+                output_layer_tile(builder, l.data, nullptr, l.stats);
+            }
+        }
+        return true;
+    }
+
+    // adds a layer of a source tile at the target zoom to `builder`,
+    // localizing it if the `localize` option is set
+    void add_source_layer(vtzero::tile_builder& builder, vtzero::layer const& layer, vtile::layer_stats* lstats)
+    {
+        if (baton_data_->localize)
+        {
+            vtile::phase_timer const timer{vtile::phase(stats_.get(), &vtile::call_stats::localize)};
+            output_layers(builder, [&](vtzero::tile_builder& b) {
+                add_localized_layer(b, layer, *baton_data_->localize, lstats);
+            });
+        }
+        else
+        {
+            output_existing_layer(builder, layer);
+        }
+    }
+
+    // With `max_bytes`, the layers of the output tile go through capped_
+    // before they are added to `builder`, so that the features to drop are
+    // left out first. The three functions below add layers to one or the
+    // other.
+
+    // adds `layer`, whose data outlives the call, to the output tile
+    void output_existing_layer(vtzero::tile_builder& builder, vtzero::layer const& layer)
+    {
+        if (capped_)
+        {
+            capped_->add_existing_layer(layer);
+        }
+        else
+        {
+            builder.add_existing_layer(layer);
+        }
+    }
+
+    // adds the layers `build` adds to the tile builder it is called with
+    template <typename Build>
+    void output_layers(vtzero::tile_builder& builder, Build&& build)
+    {
+        if (capped_)
+        {
+            capped_->build_layers(std::forward<Build>(build));
+        }
+        else
+        {
+            std::forward<Build>(build)(builder);
+        }
+    }
+
+    // as add_layer_tile
+    void output_layer_tile(vtzero::tile_builder& builder, std::string const& data,
+                           vtile::localize_options const* localize, vtile::layer_stats* lstats)
+    {
+        if (!capped_ || data.empty())
+        {
+            add_layer_tile(builder, data, localize, lstats);
+        }
+        else if (localize == nullptr)
+        {
+            capped_->add_existing_layer(vtzero::vector_tile{data}.next_layer());
+        }
+        else
+        {
+            capped_->build_layers([&](vtzero::tile_builder& b) {
+                add_layer_tile(b, data, localize, lstats);
+            });
+        }
+    }
+
+    void Execute() override
+    {
+        vtile::allocation_scope const scope{&allocations_};
+        try
+        {
+            vtile::check(baton_data_->cancel.if_active());
+            if (stats_)
+            {
+                stats_->bytes_in = source_bytes(baton_data_->tiles);
+            }
+            vtzero::tile_builder builder;
+            // all hold data referenced by `builder` until it is serialized
+            std::vector<source_buffer> buffer_cache;
+            std::vector<composite_layer> layers;
+            std::vector<cached_layer> cached_layers;
+            if (baton_data_->drop.max_bytes > 0)
+            {
+                capped_ = std::make_unique<vtile::capped_tile>(baton_data_->drop);
+            }
+
+            bool const ok = baton_data_->threads > 1
+                                ? composite_parallel(builder, buffer_cache, layers)
+                                : composite_sequential(builder, buffer_cache, cached_layers);
+            if (!ok)
+            {
+                return;
+            }
+
+            if (capped_)
+            {
+                vtile::phase_timer const timer{vtile::phase(stats_.get(), &vtile::call_stats::serialize)};
+                std::vector<vtile::dropped_layer> const dropped = capped_->add_to(builder, stats_ != nullptr, bytes_dropped_);
+                for (auto const& d : dropped)
+                {
+                    features_dropped_ += d.features;
+                }
+                count_dropped_features(stats_.get(), dropped);
+                if (stats_)
+                {
+                    stats_->bytes_dropped = bytes_dropped_;
+                }
+            }
+            serialize_tile(builder, baton_data_->compression, *output_buffer_, stats_.get());
+            capped_.reset();
+        }
+        catch (std::exception const& e)
+        {
+            SetError(e.what());
+        }
+    }
+    std::vector<napi_value> GetResult(Napi::Env env) override
+    {
+        if (output_buffer_)
+        {
+            if (stats_)
+            {
+                stats_->bytes_out = output_buffer_->size();
+            }
+            std::vector<napi_value> result{env.Null(), external_buffer(env, std::move(output_buffer_))};
+            add_stats_argument(env, stats_.get(), &allocations_, result);
+            if (!stats_ && baton_data_->drop.max_bytes > 0)
+            {
+                // what was dropped is reported without stats too
+                if (result.size() < 3)
                 {
-                    is_localized_tile_with_all_languages = true;
+                    result.push_back(Napi::Object::New(env));
                 }
-                else
+                Napi::Object(env, result.back()).Set("dropped", dropped_object(env, features_dropped_, bytes_dropped_));
+            }
+            return result;
+        }
+        return Base::GetResult(env); // returns an empty vector (default)
+    }
+
+    std::unique_ptr<BatonType> baton_data_; // handed back to baton_pool() when done
+    std::unique_ptr<std::string> output_buffer_;
+    std::unique_ptr<vtile::capped_tile> capped_{}; // while Execute runs with `max_bytes`
+    std::uint64_t features_dropped_ = 0;
+    std::uint64_t bytes_dropped_ = 0;
+    std::unique_ptr<vtile::call_stats> const stats_{baton_data_->stats ? std::make_unique<vtile::call_stats>() : nullptr};
+    vtile::allocation_counter allocations_{};
+};
+
+Napi::Value composite(Napi::CallbackInfo const& info)
+{
+    // validate callback function
+    std::size_t length = info.Length();
+    if (length == 0)
+    {
+        Napi::Error::New(info.Env(), "last argument must be a callback function").ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+    Napi::Value callback_val = info[length - 1];
+    if (!callback_val.IsFunction())
+    {
+        Napi::Error::New(info.Env(), "last argument must be a callback function").ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+
+    Napi::Function callback = callback_val.As<Napi::Function>();
+
+    std::unique_ptr<BatonType> baton_data = baton_pool<BatonType>().acquire();
+    std::string error = parse_tiles(info[0], *baton_data);
+    if (!error.empty())
+    {
+        return utils::CallbackError(error, info);
+    }
+
+    error = parse_zxy(info[1], *baton_data);
+    if (!error.empty())
+    {
+        return utils::CallbackError(error, info);
+    }
+
+    if (info.Length() > 3) // options
+    {
+        error = parse_composite_options(info[2], *baton_data);
+        if (!error.empty())
+        {
+            return utils::CallbackError(error, info);
+        }
+    }
+    std::size_t const work = composite_work(*baton_data);
+    std::size_t const memory = composite_memory(*baton_data);
+    auto* worker = new CompositeWorker{std::move(baton_data), callback};
+    worker->Queue(work, memory);
+    return info.Env().Undefined();
+}
+
+Napi::Value composite_packed(Napi::CallbackInfo const& info)
+{
+    // validate callback function
+    std::size_t length = info.Length();
+    if (length == 0)
+    {
+        Napi::Error::New(info.Env(), "last argument must be a callback function").ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+    Napi::Value callback_val = info[length - 1];
+    if (!callback_val.IsFunction())
+    {
+        Napi::Error::New(info.Env(), "last argument must be a callback function").ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+
+    Napi::Function callback = callback_val.As<Napi::Function>();
+
+    std::unique_ptr<BatonType> baton_data = baton_pool<BatonType>().acquire();
+    std::string error = parse_packed_tiles(info[0], info[1], *baton_data);
+    if (!error.empty())
+    {
+        return utils::CallbackError(error, info);
+    }
+
+    if (info.Length() > 3) // options
+    {
+        error = parse_composite_options(info[2], *baton_data);
+        if (!error.empty())
+        {
+            return utils::CallbackError(error, info);
+        }
+    }
+    std::size_t const work = composite_work(*baton_data);
+    std::size_t const memory = composite_memory(*baton_data);
+    auto* worker = new CompositeWorker{std::move(baton_data), callback};
+    worker->Queue(work, memory);
+    return info.Env().Undefined();
+}
+
+Napi::Value composite_sync(Napi::CallbackInfo const& info)
+{
+    std::unique_ptr<BatonType> baton_data = baton_pool<BatonType>().acquire();
+    std::string error = parse_tiles(info[0], *baton_data);
+    if (error.empty())
+    {
+        error = parse_zxy(info[1], *baton_data);
+    }
+    if (error.empty() && info.Length() > 2) // options
+    {
+        error = parse_composite_options(info[2], *baton_data);
+    }
+    if (!error.empty())
+    {
+        Napi::Error::New(info.Env(), error).ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+    std::size_t const memory = composite_memory(*baton_data);
+    CompositeWorker worker{std::move(baton_data), info.Env()};
+    return worker.RunSync(memory);
+}
+
+// Composites the same source tiles into several target tiles at once. Each
+// source is decompressed and its layers are picked only once, and every
+// feature of an overzoomed layer is only decoded and clipped for the targets
+// its envelope touches. Every output is byte-identical to what composite
+// returns for the same target.
+struct CompositeBatchWorker : vtile::Worker
+{
+    using Base = vtile::Worker;
+
+    CompositeBatchWorker(std::unique_ptr<BatonType>&& baton_data, std::vector<TargetTile>&& targets, Napi::Function& cb)
+        : Base(cb, baton_data->lane),
+          baton_data_{std::move(baton_data)},
+          targets_{std::move(targets)} {}
+
+    ~CompositeBatchWorker() override
+    {
+        release_baton(baton_data_);
+    }
+
+    void Execute() override
+    {
+        vtile::allocation_scope const scope{&allocations_};
+        try
+        {
+            auto const& tiles = baton_data_->tiles;
+            std::size_t const threads = baton_data_->threads;
+            int const buffer_size = baton_data_->buffer_size;
+            vtile::cancellation const* const cancel = baton_data_->cancel.if_active();
+            vtile::check(cancel);
+
+            for (auto const& target : targets_)
+            {
+                for (auto const& tile_obj : tiles)
                 {
-                    for (auto const& lang : baton_data_->languages)
+                    if (!vtile::within_target(*tile_obj, target.z, target.x, target.y))
                     {
-                        language_key_precedence.push_back(baton_data_->language_property + "_" + lang);
-                        language_key_precedence.push_back(baton_data_->hidden_prefix + baton_data_->language_property + "_" + lang);
+                        SetError(invalid_request_message(*tile_obj, target));
+                        return;
                     }
-                    language_key_precedence.push_back(baton_data_->language_property);
                 }
+            }
 
-                if (baton_data_->worldviews.size() == 1 && baton_data_->worldviews[0] == "ALL")
-                {
-                    is_localized_tile_with_all_worldviews = true;
-                }
+            if (stats_)
+            {
+                stats_->bytes_in = source_bytes(tiles);
             }
-            else
+            std::vector<source_buffer> buffer_cache;
+            std::vector<vtzero::data_view> tile_views;
+            decompress_sources(tiles, threads, buffer_cache, tile_views, stats_.get());
+
+            // every target gets the same layers, in composite order
+            std::vector<vtzero::tile_builder> builders(targets_.size());
+            std::vector<batch_layer> layers;
+            for_each_output_layer(tiles, tile_views, [&](vtzero::layer const& layer, std::size_t i) {
+                layers.emplace_back(layer, i, tiles[i]->z);
+                layers.back().stats = add_layer_stats(stats_.get(), layer);
+                layers.back().cancel = cancel;
+            });
+
+            // With the layer cache enabled, layers are only added to the
+            // targets once all of them are overzoomed, in the order above.
+            bool const use_layer_cache = vtile::layer_cache().enabled();
+            std::vector<std::string> source_keys(tiles.size());
+
+            // `layers` does not change size from here on, so the targets can
+            // safely refer to their layer
+            for (auto& l : layers)
             {
-                keep_all_non_hidden_worldviews = true; // reassign to the same value as default for clarity
-                incompatible_worldview_key = baton_data_->hidden_prefix + baton_data_->worldview_property;
-                compatible_worldview_key = baton_data_->worldview_property;
-
-                class_key_precedence.push_back(baton_data_->class_property);
-
-                keep_all_non_hidden_languages = true; // reassign to the same value as default for clarity
-                language_key_precedence.push_back(baton_data_->language_property);
+                std::uint32_t const extent = l.layer.extent();
+                if (use_layer_cache)
+                {
+                    std::string& source_key = source_keys[l.source];
+                    if (source_key.empty())
+                    {
+                        auto const& tile_obj = *tiles[l.source];
+                        source_key = vtile::tile_cache_key(tile_obj.id, tile_obj.data.data(), tile_obj.data.size());
+                    }
+                    std::string const name(l.layer.name());
+                    l.cached.resize(targets_.size());
+                    for (std::size_t t = 0; t < targets_.size(); ++t)
+                    {
+                        auto const& target = targets_[t];
+                        if (target.z == l.source_z)
+                        {
+                            continue;
+                        }
+                        std::string key = vtile::layer_cache_key(source_key, l.source_z, name, target.z, target.x, target.y, buffer_size);
+                        l.cached[t] = vtile::layer_cache().get(key);
+                        if (l.cached[t])
+                        {
+                            count_cached_layer(*l.cached[t], l.stats);
+                        }
+                        else
+                        {
+                            l.misses.emplace_back(t, std::move(key));
+                        }
+                    }
+                    l.miss_tiles.resize(l.misses.size());
+                }
+                std::size_t m = 0; // next miss
+                for (std::size_t t = 0; t < targets_.size(); ++t)
+                {
+                    auto const& target = targets_[t];
+                    std::uint32_t const zoom_factor = 1U << (target.z - l.source_z);
+                    if (zoom_factor == 1)
+                    {
+                        if (!use_layer_cache)
+                        {
+                            builders[t].add_existing_layer(l.layer);
+                        }
+                        if (l.stats != nullptr)
+                        {
+                            l.stats->features_out += l.stats->features_in;
+                            l.stats->vertices_out += l.stats->vertices_in;
+                        }
+                        continue;
+                    }
+                    if (l.stats != nullptr)
+                    {
+                        l.stats->overzoomed = true;
+                    }
+                    vtzero::tile_builder* tile = &builders[t];
+                    if (use_layer_cache)
+                    {
+                        if (m == l.misses.size() || l.misses[m].first != t)
+                        {
+                            continue; // cache hit
+                        }
+                        tile = &l.miss_tiles[m++];
+                    }
+                    std::uint32_t dx = 0;
+                    std::uint32_t dy = 0;
+                    std::tie(dx, dy) = vtile::displacement(l.source_z, extent, target.z, target.x, target.y);
+                    if (use_narrow_coordinates(extent, zoom_factor, buffer_size))
+                    {
+                        l.narrow_targets.push_back(std::make_unique<batch_layer_target<std::int32_t>>(*tile, l.layer, dx, dy, zoom_factor, buffer_size));
+                    }
+                    else
+                    {
+                        l.wide_targets.push_back(std::make_unique<batch_layer_target<std::int64_t>>(*tile, l.layer, dx, dy, zoom_factor, buffer_size));
+                    }
+                }
             }
 
-            vtzero::tile_builder tbuilder;
-            std::vector<char> buffer_cache;
-            vtzero::data_view tile_view{};
-            if (gzip::is_compressed(baton_data_->data.data(), baton_data_->data.size()))
+            // Each layer only writes to its own layer builders, so layers can
+            // be overzoomed concurrently.
+            vtile::thread_pool* const pool = vtile::worker_pool();
+            vtile::phase_time* const overzoom_time = vtile::phase(stats_.get(), &vtile::call_stats::overzoom);
+            auto const overzoom = [&](std::size_t i) {
+                vtile::phase_timer const timer{overzoom_time};
+                layers[i].overzoom();
+            };
+            vtile::parallel_for(layers.size(), threads, overzoom, pool);
+
+            if (use_layer_cache)
             {
-                gzip::Decompressor decompressor;
-                decompressor.decompress(buffer_cache, baton_data_->data.data(), baton_data_->data.size());
-                tile_view = protozero::data_view{buffer_cache.data(), buffer_cache.size()};
+                for (std::size_t t = 0; t < targets_.size(); ++t)
+                {
+                    for (auto const& l : layers)
+                    {
+                        if (l.cached[t])
+                        {
+                            add_layer_tile(builders[t], *l.cached[t], nullptr, nullptr);
+                        }
+                        else
+                        {
+                            builders[t].add_existing_layer(l.layer);
+                        }
+                    }
+                }
             }
-            else
+
+            output_buffers_.resize(targets_.size());
+            for (auto& output : output_buffers_)
             {
-                tile_view = baton_data_->data;
+                output = std::make_unique<std::string>();
             }
+            auto const serialize_target = [&](std::size_t t) {
+                serialize_tile(builders[t], baton_data_->compression, *output_buffers_[t], stats_.get());
+            };
+            vtile::parallel_for(targets_.size(), threads, serialize_target, pool);
+        }
+        catch (std::exception const& e)
+        {
+            SetError(e.what());
+        }
+    }
 
-            vtzero::vector_tile tile{tile_view};
-
-            while (auto layer = tile.next_layer())
+    std::vector<napi_value> GetResult(Napi::Env env) override
+    {
+        Napi::Array results = Napi::Array::New(env, output_buffers_.size());
+        for (std::size_t t = 0; t < output_buffers_.size(); ++t)
+        {
+            if (stats_)
             {
-                // TODO short circuit if hidden attributes not present? (call vtzero's add_existing_layer)
-                vtzero::layer_builder lbuilder{tbuilder, layer.name(), layer.version(), layer.extent()};
-                while (auto feature = layer.next_feature())
-                {
-                    // a flag to indicate whether This feature will be dropped; will set this flag
-                    // to true when we encounter a property that suggests this feature should be
-                    // discarded (for example, if the feature has an incompatible worldview key/value).
-                    bool skip_feature = false;
-
-                    // will be creating one clone of the feature for each worldview if worldview property exists
-                    bool has_worldview_key = false;
-                    std::vector<std::string> worldviews_to_create;
+                stats_->bytes_out += output_buffers_[t]->size();
+            }
+            Napi::Object result = Napi::Object::New(env);
+            result.Set("z", Napi::Number::New(env, targets_[t].z));
+            result.Set("x", Napi::Number::New(env, targets_[t].x));
+            result.Set("y", Napi::Number::New(env, targets_[t].y));
+            result.Set("buffer", external_buffer(env, std::move(output_buffers_[t])));
+            results.Set(static_cast<std::uint32_t>(t), result);
+        }
+        std::vector<napi_value> result{env.Null(), results};
+        add_stats_argument(env, stats_.get(), &allocations_, result);
+        return result;
+    }
 
-                    // will be searching for the class with lowest index in class_key_precedence
-                    auto class_key_idx = static_cast<std::uint32_t>(class_key_precedence.size());
-                    vtzero::property_value class_value;
+    std::unique_ptr<BatonType> baton_data_; // handed back to baton_pool() when done
+    std::vector<TargetTile> const targets_;
+    std::vector<std::unique_ptr<std::string>> output_buffers_{};
+    std::unique_ptr<vtile::call_stats> const stats_{baton_data_->stats ? std::make_unique<vtile::call_stats>() : nullptr};
+    vtile::allocation_counter allocations_{};
+};
 
-                    auto language_key_idx = static_cast<std::uint32_t>(language_key_precedence.size());
-                    vtzero::property_value language_value;
-                    vtzero::property_value original_language_value;
-                    bool omit_local_language = false;
+Napi::Value composite_batch(Napi::CallbackInfo const& info)
+{
+    // validate callback function
+    std::size_t length = info.Length();
+    if (length == 0)
+    {
+        Napi::Error::New(info.Env(), "last argument must be a callback function").ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+    Napi::Value callback_val = info[length - 1];
+    if (!callback_val.IsFunction())
+    {
+        Napi::Error::New(info.Env(), "last argument must be a callback function").ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
 
-                    // collect final properties
-                    std::vector<std::pair<std::string, vtzero::property_value>> final_properties;
+    Napi::Function callback = callback_val.As<Napi::Function>();
 
-                    // collect the languages
-                    std::unordered_map<std::string, vtzero::property_value> language_properties_to_be_added_to_final_properties;
+    std::unique_ptr<BatonType> baton_data = baton_pool<BatonType>().acquire();
+    std::string error = parse_tiles(info[0], *baton_data);
+    if (!error.empty())
+    {
+        return utils::CallbackError(error, info);
+    }
 
-                    while (auto property = feature.next_property())
-                    {
-                        // if true, we've already encounterd a property that indicates
-                        // we will be discard this feature, so we can fast forward this while loop and
-                        // don't need to comb through the rest of its properties.
-                        if (skip_feature)
-                        {
-                            continue;
-                        }
+    std::vector<TargetTile> targets;
+    error = parse_targets(info[1], targets);
+    if (!error.empty())
+    {
+        return utils::CallbackError(error, info);
+    }
 
-                        std::string property_key = property.key().to_string();
+    if (info.Length() > 3) // options
+    {
+        error = parse_composite_options(info[2], *baton_data);
+        if (!error.empty())
+        {
+            return utils::CallbackError(error, info);
+        }
+        if (baton_data->localize)
+        {
+            return utils::CallbackError("'localize' is not supported by compositeBatch", info);
+        }
+        if (baton_data->drop.max_bytes > 0)
+        {
+            return utils::CallbackError("'max_bytes' is not supported by compositeBatch", info);
+        }
+    }
+    std::size_t const memory = composite_batch_memory(*baton_data, targets);
+    auto* worker = new CompositeBatchWorker{std::move(baton_data), std::move(targets), callback};
+    worker->Queue(std::numeric_limits<std::size_t>::max(), memory);
+    return info.Env().Undefined();
+}
 
-                        if (
-                            (property_key == baton_data_->worldview_property) ||
-                            (property_key == baton_data_->hidden_prefix + baton_data_->worldview_property))
-                        {
-                            // skip feature only if the value of incompatible worldview key is not 'all'
-                            if (property_key == incompatible_worldview_key)
-                            {
-                                if (property.value().type() == vtzero::property_value_type::string_value)
-                                {
-                                    if (property.value().string_value() != "all")
-                                    {
-                                        skip_feature = true;
-                                    }
-                                    // else do nothing - keep this feature but don't need to preserve this property.
-                                }
-                                else
-                                {
-                                    skip_feature = true;
-                                }
-                            }
+struct LocalizeWorker : vtile::Worker
+{
+    using Base = vtile::Worker;
 
-                            // keep feature and retain its compatible worldview value
-                            else if (property_key == compatible_worldview_key)
-                            {
-                                has_worldview_key = true;
-
-                                if (property.value().type() == vtzero::property_value_type::string_value)
-                                {
-                                    std::string property_value = static_cast<std::string>(property.value().string_value());
-
-                                    // determine which worldviews to create a clone of the feature
-                                    if (keep_all_non_hidden_worldviews || is_localized_tile_with_all_worldviews)
-                                    {
-                                        worldviews_to_create = {property_value};
-                                    }
-                                    else
-                                    {
-                                        std::vector<std::string> available_worldviews = utils::split(property_value);
-                                        worldviews_to_create = worldviews_for_feature(available_worldviews, baton_data_->worldviews);
-                                        if (worldviews_to_create.empty())
-                                        {
-                                            skip_feature = true;
-                                        }
-                                    }
-                                }
-                                else
-                                {
-                                    skip_feature = true;
-                                }
-                            }
-                            else // safeguard – should never reach here
-                            {
-                                skip_feature = true;
-                            }
-                        }
+    LocalizeWorker(std::unique_ptr<LocalizeBatonType>&& baton_data, Napi::Function& cb)
+        : Base(cb, baton_data->lane),
+          baton_data_{std::move(baton_data)} {}
 
-                        else if (
-                            (property_key == baton_data_->class_property) ||
-                            (property_key == baton_data_->hidden_prefix + baton_data_->class_property))
-                        {
-                            // check if the property is of higher precedence that class key encountered so far
-                            std::uint32_t idx = static_cast<std::uint32_t>(std::distance(class_key_precedence.begin(), std::find(class_key_precedence.begin(), class_key_precedence.end(), property_key)));
-                            if (idx < class_key_idx)
-                            {
-                                class_key_idx = idx;
-                                class_value = property.value();
-                            }
-                            // wait till we are done looping through all properties before we add class value to final_properties
-                        }
+    LocalizeWorker(std::unique_ptr<LocalizeBatonType>&& baton_data, Napi::Env env)
+        : Base(env),
+          baton_data_{std::move(baton_data)} {}
 
-                        // property_key starts with "name"
-                        // or property_key starts with "_mbx_" + "name"
-                        else if (
-                            utils::startswith(property_key, baton_data_->language_property) ||
-                            utils::startswith(property_key, baton_data_->hidden_prefix + baton_data_->language_property))
-                        {
+    ~LocalizeWorker() override
+    {
+        release_baton(baton_data_);
+    }
 
-                            if (is_localized_tile_with_all_languages)
-                            {
-                                std::string cleaned_property_key = remove_hidden_prefix(property_key, baton_data_->hidden_prefix);
-
-                                if (property_key == baton_data_->language_property)
-                                {
-                                    // add local language name to final properties
-                                    final_properties.emplace_back(
-                                        cleaned_property_key,
-                                        property.value());
-                                    original_language_value = property.value();
-                                }
-                                else if (property_key != baton_data_->language_property + "_script")
-                                {
-                                    // add other languages (name_xx, except name_script) to a temporary hashmap
-                                    // later encounter of the same language in the loop overwrites the former
-                                    if (property.value().valid())
-                                    {
-                                        language_properties_to_be_added_to_final_properties[cleaned_property_key] = property.value();
-                                    }
-                                }
+    // the options of every output: one per variant of localizeBatch, or the
+    // single output of localize
+    std::vector<vtile::localize_options> variant_options() const
+    {
+        LocalizeSettings const& settings = baton_data_->settings;
+        std::vector<vtile::localize_options> result;
+        if (baton_data_->variants.empty())
+        {
+            result.push_back(settings.options());
+        }
+        for (auto const& variant : baton_data_->variants)
+        {
+            result.push_back(settings.options(variant.languages, variant.worldviews, variant.return_localized_tile));
+        }
+        return result;
+    }
 
-                                continue;
-                            }
+    void Execute() override
+    {
+        try
+        {
+            vtile::cancellation const* const cancel = baton_data_->cancel.if_active();
+            vtile::check(cancel);
+            std::vector<vtile::localize_options> const variants = variant_options();
+            std::size_t const num_variants = variants.size();
 
-                            // check if the property is of higher precedence that language key encountered so far
-                            std::uint32_t idx = static_cast<std::uint32_t>(
-                                std::distance(
-                                    language_key_precedence.begin(),
-                                    std::find(language_key_precedence.begin(), language_key_precedence.end(), property_key)));
-                            if (idx < language_key_idx)
-                            {
-                                language_key_idx = idx;
-                                language_value = property.value();
-                            }
+            vtile::call_stats* const stats = stats_.get();
+            if (stats != nullptr)
+            {
+                stats->bytes_in = baton_data_->data.size();
+            }
+            vtile::pooled_buffer buffer_cache = vtile::take_buffer();
+            vtzero::data_view tile_view{};
+            vtile::codec source_codec = vtile::detect_codec(baton_data_->data.data(), baton_data_->data.size());
+            if (source_codec != vtile::codec::none)
+            {
+                vtile::phase_timer const timer{vtile::phase(stats, &vtile::call_stats::decompress)};
+                if (!vtile::decompress(source_codec, baton_data_->data.data(), baton_data_->data.size(), *buffer_cache))
+                {
+                    source_codec = vtile::codec::none;
+                }
+            }
+            if (source_codec != vtile::codec::none)
+            {
+                tile_view = protozero::data_view{buffer_cache->data(), buffer_cache->size()};
+            }
+            else
+            {
+                tile_view = baton_data_->data;
+            }
 
-                            // preserve original language value, and wait till finish looping through all properties to assign a value
-                            if (property_key == baton_data_->language_property)
-                            {
-                                original_language_value = property.value();
-                            }
-                            else if (property_key == baton_data_->language_property + "_script")
-                            {
-                                // true if script is in the omitted list
-                                omit_local_language = std::any_of(
-                                    baton_data_->omit_scripts.begin(),
-                                    baton_data_->omit_scripts.end(),
-                                    [&](const std::string& script) {
-                                        return (script == property.value().string_value());
-                                    });
-
-                                if (keep_all_non_hidden_languages)
-                                {
-                                    final_properties.emplace_back(property_key, property.value());
-                                }
-                            }
-                            else
-                            {
-                                if (keep_all_non_hidden_languages)
-                                {
-                                    if (!utils::startswith(property_key, baton_data_->hidden_prefix))
-                                    {
-                                        final_properties.emplace_back(property_key, property.value());
-                                    }
-                                    // else – drop properties that start with a prefix
-                                }
-                                // else – wait till we are done looping through all properties to add {language} value to final_properties
-                            }
-                        }
+            vtzero::vector_tile tile{tile_view};
 
-                        // all other properties
-                        else if (!utils::startswith(property_key, baton_data_->hidden_prefix))
-                        {
-                            final_properties.emplace_back(property_key, property.value());
-                        }
+            vtile::phase_timer localize_timer{vtile::phase(stats, &vtile::call_stats::localize)};
+
+            // Classify the keys of all layers for every variant first: layers
+            // that only have keys kept as they are need no rewriting, and a
+            // variant without any other layer returns the tile as it is.
+            std::vector<vtzero::layer> layers;
+            std::vector<std::vector<std::vector<vtile::localize_key>>> layer_keys; // by layer, then variant
+            std::vector<bool> unchanged(num_variants, !tile_view.empty());
+            while (auto layer = tile.next_layer())
+            {
+                layer_keys.emplace_back();
+                for (std::size_t v = 0; v < num_variants; ++v)
+                {
+                    layer_keys.back().push_back(vtile::classify_keys(layer.key_table(), variants[v]));
+                    // empty layers are dropped from rewritten tiles
+                    unchanged[v] = unchanged[v] && !layer.empty() && vtile::keeps_all(layer_keys.back()[v]);
+                }
+                layers.push_back(layer);
+            }
 
-                        // else – drop property key that starts with {hidden_prefix}
+            std::vector<vtzero::tile_builder> builders(num_variants);
 
-                    } // end of properties loop
+            // the layer builders and localizers of the variants rewriting the
+            // current layer (localizers refer to the builders, so these
+            // vectors must not reallocate)
+            std::vector<vtzero::layer_builder> lbuilders;
+            std::vector<feature_localizer> localizers;
+            std::vector<vtile::layer_stats*> lstats;
+            lbuilders.reserve(num_variants);
+            localizers.reserve(num_variants);
+            std::vector<vtzero::index_value_pair> indexes; // reused across features
 
-                    // if skip feature, proceed to next feature
-                    if (skip_feature)
+            for (std::size_t i = 0; i < layers.size(); ++i)
+            {
+                vtile::check(cancel);
+                vtzero::layer& layer = layers[i];
+                if (layer.empty())
+                {
+                    continue;
+                }
+                localizers.clear();
+                lbuilders.clear();
+                lstats.clear();
+                for (std::size_t v = 0; v < num_variants; ++v)
+                {
+                    if (unchanged[v])
                     {
                         continue;
                     }
-
-                    // use the class value of highest precedence
-                    if (class_value.valid())
-                    {
-                        final_properties.emplace_back(baton_data_->class_property, class_value);
-                    }
-
-                    // use the language value of highest precedence
-                    if (language_value.valid())
+                    if (vtile::keeps_all(layer_keys[i][v]))
                     {
-                        // `local` language is "the original language in an acceptable script".
-                        if (omit_local_language)
-                        {
-                            // don't need to check if `local` is in the desired list of languages
-                            // because the script of the original language is not acceptable.
-                            final_properties.emplace_back(baton_data_->language_property, language_value);
-                        }
-                        else
-                        {
-                            // the original language is in an acceptable script;
-                            // next, check if `local` is in the list of desired languages
-                            // (by checking if `{language_property}_local` is in the language_key_precedence list)
-                            std::uint32_t local_language_key_idx = static_cast<std::uint32_t>(std::distance(language_key_precedence.begin(), std::find(language_key_precedence.begin(), language_key_precedence.end(), baton_data_->language_property + "_local")));
-                            if (local_language_key_idx < language_key_idx)
-                            {
-                                // note the `<`: this means if there exists a `{language_property}_local` or a `{language_prefix}{language_property}_local`
-                                // already exists in the input tile, the code does not enter this if block.
-                                // {language_property}_local` and `{language_prefix}{language_property}_local` take precedence over the local language.
-                                final_properties.emplace_back(baton_data_->language_property, original_language_value);
-                            }
-                            else
-                            {
-                                final_properties.emplace_back(baton_data_->language_property, language_value);
-                            }
-                        }
+                        builders[v].add_existing_layer(layer);
+                        copy_layer_stats(stats, layer);
+                        continue;
                     }
-
-                    if (baton_data_->return_localized_tile && original_language_value.valid())
+                    lbuilders.emplace_back(builders[v], layer.name(), layer.version(), layer.extent());
+                    localizers.emplace_back(layer, layer_keys[i][v], variants[v], lbuilders.back());
+                    lstats.push_back(add_layer_stats(stats, layer));
+                }
+                if (localizers.empty())
+                {
+                    continue;
+                }
+                // the properties of each feature are decoded once for all variants
+                while (auto feature = layer.next_feature())
+                {
+                    vtile::check(cancel);
+                    indexes.clear();
+                    while (auto const index = feature.next_property_indexes())
                     {
-                        final_properties.emplace_back(baton_data_->language_property + "_local", original_language_value);
+                        indexes.push_back(index);
                     }
-
-                    // Check the list of languages to be added
-                    // Only add the ones that are different from original local language to the final properties
-                    if (is_localized_tile_with_all_languages)
+                    for (std::size_t r = 0; r < localizers.size(); ++r)
                     {
-                        for (const auto& language_property : language_properties_to_be_added_to_final_properties)
+                        if (localizers[r].localize(indexes))
                         {
-                            std::string language_property_key = language_property.first;
-                            vtzero::property_value language_property_value = language_property.second;
-
-                            if (!original_language_value.valid() || language_property_value.string_value() != original_language_value.string_value())
+                            for (std::size_t copy = 0; copy < localizers[r].copies(); ++copy)
                             {
-                                final_properties.emplace_back(language_property_key, language_property_value);
+                                add_localized_feature(lbuilders[r], feature, localizers[r].properties(copy));
+                                count_output_feature(lstats[r], feature);
                             }
                         }
                     }
+                }
+            }
+            localize_timer.stop();
 
-                    // build new feature(s)
-                    if (has_worldview_key)
-                    {
-                        if (!worldviews_to_create.empty())
-                        { // safeguard – should always evalute to true
-                            // Take just the first worldview. TODO: support all worldviews.
-                            build_new_feature(feature, final_properties, baton_data_->worldview_property, worldviews_to_create[0], lbuilder);
-                        }
-                    }
-                    else
-                    {
-                        build_new_feature(feature, final_properties, "", "", lbuilder);
-                    }
-
-                } // end of features loop
-            }     // end of layers loop
-
-            std::string& tile_buffer = *output_buffer_;
-            if (baton_data_->compress)
+            output_buffers_.clear();
+            for (std::size_t v = 0; v < num_variants; ++v)
             {
-                std::string temp;
-                tbuilder.serialize(temp);
-
-                // If the serialized buffer is an empty string, do not
-                // gzip compress it. This will lead to a non-zero byte string
-                // which can be perceived as a valid vector tile.
-                //
-                // Instead do nothing and return an empty, non-gzip-compressed buffer.
-                // If the user wants to handle empty tiles separately from non-empty
-                // tiles, they must check "buffer.length > 0" in the resulting callback.
-                if (!temp.empty())
+                output_buffers_.push_back(std::make_unique<std::string>());
+                std::string& tile_buffer = *output_buffers_.back();
+                if (!unchanged[v])
                 {
-                    tile_buffer = gzip::compress(temp.data(), temp.size());
+                    serialize_tile(builders[v], baton_data_->compression, tile_buffer, stats);
+                    continue;
+                }
+                for (auto const& layer : layers)
+                {
+                    copy_layer_stats(stats, layer);
+                }
+                if (source_compression_matches(source_codec, baton_data_->data, tile_view.size(), baton_data_->compression))
+                {
+                    tile_buffer.assign(baton_data_->data.data(), baton_data_->data.size());
+                }
+                else
+                {
+                    output_tile(tile_view, baton_data_->compression, tile_buffer, stats);
                 }
-            }
-            else
-            {
-                tbuilder.serialize(tile_buffer);
             }
         }
-        // LCOV_EXCL_START
         catch (std::exception const& e)
         {
             SetError(e.what());
         }
-        // LCOV_EXCL_STOP
     }
     std::vector<napi_value> GetResult(Napi::Env env) override
     {
-        if (output_buffer_)
+        if (output_buffers_.empty())
         {
-            std::string& tile_buffer = *output_buffer_;
-            auto buffer = Napi::Buffer<char>::New(
-                env,
-                tile_buffer.empty() ? nullptr : &tile_buffer[0],
-                tile_buffer.size(),
-                [](Napi::Env env_, char* /*unused*/, std::string* str_ptr) {
-                    if (str_ptr != nullptr)
-                    {
-                        Napi::MemoryManagement::AdjustExternalMemory(env_, -static_cast<std::int64_t>(str_ptr->size()));
-                    }
-                    delete str_ptr;
-                },
-                output_buffer_.release());
-            Napi::MemoryManagement::AdjustExternalMemory(env, static_cast<std::int64_t>(tile_buffer.size()));
-            return {env.Null(), buffer};
+            return Base::GetResult(env); // returns an empty vector (default)
         }
-        return Base::GetResult(env); // returns an empty vector (default)
+        if (stats_)
+        {
+            for (auto const& buffer : output_buffers_)
+            {
+                stats_->bytes_out += buffer->size();
+            }
+        }
+        std::vector<napi_value> result{env.Null()};
+        if (baton_data_->variants.empty())
+        {
+            result.push_back(external_buffer(env, std::move(output_buffers_.front())));
+        }
+        else
+        {
+            Napi::Array results = Napi::Array::New(env, output_buffers_.size());
+            for (std::size_t v = 0; v < output_buffers_.size(); ++v)
+            {
+                results.Set(static_cast<std::uint32_t>(v), external_buffer(env, std::move(output_buffers_[v])));
+            }
+            result.push_back(results);
+        }
+        add_stats_argument(env, stats_.get(), nullptr, result);
+        return result;
     }
 
-    std::unique_ptr<LocalizeBatonType> const baton_data_;
-    std::unique_ptr<std::string> output_buffer_;
+    std::unique_ptr<LocalizeBatonType> baton_data_; // handed back to baton_pool() when done
+    std::vector<std::unique_ptr<std::string>> output_buffers_{}; // one per variant
+    std::unique_ptr<vtile::call_stats> const stats_{baton_data_->stats ? std::make_unique<vtile::call_stats>() : nullptr};
 };
 
+// Reads the `params` argument of localize into `baton`, a new or reset baton;
+// returns an error message, or an empty string
+std::string parse_localize_params(Napi::Object const& params, LocalizeBatonType& baton)
+{
+    Napi::Env env = params.Env();
+
+    // mandatory params
+    Napi::Buffer<char> buffer;
+
+    // optional params and their default values
+    LocalizeSettings settings;
+    vtile::compression_options compression{};
+
+    // params.buffer (required)
+    Napi::Value buffer_val;
+    if (!get_property(params, js_string(env, js_name::buffer), buffer_val))
+    {
+        return "params.buffer is required";
+    }
+    if (!buffer_val.IsObject() || buffer_val.IsNull() || buffer_val.IsUndefined())
+    {
+        return "params.buffer must be a Buffer";
+    }
+    Napi::Object buffer_obj = buffer_val.As<Napi::Object>();
+    if (!buffer_obj.IsBuffer())
+    {
+        return "params.buffer is not a true Buffer";
+    }
+    buffer = buffer_obj.As<Napi::Buffer<char>>();
+
+    std::string const settings_error = parse_localize_settings(params, "params", settings);
+    if (!settings_error.empty())
+    {
+        return settings_error;
+    }
+
+    // params.compress (optional)
+    if (params.Has(js_string(env, js_name::compress)))
+    {
+        Napi::Value comp_value = params.Get(js_string(env, js_name::compress));
+        if (!comp_value.IsBoolean())
+        {
+            return "params.compress must be a boolean";
+        }
+        if (comp_value.As<Napi::Boolean>().Value())
+        {
+            compression.codec = vtile::codec::gzip;
+        }
+    }
+
+    // params.compression (optional, takes precedence over params.compress)
+    if (params.Has(js_string(env, js_name::compression)))
+    {
+        vtile::compression_options options{};
+        std::string const error = parse_compression(params.Get(js_string(env, js_name::compression)), "params.compression", options);
+        if (!error.empty())
+        {
+            return error;
+        }
+        compression = options;
+    }
+
+    // params.priority (optional)
+    vtile::priority lane = vtile::priority::interactive;
+    if (params.Has(js_string(env, js_name::priority)))
+    {
+        if (!parse_priority(params.Get(js_string(env, js_name::priority)), lane))
+        {
+            return "params.priority must be 'interactive' or 'bulk'";
+        }
+    }
+
+    // params.stats (optional)
+    bool stats = false;
+    if (params.Has(js_string(env, js_name::stats)))
+    {
+        Napi::Value stats_val = params.Get(js_string(env, js_name::stats));
+        if (!stats_val.IsBoolean())
+        {
+            return "params.stats must be a boolean";
+        }
+        stats = stats_val.As<Napi::Boolean>().Value();
+    }
+
+    baton.data = vtzero::data_view{buffer.Data(), buffer.Length()};
+    baton.buffer_ref = Napi::Persistent(buffer);
+    baton.settings = std::move(settings);
+    baton.compression = compression;
+    baton.lane = lane;
+    baton.stats = stats;
+
+    // params.deadline_ms and params.signal (optional)
+    return parse_cancellation(params, "params.deadline_ms", "params.signal", baton.cancel, baton.abort_listener);
+}
+
 Napi::Value localize(Napi::CallbackInfo const& info)
 {
     std::size_t length = info.Length();
@@ -1089,23 +3147,6 @@ Napi::Value localize(Napi::CallbackInfo const& info)
     }
     Napi::Function callback = callback_val.As<Napi::Function>();
 
-    // mandatory params
-    Napi::Buffer<char> buffer;
-
-    // optional params and their default values
-    std::string hidden_prefix = "_mbx_";
-    std::vector<std::string> omit_scripts; // default is undefined
-    std::vector<std::string> languages;    // default is undefined
-    std::string language_property = "name";
-    std::vector<std::string> worldviews; // default is undefined
-    std::string worldview_property = "worldview";
-    std::string worldview_default = "US";
-    std::string class_property = "class";
-    bool compress = false;
-
-    // param that'll be deduced from other params
-    bool return_localized_tile = false; // true only if languages or worldviews exist
-
     // validate params object
     Napi::Value params_val = info[0];
     if (!params_val.IsObject())
@@ -1113,220 +3154,296 @@ Napi::Value localize(Napi::CallbackInfo const& info)
         Napi::Error::New(info.Env(), "first argument must be an object").ThrowAsJavaScriptException();
         return info.Env().Null();
     }
-    Napi::Object params = info[0].As<Napi::Object>();
+    std::unique_ptr<LocalizeBatonType> baton_data = baton_pool<LocalizeBatonType>().acquire();
+    std::string const error = parse_localize_params(params_val.As<Napi::Object>(), *baton_data);
+    if (!error.empty())
+    {
+        return utils::CallbackError(error, info);
+    }
 
-    // empty string to check against
-    Napi::String empty_string = Napi::String::New(info.Env(), "");
+    std::size_t const work = baton_data->data.size();
+    std::size_t const memory = localize_memory(*baton_data);
+    auto* worker = new LocalizeWorker{std::move(baton_data), callback};
+    worker->Queue(work, memory);
+    return info.Env().Undefined();
+}
 
-    // params.buffer (required)
-    if (!params.Has(Napi::String::New(info.Env(), "buffer")))
+Napi::Value localize_sync(Napi::CallbackInfo const& info)
+{
+    if (info.Length() != 1 || !info[0].IsObject())
     {
-        return utils::CallbackError("params.buffer is required", info);
+        Napi::Error::New(info.Env(), "first argument must be an object").ThrowAsJavaScriptException();
+        return info.Env().Null();
     }
-    Napi::Value buffer_val = params.Get(Napi::String::New(info.Env(), "buffer"));
-    if (!buffer_val.IsObject() || buffer_val.IsNull() || buffer_val.IsUndefined())
+    std::unique_ptr<LocalizeBatonType> baton_data = baton_pool<LocalizeBatonType>().acquire();
+    std::string const error = parse_localize_params(info[0].As<Napi::Object>(), *baton_data);
+    if (!error.empty())
     {
-        return utils::CallbackError("params.buffer must be a Buffer", info);
+        Napi::Error::New(info.Env(), error).ThrowAsJavaScriptException();
+        return info.Env().Null();
     }
-    Napi::Object buffer_obj = buffer_val.As<Napi::Object>();
-    if (!buffer_obj.IsBuffer())
+    std::size_t const memory = localize_memory(*baton_data);
+    LocalizeWorker worker{std::move(baton_data), info.Env()};
+    return worker.RunSync(memory);
+}
+
+// upper bound on the number of variants of a single localizeBatch call
+constexpr std::size_t MAX_LOCALIZE_VARIANTS = 256;
+
+// Reads the `variants` argument of localizeBatch: an array of {languages,
+// worldviews} objects, each read as params.languages and params.worldviews
+// of localize. Returns an error message, or an empty string.
+std::string parse_localize_variants(Napi::Value const& value, std::string const& worldview_default, std::vector<LocalizeVariant>& variants)
+{
+    if (!value.IsArray())
     {
-        return utils::CallbackError("params.buffer is not a true Buffer", info);
+        return "'variants' must be an array";
     }
-    buffer = buffer_obj.As<Napi::Buffer<char>>();
-
-    // params.hidden_prefix (optional)
-    if (params.Has(Napi::String::New(info.Env(), "hidden_prefix")))
+    Napi::Env env = value.Env();
+    Napi::Array array = value.As<Napi::Array>();
+    std::uint32_t const num_variants = array.Length();
+    if (num_variants == 0)
     {
-        Napi::Value hidden_prefix_val = params.Get(Napi::String::New(info.Env(), "hidden_prefix"));
-        if (!hidden_prefix_val.IsString() || hidden_prefix_val == empty_string)
-        {
-            return utils::CallbackError("params.hidden_prefix must be a non-empty string", info);
-        }
-        hidden_prefix = hidden_prefix_val.As<Napi::String>();
+        return "'variants' array must be of length greater than 0";
     }
-
-    // params.omit_scripts (optional)
-    if (params.Has(Napi::String::New(info.Env(), "omit_scripts")))
+    if (num_variants > MAX_LOCALIZE_VARIANTS)
     {
-        Napi::Value scripts_val = params.Get(Napi::String::New(info.Env(), "omit_scripts"));
-        if (scripts_val.IsArray())
+        return "'variants' must not contain more than " + std::to_string(MAX_LOCALIZE_VARIANTS) + " items";
+    }
+    variants.resize(num_variants);
+    for (std::uint32_t v = 0; v < num_variants; ++v)
+    {
+        Napi::Value item = array.Get(v);
+        if (!item.IsObject() || item.IsArray())
         {
-            Napi::Array scripts_array = scripts_val.As<Napi::Array>();
-            std::uint32_t num_scripts = scripts_array.Length();
-
-            omit_scripts.reserve(num_scripts);
-
-            for (std::uint32_t s = 0; s < num_scripts; ++s)
+            return "items in 'variants' array must be objects";
+        }
+        Napi::Object object = item.As<Napi::Object>();
+        std::string const name = "variants[" + std::to_string(v) + "]";
+        LocalizeVariant& variant = variants[v];
+        if (object.Has(js_string(env, js_name::language)))
+        {
+            return name + ".language is an invalid param... do you mean " + name + ".languages?";
+        }
+        if (object.Has(js_string(env, js_name::languages)))
+        {
+            std::string const error = parse_string_array(object, js_name::languages, name + ".languages", variant.languages);
+            if (!error.empty())
             {
-                Napi::Value script_item_val = scripts_array.Get(s);
-                if (!script_item_val.IsString() || script_item_val == empty_string)
-                {
-                    return utils::CallbackError("params.omit_scripts must be an array of non-empty strings", info);
-                }
-                std::string script_item = script_item_val.As<Napi::String>();
-                omit_scripts.push_back(script_item);
+                return error;
             }
+            variant.return_localized_tile = true;
         }
-        else
+        if (object.Has(js_string(env, js_name::worldview)))
         {
-            return utils::CallbackError("params.omit_scripts must be an array", info);
+            return name + ".worldview is an invalid param... do you mean " + name + ".worldviews?";
         }
-    }
-
-    // params.language is an invalid param
-    if (params.Has(Napi::String::New(info.Env(), "language")))
-    {
-        return utils::CallbackError("params.language is an invalid param... do you mean params.languages?", info);
-    }
-    // params.languages (optional)
-    if (params.Has(Napi::String::New(info.Env(), "languages")))
-    {
-        Napi::Value language_val = params.Get(Napi::String::New(info.Env(), "languages"));
-        if (language_val.IsArray())
+        if (object.Has(js_string(env, js_name::worldviews)))
         {
-            return_localized_tile = true;
-
-            Napi::Array language_array = language_val.As<Napi::Array>();
-            std::uint32_t num_languages = language_array.Length();
-
-            languages.reserve(num_languages);
-
-            for (std::uint32_t lg = 0; lg < num_languages; ++lg)
+            std::string const error = parse_string_array(object, js_name::worldviews, name + ".worldviews", variant.worldviews);
+            if (!error.empty())
             {
-                Napi::Value language_item_val = language_array.Get(lg);
-                if (!language_item_val.IsString() || language_item_val == empty_string)
-                {
-                    return utils::CallbackError("params.languages must be an array of non-empty strings", info);
-                }
-                std::string language_item = language_item_val.As<Napi::String>();
-                languages.push_back(language_item);
+                return error;
             }
+            variant.return_localized_tile = true;
         }
-        else
+        if (variant.return_localized_tile && variant.worldviews.empty())
         {
-            return utils::CallbackError("params.languages must be an array", info);
+            variant.worldviews.push_back(worldview_default);
         }
     }
+    return {};
+}
 
-    // params.language_property (optional)
-    if (params.Has(Napi::String::New(info.Env(), "language_property")))
+Napi::Value localize_batch(Napi::CallbackInfo const& info)
+{
+    if (info.Length() != LOCALIZE_FUNCTION_ARGS + 1)
     {
-        Napi::Value language_property_val = params.Get(Napi::String::New(info.Env(), "language_property"));
-        if (!language_property_val.IsString() || language_property_val == empty_string)
-        {
-            return utils::CallbackError("params.language_property must be a non-empty string", info);
-        }
-        language_property = language_property_val.As<Napi::String>();
+        Napi::Error::New(info.Env(), "expected params, variants and callback arguments").ThrowAsJavaScriptException();
+        return info.Env().Null();
     }
 
-    // params.worldview is an invalid param
-    if (params.Has(Napi::String::New(info.Env(), "worldview")))
+    // validate callback function
+    Napi::Value callback_val = info[2];
+    if (!callback_val.IsFunction())
+    {
+        Napi::Error::New(info.Env(), "third argument must be a callback function").ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+    Napi::Function callback = callback_val.As<Napi::Function>();
+
+    // validate params object
+    Napi::Value params_val = info[0];
+    if (!params_val.IsObject())
+    {
+        Napi::Error::New(info.Env(), "first argument must be an object").ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+    Napi::Env env = info.Env();
+    Napi::Object params = params_val.As<Napi::Object>();
+    if (params.Has(js_string(env, js_name::languages)) || params.Has(js_string(env, js_name::worldviews)))
     {
-        return utils::CallbackError("params.worldview is an invalid param... do you mean params.worldviews?", info);
+        return utils::CallbackError("params.languages and params.worldviews are given by 'variants'", info);
     }
-    // params.worldviews (optional)
-    if (params.Has(Napi::String::New(info.Env(), "worldviews")))
+    std::unique_ptr<LocalizeBatonType> baton_data = baton_pool<LocalizeBatonType>().acquire();
+    std::string error = parse_localize_params(params, *baton_data);
+    if (!error.empty())
     {
-        Napi::Value worldview_val = params.Get(Napi::String::New(info.Env(), "worldviews"));
-        if (worldview_val.IsArray())
-        {
-            return_localized_tile = true;
+        return utils::CallbackError(error, info);
+    }
+    error = parse_localize_variants(info[1], baton_data->settings.worldview_default, baton_data->variants);
+    if (!error.empty())
+    {
+        return utils::CallbackError(error, info);
+    }
 
-            Napi::Array worldview_array = worldview_val.As<Napi::Array>();
-            std::uint32_t num_worldviews = worldview_array.Length();
+    std::size_t const work = baton_data->data.size() * baton_data->variants.size();
+    std::size_t const memory = localize_memory(*baton_data);
+    auto* worker = new LocalizeWorker{std::move(baton_data), callback};
+    worker->Queue(work, memory);
+    return info.Env().Undefined();
+}
 
-            // will put params.worldview_default into worldviews if params.worldviews is empty
-            // hence reserving minimum 1 slot
-            worldviews.reserve(num_worldviews > 0 ? num_worldviews : 1);
+Napi::Value configure(Napi::CallbackInfo const& info)
+{
+    if (info.Length() != 1 || !info[0].IsObject())
+    {
+        Napi::TypeError::New(info.Env(), "first argument must be an object").ThrowAsJavaScriptException();
+        return info.Env().Null();
+    }
+    Napi::Object options = info[0].As<Napi::Object>();
 
-            for (std::uint32_t wv = 0; wv < num_worldviews; ++wv)
-            {
-                Napi::Value worldview_item_val = worldview_array.Get(wv);
-                if (!worldview_item_val.IsString() || worldview_item_val == empty_string)
-                {
-                    return utils::CallbackError("params.worldviews must be an array of non-empty strings", info);
-                }
-                std::string worldview_item = worldview_item_val.As<Napi::String>();
-                worldviews.push_back(worldview_item);
-            }
+    // options.threadpool_size (optional)
+    if (options.Has(js_string(info.Env(), js_name::threadpool_size)))
+    {
+        Napi::Value size_value = options.Get(js_string(info.Env(), js_name::threadpool_size));
+        if (!size_value.IsNumber())
+        {
+            Napi::TypeError::New(info.Env(), "'threadpool_size' must be an int32").ThrowAsJavaScriptException();
+            return info.Env().Null();
         }
-        else
+        int threadpool_size = size_value.As<Napi::Number>().Int32Value();
+        if (threadpool_size < 1)
         {
-            return utils::CallbackError("params.worldviews must be an array", info);
+            Napi::TypeError::New(info.Env(), "'threadpool_size' must be a positive int32").ThrowAsJavaScriptException();
+            return info.Env().Null();
         }
-    }
-
-    // params.worldview_property (optional)
-    if (params.Has(Napi::String::New(info.Env(), "worldview_property")))
-    {
-        Napi::Value worldview_property_val = params.Get(Napi::String::New(info.Env(), "worldview_property"));
-        if (!worldview_property_val.IsString() || worldview_property_val == empty_string)
+        if (!vtile::start_worker_pool(static_cast<std::size_t>(threadpool_size)))
         {
-            return utils::CallbackError("params.worldview_property must be a non-empty string", info);
+            Napi::Error::New(info.Env(), "the vtcomposite threadpool is already running with a different size").ThrowAsJavaScriptException();
+            return info.Env().Null();
         }
-        worldview_property = worldview_property_val.As<Napi::String>();
     }
 
-    // params.worldview_default (optional)
-    if (params.Has(Napi::String::New(info.Env(), "worldview_default")))
+    // options.tile_cache_size (optional)
+    if (options.Has(js_string(info.Env(), js_name::tile_cache_size)))
     {
-        Napi::Value worldview_default_val = params.Get(Napi::String::New(info.Env(), "worldview_default"));
-        if (!worldview_default_val.IsString() || worldview_default_val == empty_string)
+        Napi::Value size_value = options.Get(js_string(info.Env(), js_name::tile_cache_size));
+        if (!size_value.IsNumber())
+        {
+            Napi::TypeError::New(info.Env(), "'tile_cache_size' must be a number").ThrowAsJavaScriptException();
+            return info.Env().Null();
+        }
+        std::int64_t const tile_cache_size = size_value.As<Napi::Number>().Int64Value();
+        if (tile_cache_size < 0)
         {
-            return utils::CallbackError("params.worldview_default must be a non-empty string", info);
+            Napi::TypeError::New(info.Env(), "'tile_cache_size' must not be negative").ThrowAsJavaScriptException();
+            return info.Env().Null();
         }
-        worldview_default = worldview_default_val.As<Napi::String>();
+        vtile::tile_cache().set_max_bytes(static_cast<std::size_t>(tile_cache_size));
     }
 
-    // params.class_property (optional)
-    if (params.Has(Napi::String::New(info.Env(), "class_property")))
+    // options.layer_cache_size (optional)
+    if (options.Has(js_string(info.Env(), js_name::layer_cache_size)))
     {
-        Napi::Value class_property_val = params.Get(Napi::String::New(info.Env(), "class_property"));
-        if (!class_property_val.IsString() || class_property_val == empty_string)
+        Napi::Value size_value = options.Get(js_string(info.Env(), js_name::layer_cache_size));
+        if (!size_value.IsNumber())
         {
-            return utils::CallbackError("params.class_property must be a non-empty string", info);
+            Napi::TypeError::New(info.Env(), "'layer_cache_size' must be a number").ThrowAsJavaScriptException();
+            return info.Env().Null();
         }
-        class_property = class_property_val.As<Napi::String>();
+        std::int64_t const layer_cache_size = size_value.As<Napi::Number>().Int64Value();
+        if (layer_cache_size < 0)
+        {
+            Napi::TypeError::New(info.Env(), "'layer_cache_size' must not be negative").ThrowAsJavaScriptException();
+            return info.Env().Null();
+        }
+        vtile::layer_cache().set_max_bytes(static_cast<std::size_t>(layer_cache_size));
     }
 
-    // params.compress (optional)
-    if (params.Has(Napi::String::New(info.Env(), "compress")))
+    // options.inline_threshold (optional)
+    if (options.Has(js_string(info.Env(), js_name::inline_threshold)))
     {
-        Napi::Value comp_value = params.Get(Napi::String::New(info.Env(), "compress"));
-        if (!comp_value.IsBoolean())
+        Napi::Value threshold_value = options.Get(js_string(info.Env(), js_name::inline_threshold));
+        if (!threshold_value.IsNumber())
         {
-            return utils::CallbackError("params.compress must be a boolean", info);
+            Napi::TypeError::New(info.Env(), "'inline_threshold' must be a number").ThrowAsJavaScriptException();
+            return info.Env().Null();
         }
-        compress = comp_value.As<Napi::Boolean>().Value();
+        std::int64_t const inline_threshold = threshold_value.As<Napi::Number>().Int64Value();
+        if (inline_threshold < 0)
+        {
+            Napi::TypeError::New(info.Env(), "'inline_threshold' must not be negative").ThrowAsJavaScriptException();
+            return info.Env().Null();
+        }
+        vtile::set_inline_threshold(static_cast<std::size_t>(inline_threshold));
     }
 
-    // This if block must be validated *after* params.languages and params.worldviews
-    // because it checks return_localized_tile which is dictated by the
-    // value of both params.languages and params.worldviews.
-    if (return_localized_tile)
+    // options.memory_budget (optional)
+    if (options.Has(js_string(info.Env(), js_name::memory_budget)))
     {
-        if (worldviews.empty())
+        Napi::Value budget_value = options.Get(js_string(info.Env(), js_name::memory_budget));
+        if (!budget_value.IsNumber())
         {
-            worldviews.push_back(worldview_default);
+            Napi::TypeError::New(info.Env(), "'memory_budget' must be a number").ThrowAsJavaScriptException();
+            return info.Env().Null();
         }
-        // else do nothing – already knows which worldview to return
+        std::int64_t const memory_budget = budget_value.As<Napi::Number>().Int64Value();
+        if (memory_budget < 0)
+        {
+            Napi::TypeError::New(info.Env(), "'memory_budget' must not be negative").ThrowAsJavaScriptException();
+            return info.Env().Null();
+        }
+        vtile::native_memory().set_max_bytes(static_cast<std::size_t>(memory_budget));
     }
+    return info.Env().Undefined();
+}
 
-    std::unique_ptr<LocalizeBatonType> baton_data = std::make_unique<LocalizeBatonType>(
-        buffer,
-        hidden_prefix,
-        omit_scripts,
-        languages,
-        language_property,
-        worldviews,
-        worldview_property,
-        class_property,
-        return_localized_tile,
-        compress);
+namespace {
 
-    auto* worker = new LocalizeWorker{std::move(baton_data), callback};
-    worker->Queue();
-    return info.Env().Undefined();
+Napi::Object cache_stats_object(Napi::Env env, vtile::cache_stats const& stats)
+{
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("hits", Napi::Number::New(env, static_cast<double>(stats.hits)));
+    result.Set("misses", Napi::Number::New(env, static_cast<double>(stats.misses)));
+    result.Set("evictions", Napi::Number::New(env, static_cast<double>(stats.evictions)));
+    result.Set("entries", Napi::Number::New(env, static_cast<double>(stats.entries)));
+    result.Set("bytes", Napi::Number::New(env, static_cast<double>(stats.bytes)));
+    result.Set("max_bytes", Napi::Number::New(env, static_cast<double>(stats.max_bytes)));
+    return result;
+}
+
+} // namespace
+
+Napi::Value get_cache_stats(Napi::CallbackInfo const& info)
+{
+    Napi::Object result = Napi::Object::New(info.Env());
+    result.Set("tiles", cache_stats_object(info.Env(), vtile::tile_cache().stats()));
+    result.Set("layers", cache_stats_object(info.Env(), vtile::layer_cache().stats()));
+    return result;
+}
+
+Napi::Value get_memory_stats(Napi::CallbackInfo const& info)
+{
+    Napi::Env env = info.Env();
+    vtile::memory_stats const stats = vtile::native_memory().stats();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("in_flight", Napi::Number::New(env, static_cast<double>(stats.in_flight)));
+    result.Set("peak", Napi::Number::New(env, static_cast<double>(stats.peak)));
+    result.Set("max_bytes", Napi::Number::New(env, static_cast<double>(stats.max_bytes)));
+    result.Set("waiting", Napi::Number::New(env, static_cast<double>(stats.waiting)));
+    result.Set("queued", Napi::Number::New(env, static_cast<double>(stats.queued)));
+    result.Set("rejected", Napi::Number::New(env, static_cast<double>(stats.rejected)));
+    return result;
 }
 } // namespace vtile
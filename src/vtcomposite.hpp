@@ -4,6 +4,14 @@
 namespace vtile {
 
 Napi::Value composite(const Napi::CallbackInfo& info);
+Napi::Value composite_sync(const Napi::CallbackInfo& info);
+Napi::Value composite_packed(const Napi::CallbackInfo& info);
+Napi::Value composite_batch(const Napi::CallbackInfo& info);
 Napi::Value localize(const Napi::CallbackInfo& info);
+Napi::Value localize_sync(const Napi::CallbackInfo& info);
+Napi::Value localize_batch(const Napi::CallbackInfo& info);
+Napi::Value configure(const Napi::CallbackInfo& info);
+Napi::Value get_cache_stats(const Napi::CallbackInfo& info);
+Napi::Value get_memory_stats(const Napi::CallbackInfo& info);
 
 } // namespace vtile
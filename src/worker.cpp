@@ -0,0 +1,296 @@
+#include "worker.hpp"
+#include "memory_budget.hpp"
+// stl
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace vtile {
+
+namespace {
+
+std::mutex pool_mutex;
+// Never destroyed: tasks may still be running while the process exits.
+thread_pool* pool = nullptr;
+
+std::atomic<std::size_t> max_inline_work{0};
+
+// Hands the workers finished on the pool back to the JS thread of their
+// environment. The thread-safe function is only ref'ed while work is in flight
+// so an idle pool does not keep the event loop alive.
+struct completion_queue
+{
+    Napi::ThreadSafeFunction tsfn{};
+    std::size_t in_flight = 0; // only touched on the JS thread
+};
+
+std::mutex queues_mutex;
+std::unordered_map<napi_env, std::unique_ptr<completion_queue>> queues;
+
+completion_queue& completion_queue_for(Napi::Env env)
+{
+    std::lock_guard<std::mutex> lock{queues_mutex};
+    auto& queue = queues[env];
+    if (!queue)
+    {
+        queue = std::make_unique<completion_queue>();
+        queue->tsfn = Napi::ThreadSafeFunction::New(
+            env,
+            Napi::Function::New(env, [](Napi::CallbackInfo const& /*unused*/) {}),
+            "vtcomposite",
+            0, // unlimited queue
+            1);
+        queue->tsfn.Unref(env);
+        napi_add_env_cleanup_hook(
+            env,
+            [](void* arg) {
+                std::lock_guard<std::mutex> cleanup_lock{queues_mutex};
+                queues.erase(static_cast<napi_env>(arg));
+            },
+            static_cast<napi_env>(env));
+    }
+    return *queue;
+}
+
+} // namespace
+
+thread_pool* worker_pool()
+{
+    std::lock_guard<std::mutex> lock{pool_mutex};
+    return pool;
+}
+
+bool start_worker_pool(std::size_t num_threads)
+{
+    std::lock_guard<std::mutex> lock{pool_mutex};
+    if (pool != nullptr)
+    {
+        return pool->size() == num_threads;
+    }
+    pool = new thread_pool{num_threads}; // NOLINT
+    return true;
+}
+
+std::size_t inline_threshold()
+{
+    return max_inline_work.load(std::memory_order_relaxed);
+}
+
+void set_inline_threshold(std::size_t threshold)
+{
+    max_inline_work.store(threshold, std::memory_order_relaxed);
+}
+
+Worker::Worker(Napi::Function const& callback, priority lane)
+    : env_{callback.Env()},
+      callback_{Napi::Persistent(callback)},
+      context_{callback.Env(), "vtcomposite"},
+      lane_{lane}
+{
+}
+
+Worker::Worker(Napi::Env env)
+    : env_{env},
+      callback_{},
+      context_{env, "vtcomposite"},
+      lane_{priority::interactive}
+{
+}
+
+Worker::~Worker()
+{
+    if (reserved_ > 0)
+    {
+        native_memory().release(reserved_);
+    }
+    if (external_)
+    {
+        // the C API, as Napi::MemoryManagement throws on failure
+        std::int64_t adjusted = 0;
+        napi_adjust_external_memory(env_, -static_cast<std::int64_t>(memory_), &adjusted);
+    }
+}
+
+void Worker::Queue(std::size_t work, std::size_t memory)
+{
+    memory_ = memory;
+    if (!native_memory().admit(memory_))
+    {
+        std::unique_ptr<Worker> self{this};
+        SetError(memory_budget_error(memory_));
+        OnComplete(env_);
+        return;
+    }
+
+    std::size_t const threshold = inline_threshold();
+    if (threshold > 0 && work <= threshold && native_memory().try_reserve(memory_))
+    {
+        std::unique_ptr<Worker> self{this};
+        reserved_ = memory_;
+        Execute();
+        OnComplete(env_);
+        return;
+    }
+
+    if (memory_ > 0)
+    {
+        std::int64_t adjusted = 0;
+        // undone by the destructor if it succeeded
+        external_ = napi_adjust_external_memory(env_, static_cast<std::int64_t>(memory_), &adjusted) == napi_ok;
+    }
+
+    // Calls that do not fit in the budget yet wait in its queue, holding no
+    // thread, until the release that makes room for them: that may happen on
+    // any thread, so the call is handed back to the JS thread to be dispatched.
+    completion_queue& queue = completion_queue_for(env_);
+    Napi::ThreadSafeFunction tsfn = queue.tsfn;
+    bool const reserved = native_memory().reserve_or_defer(memory_, [this, tsfn]() {
+        tsfn.NonBlockingCall(this, [](Napi::Env env, Napi::Function /*unused*/, Worker* worker) {
+            completion_queue& deferred = completion_queue_for(env);
+            if (--deferred.in_flight == 0)
+            {
+                deferred.tsfn.Unref(env);
+            }
+            worker->reserved_ = worker->memory_;
+            worker->Dispatch();
+        });
+    });
+    if (!reserved)
+    {
+        if (queue.in_flight++ == 0)
+        {
+            queue.tsfn.Ref(env_);
+        }
+        return;
+    }
+    reserved_ = memory_;
+    Dispatch();
+}
+
+void Worker::Dispatch()
+{
+    thread_pool* const pool_ptr = worker_pool();
+    if (pool_ptr != nullptr)
+    {
+        completion_queue& queue = completion_queue_for(env_);
+        if (queue.in_flight++ == 0)
+        {
+            queue.tsfn.Ref(env_);
+        }
+        Napi::ThreadSafeFunction tsfn = queue.tsfn;
+        auto task = [this, tsfn]() {
+            Execute();
+            tsfn.NonBlockingCall(this, [](Napi::Env env, Napi::Function /*unused*/, Worker* worker) {
+                std::unique_ptr<Worker> self{worker};
+                completion_queue& completed = completion_queue_for(env);
+                if (--completed.in_flight == 0)
+                {
+                    completed.tsfn.Unref(env);
+                }
+                self->OnComplete(env);
+            });
+        };
+        pool_ptr->submit(std::move(task), lane_);
+        return;
+    }
+
+    napi_value resource_name = Napi::String::New(env_, "vtcomposite");
+    napi_status status = napi_create_async_work(env_, nullptr, resource_name, ExecuteWork, CompleteWork, this, &work_);
+    if (status == napi_ok)
+    {
+        status = napi_queue_async_work(env_, work_);
+    }
+    // LCOV_EXCL_START
+    if (status != napi_ok)
+    {
+        Napi::Error error = Napi::Error::New(env_);
+        if (work_ != nullptr)
+        {
+            napi_delete_async_work(env_, work_);
+        }
+        delete this;
+        error.ThrowAsJavaScriptException();
+    }
+    // LCOV_EXCL_STOP
+}
+
+Napi::Value Worker::RunSync(std::size_t memory)
+{
+    if (!native_memory().admit(memory))
+    {
+        Napi::Error::New(env_, memory_budget_error(memory)).ThrowAsJavaScriptException();
+        return env_.Null();
+    }
+    if (!native_memory().try_reserve(memory))
+    {
+        native_memory().reject();
+        Napi::Error::New(env_, memory_budget_error(memory)).ThrowAsJavaScriptException();
+        return env_.Null();
+    }
+    memory_ = memory;
+    reserved_ = memory;
+    Execute();
+    if (has_error_)
+    {
+        Napi::Error::New(env_, error_).ThrowAsJavaScriptException();
+        return env_.Null();
+    }
+    std::vector<napi_value> const result = GetResult(env_);
+    if (result.size() < 2)
+    {
+        return env_.Undefined(); // LCOV_EXCL_LINE
+    }
+    return Napi::Value{env_, result[1]};
+}
+
+std::vector<napi_value> Worker::GetResult(Napi::Env /*unused*/)
+{
+    return {};
+}
+
+void Worker::SetError(std::string const& error)
+{
+    has_error_ = true;
+    error_ = error;
+}
+
+void Worker::ExecuteWork(napi_env /*unused*/, void* data)
+{
+    static_cast<Worker*>(data)->Execute();
+}
+
+void Worker::CompleteWork(napi_env env, napi_status status, void* data)
+{
+    std::unique_ptr<Worker> self{static_cast<Worker*>(data)};
+    napi_delete_async_work(env, self->work_);
+    if (status != napi_cancelled)
+    {
+        self->OnComplete(Napi::Env{env});
+    }
+}
+
+void Worker::OnComplete(Napi::Env env)
+{
+    Napi::HandleScope scope{env};
+    try
+    {
+        if (has_error_)
+        {
+            callback_.MakeCallback(Napi::Object::New(env), std::initializer_list<napi_value>{Napi::Error::New(env, error_).Value()}, context_);
+        }
+        else
+        {
+            callback_.MakeCallback(Napi::Object::New(env), GetResult(env), context_);
+        }
+    }
+    catch (Napi::Error const& e)
+    {
+        e.ThrowAsJavaScriptException();
+    }
+}
+
+} // namespace vtile
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "thread_pool.hpp"
+#include <napi.h>
+// stl
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace vtile {
+
+// The process-wide pool set up by configure(), or nullptr while workers run on
+// the libuv threadpool (the default).
+thread_pool* worker_pool();
+
+// Starts the process-wide pool with `num_threads` threads. The pool can only be
+// started once; returns false if it is already running with a different size.
+bool start_worker_pool(std::size_t num_threads);
+
+// Work estimates up to this size (in bytes of input) run inline on the JS
+// thread instead of being queued; 0 (the default) never runs work inline.
+std::size_t inline_threshold();
+void set_inline_threshold(std::size_t threshold);
+
+// Base class of the async workers of this module.
+//
+// Offers the subset of Napi::AsyncWorker used by the workers (Execute,
+// SetError, GetResult), but Queue() runs Execute on worker_pool() in the
+// worker's priority lane when the pool is running, and on the libuv threadpool
+// otherwise. Either way the callback is called on the JS thread with
+// (err) or with the values returned by GetResult, and the worker deletes itself
+// afterwards.
+//
+// The `memory` estimate of a worker is reserved in native_memory() on the JS
+// thread before the worker is dispatched to a thread, and released when the
+// worker is deleted; workers that do not fit yet are deferred by the budget
+// and dispatched once memory is released. The estimate is also reported to V8
+// as external memory while the worker is deferred, queued or running.
+//
+// Workers constructed without a callback are run with RunSync() instead, on
+// the JS thread.
+//
+// Workers are allocated for each call rather than pooled: most of what they
+// hold is tied to their call (the reference to its callback, its async
+// context, the output buffer handed over to JS), and their batons are pooled
+// by the calls already.
+class Worker
+{
+  public:
+    Worker(Napi::Function const& callback, priority lane);
+    explicit Worker(Napi::Env env);
+    virtual ~Worker();
+
+    // non-copyable
+    Worker(Worker const&) = delete;
+    Worker& operator=(Worker const&) = delete;
+    // non-movable
+    Worker(Worker&&) = delete;
+    Worker& operator=(Worker&&) = delete;
+
+    // Queues the worker, or runs it inline and calls the callback before
+    // returning when `work` is at most inline_threshold() and `memory` fits in
+    // the budget right away. Calls the callback with an error before returning
+    // if `memory` exceeds the whole budget. Workers whose memory does not fit
+    // yet are queued once it does.
+    void Queue(std::size_t work = std::numeric_limits<std::size_t>::max(), std::size_t memory = 0);
+
+    // Runs Execute on the calling thread and returns the first value after the
+    // error in GetResult, or throws the error as a JS exception. Throws as well
+    // if `memory` does not fit in the budget right away, as the JS thread
+    // cannot wait for other calls to release memory.
+    Napi::Value RunSync(std::size_t memory = 0);
+
+  protected:
+    virtual void Execute() = 0;
+    virtual std::vector<napi_value> GetResult(Napi::Env env);
+    void SetError(std::string const& error);
+
+  private:
+    // queues the worker on worker_pool() or the libuv threadpool, with
+    // memory_ reserved
+    void Dispatch();
+    static void ExecuteWork(napi_env env, void* data);
+    static void CompleteWork(napi_env env, napi_status status, void* data);
+    void OnComplete(Napi::Env env);
+
+    Napi::Env env_;
+    Napi::FunctionReference callback_;
+    Napi::AsyncContext context_;
+    priority lane_;
+    napi_async_work work_ = nullptr;
+    std::string error_{};
+    bool has_error_ = false;
+    std::size_t memory_ = 0;
+    std::size_t reserved_ = 0;
+    bool external_ = false;
+};
+
+} // namespace vtile
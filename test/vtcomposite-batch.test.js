@@ -0,0 +1,112 @@
+'use strict';
+
+const test = require('tape');
+const { composite, compositeBatch } = require('../lib/index.js');
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+const mvtFixtures = require('@mapbox/mvt-fixtures');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+
+const requests = [
+  {
+    description: 'single gzipped tile and its descendants',
+    tiles: [{ buffer: zlib.gzipSync(bufferSF), z: 15, x: 5238, y: 12666 }],
+    targets: { z: 15, x: 5238, y: 12666, max_z: 17 },
+    options: { buffer_size: 128 }
+  },
+  {
+    description: 'several tiles, mixed zooms and layer filters, 2x2 block',
+    tiles: [
+      { buffer: fs.readFileSync('./test/fixtures/polygons-buildings-sf-15-5239-12666.mvt'), z: 15, x: 5239, y: 12666 },
+      { buffer: fs.readFileSync('./test/fixtures/points-poi-sf-15-5239-12666.mvt'), z: 15, x: 5239, y: 12666 },
+      { buffer: fs.readFileSync('./test/fixtures/linestrings-sf-15-5239-12666.mvt'), z: 15, x: 5239, y: 12666, layers: ['road'] }
+    ],
+    targets: [
+      { z: 17, x: 20956, y: 50664 },
+      { z: 17, x: 20957, y: 50664 },
+      { z: 17, x: 20956, y: 50665 },
+      { z: 17, x: 20957, y: 50665 }
+    ],
+    options: { buffer_size: 64 }
+  },
+  {
+    description: 'same layer name in two sources, first source wins',
+    tiles: [
+      { buffer: mvtFixtures.get('059').buffer, z: 14, x: 2619, y: 6333 },
+      { buffer: mvtFixtures.get('060').buffer, z: 15, x: 5238, y: 12666 }
+    ],
+    targets: [{ z: 15, x: 5238, y: 12666 }, { z: 16, x: 10477, y: 25333 }],
+    options: {}
+  },
+  {
+    description: 'compressed output with threads',
+    tiles: [{ buffer: fs.readFileSync('./test/fixtures/polygons-with-holes-4-13-6.mvt'), z: 4, x: 13, y: 6 }],
+    targets: { z: 6, x: 53, y: 24, max_z: 7 },
+    options: { buffer_size: 128, compress: true, threads: 4 }
+  }
+];
+
+requests.forEach((request) => {
+  test(`[compositeBatch] output is byte-identical to composite output - ${request.description}`, (assert) => {
+    compositeBatch(request.tiles, request.targets, request.options, (err, results) => {
+      assert.ifError(err);
+      if (Array.isArray(request.targets)) {
+        assert.deepEqual(results.map(({ z, x, y }) => ({ z, x, y })), request.targets, 'results in the order of targets');
+      }
+      let pending = results.length;
+      results.forEach((result) => {
+        composite(request.tiles, { z: result.z, x: result.x, y: result.y }, request.options, (err, expected) => {
+          assert.ifError(err);
+          assert.ok(expected.equals(result.buffer), `same bytes for ${result.z}/${result.x}/${result.y}`);
+          if (--pending === 0) assert.end();
+        });
+      });
+    });
+  });
+});
+
+test('[compositeBatch] descendants are returned by zoom, then row by row', (assert) => {
+  compositeBatch([{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }], { z: 15, x: 5238, y: 12666, max_z: 16 }, {}, (err, results) => {
+    assert.ifError(err);
+    assert.deepEqual(results.map(({ z, x, y }) => [z, x, y]), [
+      [15, 5238, 12666],
+      [16, 10476, 25332],
+      [16, 10477, 25332],
+      [16, 10476, 25333],
+      [16, 10477, 25333]
+    ]);
+    assert.end();
+  });
+});
+
+test('[compositeBatch] failure: source tile outside of a target', (assert) => {
+  const targets = [{ z: 16, x: 10476, y: 25332 }, { z: 16, x: 10478, y: 25332 }];
+  compositeBatch([{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }], targets, {}, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, 'Invalid tile composite request: SOURCE(15,5238,12666) TARGET(16,10478,25332)');
+    assert.end();
+  });
+});
+
+test('[compositeBatch] failure: invalid targets', (assert) => {
+  const tiles = [{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }];
+  const cases = [
+    [[], '\'targets\' array must be of length greater than 0'],
+    [[{ z: 1, x: 2, y: 0 }], 'items in \'targets\' array must be {z, x, y} objects of valid tiles'],
+    [[{ z: 15, x: 5238 }], 'items in \'targets\' array must be {z, x, y} objects of valid tiles'],
+    ['15/5238/12666', '\'targets\' must be an array of {z, x, y} objects or a {z, x, y, max_z} object'],
+    [{ z: 15, x: 5238, y: 12666 }, '\'targets.max_z\' must be an int32'],
+    [{ z: 15, x: 5238, y: 12666, max_z: 14 }, '\'targets.max_z\' must be between \'targets.z\' and 31'],
+    [{ z: 15, x: 5238, y: 12666, max_z: 21 }, '\'targets\' must not contain more than 4096 tiles']
+  ];
+  let pending = cases.length;
+  cases.forEach(([targets, message]) => {
+    compositeBatch(tiles, targets, {}, (err) => {
+      assert.ok(err);
+      assert.equal(err.message, message);
+      if (--pending === 0) assert.end();
+    });
+  });
+});
@@ -0,0 +1,198 @@
+'use strict';
+
+const test = require('tape');
+const { composite, compositeBatch, configure, localize } = require('../lib/index.js');
+const { vtinfo } = require('./test-utils.js');
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+const mvtFixtures = require('@mapbox/mvt-fixtures');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+
+const places = {
+  version: 2,
+  name: 'places',
+  features: [
+    {
+      id: 1,
+      tags: [0, 0, 1, 1, 2, 2, 3, 3], // name: Ciudad de México, name_en: Mexico City, _mbx_name_fr: Mexico, _mbx_worldview: US,CN
+      type: 1, // point
+      geometry: [9, 54, 38]
+    },
+    {
+      id: 2,
+      tags: [0, 4, 3, 5], // name: Tijuana, _mbx_worldview: JP
+      type: 1, // point
+      geometry: [9, 4000, 4000]
+    }
+  ],
+  keys: ['name', 'name_en', '_mbx_name_fr', '_mbx_worldview'],
+  values: [
+    { string_value: 'Ciudad de México' },
+    { string_value: 'Mexico City' },
+    { string_value: 'Mexico' },
+    { string_value: 'US,CN' },
+    { string_value: 'Tijuana' },
+    { string_value: 'JP' }
+  ],
+  extent: 4096
+};
+const bufferPlaces = mvtFixtures.create({ layers: [places] }).buffer;
+
+const sources = {
+  overzoomed: {
+    tiles: [{ buffer: zlib.gzipSync(bufferSF), z: 15, x: 5238, y: 12666 }],
+    zxy: { z: 17, x: 20953, y: 50666 }
+  },
+  'same zoom': {
+    tiles: [
+      { buffer: bufferPlaces, z: 15, x: 5238, y: 12666 },
+      { buffer: bufferSF, z: 15, x: 5238, y: 12666 }
+    ],
+    zxy: { z: 15, x: 5238, y: 12666 }
+  },
+  mixed: {
+    tiles: [
+      { buffer: bufferPlaces, z: 16, x: 10476, y: 25332 },
+      { buffer: bufferSF, z: 15, x: 5238, y: 12666 }
+    ],
+    zxy: { z: 16, x: 10476, y: 25332 }
+  }
+};
+
+const settings = [
+  {},
+  { languages: ['en'] },
+  { languages: ['fr', 'en'], worldviews: ['US'] },
+  { languages: ['all'] },
+  { worldviews: ['JP'], language_property: 'name', class_property: 'type' },
+  { worldviews: ['CN', 'US'] }
+];
+
+// composite, then localize its output
+function compositeThenLocalize(tiles, zxy, options, params, callback) {
+  composite(tiles, zxy, Object.assign({ buffer_size: 64 }, options), (err, buffer) => {
+    if (err) return callback(err);
+    localize(Object.assign({ buffer }, params), callback);
+  });
+}
+
+Object.keys(sources).forEach((name) => {
+  const { tiles, zxy } = sources[name];
+  [{}, { threads: 4 }].forEach((extra) => {
+    settings.forEach((params) => {
+      test(`[composite] localize option - ${name} - ${JSON.stringify(extra)} - ${JSON.stringify(params)}`, (assert) => {
+        compositeThenLocalize(tiles, zxy, extra, params, (err, expected) => {
+          assert.ifError(err);
+          const options = Object.assign({ buffer_size: 64, localize: params }, extra);
+          composite(tiles, zxy, options, (err, buffer) => {
+            assert.ifError(err);
+            assert.ok(buffer.equals(expected), 'same bytes as composite and localize');
+            assert.end();
+          });
+        });
+      });
+    });
+  });
+});
+
+test('[composite] localize option - features dropped and renamed', (assert) => {
+  const { tiles, zxy } = sources['same zoom'];
+  composite(tiles, zxy, { localize: { languages: ['fr'], worldviews: ['US'] } }, (err, buffer) => {
+    assert.ifError(err);
+    const layer = vtinfo(buffer).layers.places;
+    assert.equal(layer.length, 1, 'feature of another worldview dropped');
+    const properties = layer.feature(0).properties;
+    assert.equal(properties.name, 'Mexico', 'name localized');
+    assert.equal(properties.name_local, 'Ciudad de México', 'local name kept');
+    assert.equal(properties.worldview, 'US', 'worldview');
+    assert.end();
+  });
+});
+
+test('[composite] localize option - a copy of overzoomed features for each worldview', (assert) => {
+  const tiles = [{ buffer: bufferPlaces, z: 15, x: 5238, y: 12666 }];
+  composite(tiles, { z: 16, x: 10476, y: 25332 }, { localize: { worldviews: ['US', 'CN'] } }, (err, buffer) => {
+    assert.ifError(err);
+    const layer = vtinfo(buffer).layers.places;
+    assert.equal(layer.length, 2, 'two copies');
+    assert.deepEqual([layer.feature(0).id, layer.feature(1).id], [1, 1], 'of the same feature');
+    assert.deepEqual([layer.feature(0).properties.worldview, layer.feature(1).properties.worldview], ['CN', 'US'], 'one for each worldview');
+    assert.end();
+  });
+});
+
+test('[composite] localize option - compressed once', (assert) => {
+  const { tiles, zxy } = sources.overzoomed;
+  const params = { languages: ['en'] };
+  compositeThenLocalize(tiles, zxy, {}, params, (err, expected) => {
+    assert.ifError(err);
+    composite(tiles, zxy, { buffer_size: 64, localize: params, compress: true }, (err, buffer) => {
+      assert.ifError(err);
+      assert.ok(zlib.gunzipSync(buffer).equals(expected), 'same tile, gzipped');
+      assert.end();
+    });
+  });
+});
+
+[{}, { threads: 4 }].forEach((extra) => {
+  test(`[composite] localize option - cached layers are localized per call - ${JSON.stringify(extra)}`, (assert) => {
+    const { tiles, zxy } = sources.mixed;
+    configure({ layer_cache_size: 16 * 1024 * 1024 });
+    compositeThenLocalize(tiles, zxy, extra, { languages: ['en'] }, (err, en) => {
+      assert.ifError(err);
+      compositeThenLocalize(tiles, zxy, extra, { languages: ['fr'] }, (err, fr) => {
+        assert.ifError(err);
+        const options = Object.assign({ buffer_size: 64 }, extra);
+        composite(tiles, zxy, Object.assign({ localize: { languages: ['en'] } }, options), (err, buffer) => {
+          assert.ifError(err);
+          assert.ok(buffer.equals(en), 'en from cached layers');
+          composite(tiles, zxy, Object.assign({ localize: { languages: ['fr'] } }, options), (err, buffer) => {
+            configure({ layer_cache_size: 0 });
+            assert.ifError(err);
+            assert.ok(buffer.equals(fr), 'fr from the same cached layers');
+            assert.end();
+          });
+        });
+      });
+    });
+  });
+});
+
+test('[composite] localize option - stats count localized features', (assert) => {
+  const { tiles, zxy } = sources['same zoom'];
+  composite(tiles, zxy, { stats: true, localize: { worldviews: ['JP'] } }, (err, buffer, stats) => {
+    assert.ifError(err);
+    const layer = stats.layers.find((l) => l.name === 'places');
+    assert.equal(layer.features_in, 2, 'features in');
+    assert.equal(layer.features_out, 1, 'features out');
+    assert.ok(stats.time.localize.wall > 0, 'localized');
+    assert.end();
+  });
+});
+
+test('[composite] localize option validation', (assert) => {
+  const { tiles, zxy } = sources.overzoomed;
+  composite(tiles, zxy, { localize: [] }, (err) => {
+    assert.equal(err.message, '\'localize\' must be an object');
+    composite(tiles, zxy, { localize: { languages: 'en' } }, (err) => {
+      assert.equal(err.message, 'localize.languages must be an array');
+      composite(tiles, zxy, { localize: { language: 'en' } }, (err) => {
+        assert.equal(err.message, 'localize.language is an invalid param... do you mean localize.languages?');
+        composite(tiles, zxy, { localize: { hidden_prefix: '' } }, (err) => {
+          assert.equal(err.message, 'localize.hidden_prefix must be a non-empty string');
+          assert.end();
+        });
+      });
+    });
+  });
+});
+
+test('[compositeBatch] localize option is not supported', (assert) => {
+  const { tiles } = sources.overzoomed;
+  compositeBatch(tiles, { z: 16, x: 10476, y: 25332, max_z: 17 }, { localize: {} }, (err) => {
+    assert.equal(err.message, '\'localize\' is not supported by compositeBatch');
+    assert.end();
+  });
+});
@@ -462,6 +462,34 @@ test('[composite] failure: compress must be a boolean', (assert) => {
   });
 });
 
+test('[composite] failure: compression must be a valid object', (assert) => {
+  const buffs = [
+    {
+      buffer: Buffer.from('hey'),
+      z: 0,
+      x: 0,
+      y: 0
+    }
+  ];
+  const cases = [
+    [true, 'compression must be an object'],
+    [{}, 'compression.codec must be \'gzip\', \'zstd\' or \'br\''],
+    [{ codec: 'lz4' }, 'compression.codec must be \'gzip\', \'zstd\' or \'br\''],
+    [{ codec: 'gzip', level: 'max' }, 'compression.level must be an int32'],
+    [{ codec: 'gzip', level: 10 }, 'compression.level must be between 1 and 9 for gzip'],
+    [{ codec: 'gzip', min_bytes: '1k' }, 'compression.min_bytes must be an int32'],
+    [{ codec: 'gzip', min_bytes: -1 }, 'compression.min_bytes must be a positive int32']
+  ];
+  let pending = cases.length;
+  cases.forEach(([compression, message]) => {
+    composite(buffs, { z:0, x:0, y:0 }, { compression }, (err) => {
+      assert.ok(err);
+      assert.equal(err.message, message);
+      if (--pending === 0) assert.end();
+    });
+  });
+});
+
 test('[composite] failure: options must be an object', (assert) => {
   const buffs = [
     {
@@ -509,3 +537,51 @@ test('[composite] failure: buffer size is not positive int32', (assert) => {
     assert.end();
   });
 });
+
+test('[composite] failure: threads is not int32', (assert) => {
+  const buffs = [
+    {
+      buffer: new Buffer.alloc(10),
+      z: 0,
+      x: 0,
+      y: 0
+    }
+  ];
+  composite(buffs, { z:0, x:0, y:0 }, { threads:'hi' }, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, '\'threads\' must be an int32');
+    assert.end();
+  });
+});
+
+test('[composite] failure: threads is not positive int32', (assert) => {
+  const buffs = [
+    {
+      buffer: new Buffer.alloc(10),
+      z: 0,
+      x: 0,
+      y: 0
+    }
+  ];
+  composite(buffs, { z:0, x:0, y:0 }, { threads:0 }, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, '\'threads\' must be a positive int32');
+    assert.end();
+  });
+});
+
+test('[composite] failure: priority is not a known lane', (assert) => {
+  const buffs = [
+    {
+      buffer: new Buffer.alloc(10),
+      z: 0,
+      x: 0,
+      y: 0
+    }
+  ];
+  composite(buffs, { z:0, x:0, y:0 }, { priority:'urgent' }, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, '\'priority\' must be \'interactive\' or \'bulk\'');
+    assert.end();
+  });
+});
@@ -0,0 +1,140 @@
+'use strict';
+
+const test = require('tape');
+const events = require('events');
+const { composite, compositeBatch, compositeSync, localize, configure } = require('../lib/index.js');
+const fs = require('fs');
+const path = require('path');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+const tiles = [{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }];
+const zxy = { z: 15, x: 5238, y: 12666 };
+
+function busyWait(ms) {
+  const end = Date.now() + ms;
+  while (Date.now() < end) {
+    // keep the JS thread busy
+  }
+}
+
+// Calls `second` from the callback of a first composite that holds all of the
+// memory budget until its callback returns, after `delay` ms: the call made by
+// `second` only starts once the first one is done.
+function afterBusyCall(delay, second, done) {
+  // an uncompressed source overzoomed by a single thread is estimated at 3
+  // times its size, and localizing it at its size
+  configure({ memory_budget: Math.floor(bufferSF.length * 3.5) });
+  composite(tiles, { z: 17, x: 20953, y: 50666 }, {}, (err) => {
+    if (err) return done(err);
+    second();
+    busyWait(delay);
+  });
+}
+
+test('[composite] deadline_ms and signal validation', (assert) => {
+  composite(tiles, zxy, { deadline_ms: '10' }, (err) => {
+    assert.equal(err.message, '\'deadline_ms\' must be a number');
+    composite(tiles, zxy, { deadline_ms: 0 }, (err) => {
+      assert.equal(err.message, '\'deadline_ms\' must be a positive number');
+      composite(tiles, zxy, { signal: {} }, (err) => {
+        assert.equal(err.message, '\'signal\' must be an AbortSignal');
+        localize({ buffer: bufferSF, deadline_ms: -1 }, (err) => {
+          assert.equal(err.message, 'params.deadline_ms must be a positive number');
+          localize({ buffer: bufferSF, signal: 'abort' }, (err) => {
+            assert.equal(err.message, 'params.signal must be an AbortSignal');
+            assert.end();
+          });
+        });
+      });
+    });
+  });
+});
+
+test('[composite] deadline_ms: calls finishing in time succeed', (assert) => {
+  composite(tiles, zxy, {}, (err, expected) => {
+    assert.ifError(err);
+    composite(tiles, zxy, { deadline_ms: 60000 }, (err, buffer) => {
+      assert.ifError(err);
+      assert.ok(buffer.equals(expected), 'same output');
+      assert.end();
+    });
+  });
+});
+
+test('[composite] deadline_ms: calls past their deadline fail', (assert) => {
+  afterBusyCall(50, () => {
+    composite(tiles, { z: 17, x: 20953, y: 50666 }, { deadline_ms: 10 }, (err, buffer) => {
+      configure({ memory_budget: 0 });
+      assert.ok(err);
+      assert.equal(err.message, 'deadline exceeded: the call took longer than 10 ms');
+      assert.notOk(buffer);
+      assert.end();
+    });
+  }, assert.end);
+});
+
+test('[localize] deadline_ms: calls past their deadline fail', (assert) => {
+  afterBusyCall(50, () => {
+    localize({ buffer: bufferSF, languages: ['en'], deadline_ms: 10 }, (err) => {
+      configure({ memory_budget: 0 });
+      assert.ok(err);
+      assert.equal(err.message, 'deadline exceeded: the call took longer than 10 ms');
+      assert.end();
+    });
+  }, assert.end);
+});
+
+test('[composite] signal: aborted calls fail', (assert) => {
+  const controller = new AbortController();
+  afterBusyCall(10, () => {
+    composite(tiles, { z: 17, x: 20953, y: 50666 }, { signal: controller.signal }, (err) => {
+      configure({ memory_budget: 0 });
+      assert.ok(err);
+      assert.equal(err.message, 'cancelled: the signal of the call was aborted');
+      // removed once the callback returns
+      setImmediate(() => {
+        if (events.getEventListeners) {
+          assert.equal(events.getEventListeners(controller.signal, 'abort').length, 0, 'listener removed');
+        }
+        assert.end();
+      });
+    });
+    controller.abort();
+  }, assert.end);
+});
+
+test('[composite] signal: calls with a signal aborted beforehand fail', (assert) => {
+  const controller = new AbortController();
+  controller.abort();
+  composite(tiles, zxy, { signal: controller.signal }, (err) => {
+    assert.equal(err.message, 'cancelled: the signal of the call was aborted');
+    compositeBatch(tiles, [{ z: 16, x: 10476, y: 25332 }], { signal: controller.signal }, (err) => {
+      assert.equal(err.message, 'cancelled: the signal of the call was aborted');
+      localize({ buffer: bufferSF, signal: controller.signal }, (err) => {
+        assert.equal(err.message, 'cancelled: the signal of the call was aborted');
+        assert.throws(() => {
+          compositeSync(tiles, zxy, { signal: controller.signal });
+        }, /cancelled/);
+        assert.end();
+      });
+    });
+  });
+});
+
+test('[composite] signal: listeners are removed once calls are done', (assert) => {
+  const controller = new AbortController();
+  let remaining = 3;
+  for (let i = 0; i < 3; ++i) {
+    composite(tiles, zxy, { signal: controller.signal, threads: i + 1 }, (err) => {
+      assert.ifError(err);
+      if (--remaining === 0) {
+        setImmediate(() => {
+          if (events.getEventListeners) {
+            assert.equal(events.getEventListeners(controller.signal, 'abort').length, 0, 'no listeners left');
+          }
+          assert.end();
+        });
+      }
+    });
+  }
+});
@@ -0,0 +1,96 @@
+'use strict';
+
+const test = require('tape');
+const { composite, compositeBatch, configure, cacheStats } = require('../lib/index.js');
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+const mvtFixtures = require('@mapbox/mvt-fixtures');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+const tiles = [
+  { buffer: zlib.gzipSync(bufferSF), z: 15, x: 5238, y: 12666 },
+  { buffer: mvtFixtures.get('059').buffer, z: 14, x: 2619, y: 6333 }
+];
+const zxy = { z: 17, x: 20953, y: 50666 };
+
+test('[configure] layer_cache_size validation', (assert) => {
+  assert.throws(() => {
+    configure({ layer_cache_size: 'big' });
+  }, /'layer_cache_size' must be a number/);
+  assert.throws(() => {
+    configure({ layer_cache_size: -1 });
+  }, /'layer_cache_size' must not be negative/);
+  assert.end();
+});
+
+[{}, { threads: 4 }].forEach((extra) => {
+  test(`[composite] layer cache: same output, hot layers clipped once - ${JSON.stringify(extra)}`, (assert) => {
+    const options = Object.assign({ buffer_size: 64 }, extra);
+    const source = [tiles[0]];
+    composite(source, zxy, options, (err, expected) => {
+      assert.ifError(err);
+      configure({ layer_cache_size: 16 * 1024 * 1024 });
+      const before = cacheStats().layers;
+      composite(source, zxy, options, (err, first) => {
+        assert.ifError(err);
+        const middle = cacheStats().layers;
+        composite(source, zxy, options, (err, second) => {
+          assert.ifError(err);
+          const after = cacheStats().layers;
+          const layers = middle.misses - before.misses;
+          assert.ok(layers > 0, 'layers missed on the first call');
+          assert.equal(middle.hits - before.hits, 0, 'no hit on the first call');
+          assert.equal(after.hits - middle.hits, layers, 'every layer hit on the second call');
+          assert.equal(after.misses - middle.misses, 0, 'no miss on the second call');
+          assert.ok(expected.equals(first), 'same output on a miss');
+          assert.ok(expected.equals(second), 'same output on a hit');
+          configure({ layer_cache_size: 0 });
+          assert.equal(cacheStats().layers.entries, 0, 'disabling the cache empties it');
+          assert.end();
+        });
+      });
+    });
+  });
+});
+
+test('[composite] layer cache: entries depend on buffer_size', (assert) => {
+  configure({ layer_cache_size: 16 * 1024 * 1024 });
+  const source = [tiles[0]];
+  composite(source, zxy, { buffer_size: 0 }, (err) => {
+    assert.ifError(err);
+    const before = cacheStats().layers;
+    composite(source, zxy, { buffer_size: 128 }, (err) => {
+      assert.ifError(err);
+      const after = cacheStats().layers;
+      assert.equal(after.hits - before.hits, 0, 'no hit with another buffer_size');
+      configure({ layer_cache_size: 0 });
+      assert.end();
+    });
+  });
+});
+
+test('[compositeBatch] layer cache: same output as without the cache', (assert) => {
+  const targets = { z: 15, x: 5238, y: 12666, max_z: 17 };
+  compositeBatch(tiles, targets, { buffer_size: 64 }, (err, expected) => {
+    assert.ifError(err);
+    configure({ layer_cache_size: 16 * 1024 * 1024 });
+    // the single composite warms part of the cache, so the batch mixes hits and misses
+    composite([tiles[0]], zxy, { buffer_size: 64 }, (err) => {
+      assert.ifError(err);
+      const before = cacheStats().layers;
+      compositeBatch(tiles, targets, { buffer_size: 64 }, (err, results) => {
+        assert.ifError(err);
+        const after = cacheStats().layers;
+        assert.ok(after.hits > before.hits, 'hits');
+        assert.ok(after.misses > before.misses, 'misses');
+        assert.equal(results.length, expected.length);
+        results.forEach((result, i) => {
+          assert.ok(expected[i].buffer.equals(result.buffer), `same bytes for ${result.z}/${result.x}/${result.y}`);
+        });
+        configure({ layer_cache_size: 0 });
+        assert.end();
+      });
+    });
+  });
+});
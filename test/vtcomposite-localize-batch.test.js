@@ -0,0 +1,165 @@
+'use strict';
+
+const test = require('tape');
+const { localize, localizeBatch } = require('../lib/index.js');
+const { vtinfo } = require('./test-utils.js');
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+const mvtFixtures = require('@mapbox/mvt-fixtures');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+
+const admin = mvtFixtures.create({
+  layers: [
+    {
+      version: 2,
+      name: 'admin',
+      features: [
+        {
+          id: 1,
+          tags: [0, 0, 1, 2, 2, 3], // _mbx_worldview: US,JP, name: Tokyo, _mbx_name_ja: 東京
+          type: 1, // point
+          geometry: [9, 54, 38]
+        },
+        {
+          id: 2,
+          tags: [0, 1, 3, 4], // _mbx_worldview: IN, class: city
+          type: 1, // point
+          geometry: [9, 50, 34]
+        }
+      ],
+      keys: ['_mbx_worldview', 'name', '_mbx_name_ja', 'class'],
+      values: [
+        { string_value: 'US,JP' },
+        { string_value: 'IN' },
+        { string_value: 'Tokyo' },
+        { string_value: '東京' },
+        { string_value: 'city' }
+      ],
+      extent: 4096
+    },
+    {
+      version: 2,
+      name: 'roads',
+      features: [
+        {
+          id: 3,
+          tags: [0, 0], // type: primary
+          type: 2, // linestring
+          geometry: [9, 50, 34, 10, 20, 20]
+        }
+      ],
+      keys: ['type'],
+      values: [
+        { string_value: 'primary' }
+      ],
+      extent: 4096
+    }
+  ]
+}).buffer;
+
+const requests = [
+  {
+    description: 'real world tile, languages and worldviews',
+    params: { buffer: bufferSF },
+    variants: [
+      {},
+      { languages: ['en'] },
+      { languages: ['es', 'fr'], worldviews: ['US'] },
+      { languages: ['all'], worldviews: ['ALL'] },
+      { worldviews: ['CN'] }
+    ]
+  },
+  {
+    description: 'gzipped tile, compressed output, one variant per worldview',
+    params: { buffer: zlib.gzipSync(admin), compress: true },
+    variants: [
+      { languages: ['ja'], worldviews: ['US'] },
+      { languages: ['ja'], worldviews: ['JP'] },
+      { languages: ['ja'], worldviews: ['IN'] },
+      {}
+    ]
+  },
+  {
+    description: 'custom properties and omitted scripts',
+    params: { buffer: admin, hidden_prefix: '_mbx_', omit_scripts: ['Hani'], worldview_default: 'JP' },
+    variants: [
+      { languages: ['local', 'ja'] },
+      { languages: ['ja'] }
+    ]
+  }
+];
+
+requests.forEach((request) => {
+  test(`[localizeBatch] output is byte-identical to localize output - ${request.description}`, (assert) => {
+    localizeBatch(request.params, request.variants, (err, buffers) => {
+      assert.ifError(err);
+      assert.equal(buffers.length, request.variants.length, 'one buffer per variant');
+      let pending = buffers.length;
+      buffers.forEach((buffer, v) => {
+        localize(Object.assign({}, request.params, request.variants[v]), (err, expected) => {
+          assert.ifError(err);
+          assert.ok(expected.equals(buffer), `same bytes for ${JSON.stringify(request.variants[v])}`);
+          if (--pending === 0) assert.end();
+        });
+      });
+    });
+  });
+});
+
+test('[localizeBatch] one worldview per variant', (assert) => {
+  const variants = [{ worldviews: ['US'] }, { worldviews: ['JP'] }, { worldviews: ['IN'] }, { worldviews: ['CN'] }];
+  localizeBatch({ buffer: admin }, variants, (err, buffers) => {
+    assert.ifError(err);
+    const worldviews = buffers.map((buffer) => {
+      const layer = vtinfo(buffer).layers.admin;
+      return layer ? layer.feature(0).properties.worldview : undefined;
+    });
+    assert.deepEqual(worldviews, ['US', 'JP', 'IN', undefined], 'worldview of each variant');
+    buffers.forEach((buffer) => assert.ok(vtinfo(buffer).layers.roads, 'roads copied'));
+    assert.end();
+  });
+});
+
+test('[localizeBatch] stats of every variant', (assert) => {
+  const variants = [{ languages: ['en'] }, { languages: ['ja'] }];
+  localizeBatch({ buffer: admin, stats: true }, variants, (err, buffers, stats) => {
+    assert.ifError(err);
+    assert.equal(stats.bytes_in, admin.length, 'bytes_in');
+    assert.equal(stats.bytes_out, buffers[0].length + buffers[1].length, 'bytes_out of all variants');
+    assert.equal(stats.layers.length, 4, 'layers of every variant');
+    assert.end();
+  });
+});
+
+test('[localizeBatch] failure: invalid arguments', (assert) => {
+  const cases = [
+    [{ buffer: admin, languages: ['en'] }, [{}], 'params.languages and params.worldviews are given by \'variants\''],
+    [{ buffer: admin, worldviews: ['US'] }, [{}], 'params.languages and params.worldviews are given by \'variants\''],
+    [{}, [{}], 'params.buffer is required'],
+    [{ buffer: admin }, {}, '\'variants\' must be an array'],
+    [{ buffer: admin }, [], '\'variants\' array must be of length greater than 0'],
+    [{ buffer: admin }, new Array(257).fill({}), '\'variants\' must not contain more than 256 items'],
+    [{ buffer: admin }, ['en'], 'items in \'variants\' array must be objects'],
+    [{ buffer: admin }, [{}, { languages: 'en' }], 'variants[1].languages must be an array'],
+    [{ buffer: admin }, [{ languages: [''] }], 'variants[0].languages must be an array of non-empty strings'],
+    [{ buffer: admin }, [{ worldviews: [1] }], 'variants[0].worldviews must be an array of non-empty strings'],
+    [{ buffer: admin }, [{ language: 'en' }], 'variants[0].language is an invalid param... do you mean variants[0].languages?'],
+    [{ buffer: admin }, [{ worldview: 'US' }], 'variants[0].worldview is an invalid param... do you mean variants[0].worldviews?']
+  ];
+  let pending = cases.length;
+  cases.forEach(([params, variants, message]) => {
+    localizeBatch(params, variants, (err) => {
+      assert.ok(err);
+      assert.equal(err.message, message);
+      if (--pending === 0) assert.end();
+    });
+  });
+});
+
+test('[localizeBatch] failure: missing callback', (assert) => {
+  assert.throws(() => localizeBatch({ buffer: admin }, [{}]), /expected params, variants and callback arguments/);
+  assert.throws(() => localizeBatch({ buffer: admin }, [{}], {}), /third argument must be a callback function/);
+  assert.end();
+});
@@ -19,7 +19,7 @@ test('[localize] success: buffer size stays the same when no changes needed', (a
     assert.notOk(err);
     const tile = vtinfo(vtBuffer);
     assert.equal(tile.layers.hello.feature(0).id, undefined, 'ID should not be added to feature that does not have one');
-    assert.equal(vtBuffer.length - 3, singlePointBuffer.length, 'same size (with expected 3 byte difference due to explicit 4096 extent in output)');
+    assert.ok(vtBuffer.equals(singlePointBuffer), 'returned as it is, no layer needs localizing');
     assert.end();
   });
 });
@@ -33,7 +33,7 @@ test('[localize] success: single gzipped VT', (assert) => {
   };
   localize(params, (err, vtBuffer) => {
     assert.notOk(err);
-    assert.equal(vtBuffer.length - 3, singlePointBuffer.length, 'same size (with expected 3 byte difference due to explicit 4096 extent in output)');
+    assert.ok(vtBuffer.equals(singlePointBuffer), 'decompressed, not re-encoded');
     assert.end();
   });
 });
@@ -47,7 +47,7 @@ test('[localize] success: gzipped output', (assert) => {
   };
   localize(params, (err, vtBuffer) => {
     assert.notOk(err);
-    assert.equal(zlib.gunzipSync(vtBuffer).length - 3, singlePointBuffer.length, 'same size (with expected 3 byte difference due to explicit 4096 extent in output)');
+    assert.ok(zlib.gunzipSync(vtBuffer).equals(singlePointBuffer), 'compressed, not re-encoded');
     assert.end();
   });
 });
@@ -62,7 +62,7 @@ test('[localize] success: gzipped input and output', (assert) => {
   };
   localize(params, (err, vtBuffer) => {
     assert.notOk(err);
-    assert.equal(zlib.gunzipSync(vtBuffer).length - 3, singlePointBuffer.length, 'same size (with expected 3 byte difference due to explicit 4096 extent in output)');
+    assert.ok(vtBuffer.equals(gzipped_buffer), 'gzipped input returned as it is');
     assert.end();
   });
 });
@@ -1066,3 +1066,94 @@ test('[localize language] languages=all returns languages even language property
     assert.end();
   });
 });
+
+test('[localize] languages: all - keys and values are written once per layer', (assert) => {
+  const params = {
+    buffer: mvtFixtures.create({
+      layers: [
+        {
+          version: 2,
+          name: 'places',
+          features: [
+            {
+              id: 1,
+              tags: [0, 0, 1, 1], // name: Paris, name_fr: París
+              type: 1, // point
+              geometry: [9, 54, 38]
+            },
+            {
+              id: 2,
+              tags: [0, 2, 2, 1, 3, 3], // name: Lyon, _mbx_name_fr: París, type: city
+              type: 1, // point
+              geometry: [9, 50, 34]
+            }
+          ],
+          keys: ['name', 'name_fr', '_mbx_name_fr', 'type'],
+          values: [
+            { string_value: 'Paris' },
+            { string_value: 'París' },
+            { string_value: 'Lyon' },
+            { string_value: 'city' }
+          ],
+          extent: 4096
+        }
+      ]
+    }).buffer,
+    languages: ['all']
+  };
+
+  localize(params, (err, buffer) => {
+    assert.notOk(err);
+    const layer = vtinfo(buffer).layers.places;
+    assert.deepEqual(layer.feature(0).properties, { name: 'Paris', name_local: 'Paris', name_fr: 'París' }, 'first feature');
+    assert.deepEqual(layer.feature(1).properties, { name: 'Lyon', name_local: 'Lyon', name_fr: 'París', type: 'city' }, 'second feature');
+    assert.deepEqual(layer._keys.slice().sort(), ['name', 'name_fr', 'name_local', 'type'], 'each key once');
+    assert.deepEqual(layer._values.slice().sort(), ['city', 'Lyon', 'Paris', 'París'].sort(), 'each value once');
+    assert.end();
+  });
+});
+
+test('[localize language] languages=all does not carry name_xx(s) over to the next feature', (assert) => {
+  const params = {
+    buffer: mvtFixtures.create({
+      layers: [
+        {
+          version: 2,
+          name: 'places',
+          features: [
+            {
+              id: 10,
+              tags: [0, 0, 1, 1, 2, 2],
+              type: 1, // point
+              geometry: [9, 54, 38]
+            },
+            {
+              id: 11,
+              tags: [0, 3],
+              type: 1, // point
+              geometry: [9, 56, 40]
+            }
+          ],
+          keys: ['name', 'name_de', '_mbx_name_fr'],
+          values: [
+            { string_value: 'place' },
+            { string_value: 'place DE' },
+            { string_value: 'place FR' },
+            { string_value: 'other place' }
+          ],
+          extent: 4096
+        }
+      ]
+    }).buffer,
+    languages: ['all']
+  };
+
+  localize(params, (err, buffer) => {
+    assert.notOk(err);
+    const info = vtinfo(buffer);
+    assert.equal(info.layers.places.length, 2, 'expected number of features');
+    assert.deepEqual(info.layers.places.feature(0).properties, { name: 'place', name_local: 'place', name_de: 'place DE', name_fr: 'place FR' }, 'first feature');
+    assert.deepEqual(info.layers.places.feature(1).properties, { name: 'other place', name_local: 'other place' }, 'second feature');
+    assert.end();
+  });
+});
@@ -443,3 +443,61 @@ test('[localize] params.compress', (assert) => {
 
   assert.end();
 });
+
+test('[localize] params.compression', (assert) => {
+  localize({
+    buffer: Buffer.from('howdy'),
+    compression: 'gzip' // not an object
+  }, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, 'params.compression must be an object', 'expected error message');
+  });
+
+  localize({
+    buffer: Buffer.from('howdy'),
+    compression: { codec: 'deflate' }
+  }, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, 'params.compression.codec must be \'gzip\', \'zstd\' or \'br\'', 'expected error message');
+  });
+
+  localize({
+    buffer: Buffer.from('howdy'),
+    compression: { codec: 'br', level: 12 }
+  }, (err) => {
+    assert.ok(err);
+    if (err.message.indexOf('not supported by this build') === -1) {
+      assert.equal(err.message, 'params.compression.level must be between 0 and 11 for br', 'expected error message');
+    }
+  });
+
+  localize({
+    buffer: Buffer.from('howdy'),
+    compression: { codec: 'gzip', min_bytes: -5 }
+  }, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, 'params.compression.min_bytes must be a positive int32', 'expected error message');
+  });
+
+  assert.end();
+});
+
+test('[localize] params.priority', (assert) => {
+  localize({
+    buffer: Buffer.from('howdy'),
+    priority: 1 // not a string
+  }, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, 'params.priority must be \'interactive\' or \'bulk\'', 'expected error message');
+  });
+
+  localize({
+    buffer: Buffer.from('howdy'),
+    priority: 'urgent' // not a lane
+  }, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, 'params.priority must be \'interactive\' or \'bulk\'', 'expected error message');
+  });
+
+  assert.end();
+});
@@ -0,0 +1,111 @@
+'use strict';
+
+const localize = require('../lib/index.js').localize;
+const { vtinfo } = require('./test-utils.js');
+const mvtFixtures = require('@mapbox/mvt-fixtures');
+const test = require('tape');
+const zlib = require('zlib');
+
+const roads = {
+  version: 2,
+  name: 'roads',
+  features: [
+    {
+      id: 1,
+      tags: [0, 0, 1, 1], // type: primary, lanes: 2
+      type: 2, // linestring
+      geometry: [9, 50, 34, 10, 20, 20]
+    }
+  ],
+  keys: ['type', 'lanes'],
+  values: [
+    { string_value: 'primary' },
+    { int_value: 2 }
+  ],
+  extent: 4096
+};
+
+const places = {
+  version: 2,
+  name: 'places',
+  features: [
+    {
+      id: 2,
+      tags: [0, 0, 1, 1, 2, 2], // name: Ciudad de México, name_en: Mexico City, _mbx_name_fr: Mexico
+      type: 1, // point
+      geometry: [9, 54, 38]
+    }
+  ],
+  keys: ['name', 'name_en', '_mbx_name_fr'],
+  values: [
+    { string_value: 'Ciudad de México' },
+    { string_value: 'Mexico City' },
+    { string_value: 'Mexico' }
+  ],
+  extent: 4096
+};
+
+const unaffected = mvtFixtures.create({ layers: [roads] }).buffer;
+const mixed = mvtFixtures.create({ layers: [roads, places, Object.assign({}, roads, { name: 'bridges' })] }).buffer;
+
+test('[localize pass-through] tile without localizable keys is returned as it is', (assert) => {
+  localize({ buffer: unaffected, languages: ['en'], worldviews: ['US'] }, (err, buffer) => {
+    assert.ifError(err);
+    assert.ok(buffer.equals(unaffected), 'same bytes');
+    assert.end();
+  });
+});
+
+test('[localize pass-through] gzipped tile is returned as it is when compressing', (assert) => {
+  const gzipped = zlib.gzipSync(unaffected);
+  localize({ buffer: gzipped, compress: true }, (err, buffer) => {
+    assert.ifError(err);
+    assert.ok(buffer.equals(gzipped), 'same bytes');
+    assert.end();
+  });
+});
+
+test('[localize pass-through] gzipped tile is decompressed when not compressing', (assert) => {
+  localize({ buffer: zlib.gzipSync(unaffected) }, (err, buffer) => {
+    assert.ifError(err);
+    assert.ok(buffer.equals(unaffected), 'decompressed bytes');
+    assert.end();
+  });
+});
+
+test('[localize pass-through] tile is compressed when requested', (assert) => {
+  localize({ buffer: unaffected, compress: true }, (err, buffer) => {
+    assert.ifError(err);
+    assert.ok(zlib.gunzipSync(buffer).equals(unaffected), 'compressed bytes');
+    assert.end();
+  });
+});
+
+test('[localize pass-through] unaffected layers are copied, in order, next to localized ones', (assert) => {
+  localize({ buffer: mixed, languages: ['en'] }, (err, buffer) => {
+    assert.ifError(err);
+    const tile = vtinfo(buffer);
+    assert.deepEqual(Object.keys(tile.layers), ['roads', 'places', 'bridges'], 'layer order');
+    ['roads', 'bridges'].forEach((name) => {
+      assert.equal(tile.layers[name].length, 1, `${name}: one feature`);
+      assert.deepEqual(tile.layers[name].feature(0).properties, { type: 'primary', lanes: 2 }, `${name}: properties kept`);
+    });
+    assert.deepEqual(tile.layers.places.feature(0).properties, {
+      name: 'Mexico City',
+      name_local: 'Ciudad de México'
+    }, 'places: localized');
+    assert.end();
+  });
+});
+
+test('[localize pass-through] layers with hidden keys are rewritten', (assert) => {
+  localize({ buffer: mixed }, (err, buffer) => {
+    assert.ifError(err);
+    const tile = vtinfo(buffer);
+    assert.deepEqual(tile.layers.places.feature(0).properties, {
+      name: 'Ciudad de México',
+      name_en: 'Mexico City'
+    }, 'hidden name_fr dropped');
+    assert.end();
+  });
+});
@@ -1377,3 +1377,66 @@ test('[localize worldview] requesting worldviews=ALL returns the comma separated
     assert.end();
   });
 });
+
+test('[localize worldview] requesting localized worldview; features sharing worldview values', (assert) => {
+  const feature = mvtFixtures.create({
+    layers: [
+      {
+        version: 2,
+        name: 'admin',
+        features: [
+          { id: 10, tags: [0, 0], type: 1, geometry: [9, 54, 38] },
+          { id: 11, tags: [0, 1], type: 1, geometry: [9, 56, 40] },
+          { id: 12, tags: [0, 0], type: 1, geometry: [9, 58, 42] },
+          { id: 13, tags: [0, 1], type: 1, geometry: [9, 60, 44] }
+        ],
+        keys: ['_mbx_worldview'],
+        values: [
+          { string_value: 'US,JP' },
+          { string_value: 'CN' }
+        ],
+        extent: 4096
+      }
+    ]
+  }).buffer;
+
+  localize({ buffer: feature, worldviews: ['JP'] }, (err, vtBuffer) => {
+    assert.ifError(err);
+    const tile = vtinfo(vtBuffer);
+    assert.equal(tile.layers.admin.length, 2, 'features in JP kept');
+    assert.deepEqual([tile.layers.admin.feature(0).id, tile.layers.admin.feature(1).id], [10, 12], 'expected features');
+    assert.deepEqual(tile.layers.admin.feature(1).properties, { worldview: 'JP' }, 'expected properties');
+    assert.end();
+  });
+});
+
+test('[localize worldview] requesting several localized worldviews; a copy of the feature for each', (assert) => {
+  const feature = mvtFixtures.create({
+    layers: [
+      {
+        version: 2,
+        name: 'admin',
+        features: [
+          { id: 10, tags: [0, 0], type: 1, geometry: [9, 54, 38] },
+          { id: 11, tags: [0, 1], type: 1, geometry: [9, 56, 40] }
+        ],
+        keys: ['_mbx_worldview'],
+        values: [
+          { string_value: 'US,JP,CN' },
+          { string_value: 'IN' }
+        ],
+        extent: 4096
+      }
+    ]
+  }).buffer;
+
+  localize({ buffer: feature, worldviews: ['US', 'JP'] }, (err, vtBuffer) => {
+    assert.ifError(err);
+    const tile = vtinfo(vtBuffer);
+    assert.equal(tile.layers.admin.length, 2, 'a feature for each requested worldview');
+    assert.deepEqual([tile.layers.admin.feature(0).id, tile.layers.admin.feature(1).id], [10, 10], 'copies of the same feature');
+    assert.deepEqual(tile.layers.admin.feature(0).properties, { worldview: 'JP' }, 'first copy');
+    assert.deepEqual(tile.layers.admin.feature(1).properties, { worldview: 'US' }, 'second copy');
+    assert.end();
+  });
+});
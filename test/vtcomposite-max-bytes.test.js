@@ -0,0 +1,203 @@
+'use strict';
+
+const test = require('tape');
+const { composite, compositeBatch } = require('../lib/index.js');
+const { vtinfo } = require('./test-utils.js');
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+const mvtFixtures = require('@mapbox/mvt-fixtures');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+const tilesSF = [{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }];
+const zxy = { z: 15, x: 5238, y: 12666 };
+
+// points ranked 2, 1, 3 and unranked
+const ranked = {
+  version: 2,
+  name: 'ranked',
+  features: [
+    { id: 1, tags: [0, 0], type: 1, geometry: [9, 50, 50] },
+    { id: 2, tags: [0, 1], type: 1, geometry: [9, 100, 100] },
+    { id: 3, tags: [0, 2], type: 1, geometry: [9, 150, 150] },
+    { id: 4, tags: [], type: 1, geometry: [9, 200, 200] }
+  ],
+  keys: ['filterrank'],
+  values: [{ int_value: 2 }, { int_value: 1 }, { int_value: 3 }],
+  extent: 4096
+};
+const bufferRanked = mvtFixtures.create({ layers: [ranked] }).buffer;
+
+function ids(buffer, name) {
+  const layer = vtinfo(buffer).layers[name];
+  const result = [];
+  for (let i = 0; i < layer.length; ++i) {
+    result.push(layer.feature(i).id);
+  }
+  return result;
+}
+
+test('[composite] max_bytes validation', (assert) => {
+  const cases = [
+    [{ max_bytes: '1mb' }, '\'max_bytes\' must be a number'],
+    [{ max_bytes: 0 }, '\'max_bytes\' must be a positive number'],
+    [{ drop_priority: ['water'] }, '\'drop_priority\' must be an object'],
+    [{ drop_priority: { water: 'high' } }, 'values of \'drop_priority\' must be numbers'],
+    [{ drop_property: 1 }, '\'drop_property\' must be a string']
+  ];
+  let pending = cases.length;
+  cases.forEach(([options, message]) => {
+    composite(tilesSF, zxy, options, (err) => {
+      assert.ok(err);
+      assert.equal(err.message, message);
+      if (--pending === 0) assert.end();
+    });
+  });
+});
+
+test('[composite] max_bytes: tiles within the limit are unchanged', (assert) => {
+  composite(tilesSF, zxy, {}, (err, expected) => {
+    assert.ifError(err);
+    composite(tilesSF, zxy, { max_bytes: expected.length, stats: true }, (err, buffer, stats) => {
+      assert.ifError(err);
+      assert.ok(buffer.equals(expected), 'same tile');
+      assert.deepEqual(stats.dropped, { features: 0, bytes: 0 }, 'nothing dropped');
+      assert.end();
+    });
+  });
+});
+
+test('[composite] max_bytes: features are dropped to fit', (assert) => {
+  composite(tilesSF, zxy, { stats: true }, (err, full, fullStats) => {
+    assert.ifError(err);
+    const max_bytes = Math.floor(full.length / 2);
+    composite(tilesSF, zxy, { max_bytes, stats: true }, (err, buffer, stats) => {
+      assert.ifError(err);
+      assert.ok(buffer.length <= max_bytes, 'within max_bytes');
+      assert.ok(buffer.length > max_bytes / 2, 'only dropped what was needed');
+      assert.equal(stats.dropped.bytes, full.length - buffer.length, 'bytes dropped');
+      const dropped = stats.layers.reduce((sum, l) => sum + l.dropped, 0);
+      assert.ok(dropped > 0, 'features dropped');
+      assert.equal(stats.dropped.features, dropped, 'features dropped summed over layers');
+      const tile = vtinfo(buffer);
+      stats.layers.forEach((l, i) => {
+        assert.equal(l.features_out, fullStats.layers[i].features_out - l.dropped, `${l.name} features out`);
+        assert.equal(tile.layers[l.name] ? tile.layers[l.name].length : 0, l.features_out, `${l.name} features in the tile`);
+      });
+      composite(tilesSF, zxy, { max_bytes }, (err, again) => {
+        assert.ifError(err);
+        assert.ok(again.equals(buffer), 'deterministic');
+        assert.end();
+      });
+    });
+  });
+});
+
+test('[composite] max_bytes: layers with a lower drop_priority go first', (assert) => {
+  composite(tilesSF, zxy, {}, (err, full) => {
+    assert.ifError(err);
+    const options = { max_bytes: full.length - 100, drop_priority: { poi_label: -1 }, stats: true };
+    composite(tilesSF, zxy, options, (err, buffer, stats) => {
+      assert.ifError(err);
+      assert.ok(buffer.length <= options.max_bytes, 'within max_bytes');
+      stats.layers.forEach((l) => {
+        if (l.name === 'poi_label') {
+          assert.ok(l.dropped > 0, 'poi_label features dropped');
+        } else {
+          assert.equal(l.dropped, 0, `${l.name} kept`);
+        }
+      });
+      assert.end();
+    });
+  });
+});
+
+test('[composite] max_bytes: features with a higher drop_property go first, then smaller geometries', (assert) => {
+  const tiles = [{ buffer: bufferRanked, z: 15, x: 5238, y: 12666 }];
+  composite(tiles, zxy, {}, (err, full) => {
+    assert.ifError(err);
+    assert.deepEqual(ids(full, 'ranked'), [1, 2, 3, 4]);
+    composite(tiles, zxy, { max_bytes: full.length - 1 }, (err, buffer) => {
+      assert.ifError(err);
+      assert.deepEqual(ids(buffer, 'ranked'), [1, 2, 4], 'rank 3 dropped');
+      composite(tiles, zxy, { max_bytes: full.length - 25 }, (err, buffer) => {
+        assert.ifError(err);
+        assert.deepEqual(ids(buffer, 'ranked'), [2, 4], 'ranks 3 and 2 dropped');
+        composite(tiles, zxy, { max_bytes: full.length - 1, drop_property: 'rank' }, (err, buffer) => {
+          assert.ifError(err);
+          assert.deepEqual(ids(buffer, 'ranked'), [1, 3, 4], 'without ranks, the later of the smallest geometries dropped');
+          composite(tiles, zxy, { max_bytes: 1 }, (err, buffer) => {
+            assert.ifError(err);
+            assert.equal(buffer.length, 0, 'every feature dropped');
+            assert.end();
+          });
+        });
+      });
+    });
+  });
+});
+
+test('[composite] max_bytes: dropped features are reported without stats', (assert) => {
+  composite(tilesSF, zxy, {}, (err, full, info) => {
+    assert.ifError(err);
+    assert.equal(info, undefined, 'no third argument without max_bytes');
+    composite(tilesSF, zxy, { max_bytes: full.length }, (err, buffer, info) => {
+      assert.ifError(err);
+      assert.deepEqual(info, { dropped: { features: 0, bytes: 0 } }, 'nothing dropped');
+      composite(tilesSF, zxy, { max_bytes: Math.floor(full.length / 2) }, (err, buffer, info) => {
+        assert.ifError(err);
+        assert.ok(info.dropped.features > 0, 'features dropped');
+        assert.equal(info.dropped.bytes, full.length - buffer.length, 'bytes dropped');
+        assert.end();
+      });
+    });
+  });
+});
+
+test('[composite] max_bytes: overzoomed and localized layers', (assert) => {
+  const target = { z: 16, x: 10476, y: 25332 };
+  const cases = [
+    [{}, 'overzoomed'],
+    [{ localize: { languages: ['en'] } }, 'overzoomed and localized'],
+    [{ threads: 2, localize: { languages: ['en'] } }, 'overzoomed and localized in parallel']
+  ];
+  let remaining = cases.length;
+  cases.forEach(([options, message]) => {
+    composite(tilesSF, target, options, (err, full) => {
+      assert.ifError(err);
+      composite(tilesSF, target, Object.assign({ max_bytes: full.length }, options), (err, buffer) => {
+        assert.ifError(err);
+        assert.ok(buffer.equals(full), `${message}: same tile within the limit`);
+        const max_bytes = Math.floor(full.length / 2);
+        composite(tilesSF, target, Object.assign({ max_bytes, stats: true }, options), (err, buffer, stats) => {
+          assert.ifError(err);
+          assert.ok(buffer.length <= max_bytes, `${message}: within max_bytes`);
+          assert.equal(stats.dropped.bytes, full.length - buffer.length, `${message}: bytes dropped`);
+          if (--remaining === 0) assert.end();
+        });
+      });
+    });
+  });
+});
+
+test('[composite] max_bytes: applies before compression', (assert) => {
+  composite(tilesSF, zxy, {}, (err, full) => {
+    assert.ifError(err);
+    const max_bytes = Math.floor(full.length / 2);
+    composite(tilesSF, zxy, { max_bytes }, (err, expected) => {
+      assert.ifError(err);
+      composite(tilesSF, zxy, { max_bytes, compress: true }, (err, buffer) => {
+        assert.ifError(err);
+        assert.ok(zlib.gunzipSync(buffer).equals(expected), 'same tile, gzipped');
+        assert.end();
+      });
+    });
+  });
+});
+
+test('[compositeBatch] max_bytes is not supported', (assert) => {
+  compositeBatch(tilesSF, [zxy], { max_bytes: 1024 }, (err) => {
+    assert.equal(err.message, '\'max_bytes\' is not supported by compositeBatch');
+    assert.end();
+  });
+});
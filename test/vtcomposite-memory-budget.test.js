@@ -0,0 +1,129 @@
+'use strict';
+
+const test = require('tape');
+const { composite, compositeSync, localize, configure, memoryStats } = require('../lib/index.js');
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+const gzippedSF = zlib.gzipSync(bufferSF);
+const zxy = { z: 15, x: 5238, y: 12666 };
+
+test('[configure] memory_budget validation', (assert) => {
+  assert.throws(() => {
+    configure({ memory_budget: 'big' });
+  }, /'memory_budget' must be a number/);
+  assert.throws(() => {
+    configure({ memory_budget: -1 });
+  }, /'memory_budget' must not be negative/);
+  assert.end();
+});
+
+test('[memoryStats] nothing in flight when idle', (assert) => {
+  const stats = memoryStats();
+  ['in_flight', 'peak', 'max_bytes', 'waiting', 'queued', 'rejected'].forEach((key) => {
+    assert.equal(typeof stats[key], 'number', key);
+  });
+  assert.equal(stats.in_flight, 0, 'in_flight');
+  assert.equal(stats.waiting, 0, 'waiting');
+  assert.equal(stats.max_bytes, 0, 'unlimited by default');
+  assert.end();
+});
+
+test('[memoryStats] calls are counted while in flight', (assert) => {
+  const before = memoryStats();
+  composite([{ buffer: gzippedSF, z: 15, x: 5238, y: 12666 }], { z: 17, x: 20953, y: 50666 }, {}, (err) => {
+    assert.ifError(err);
+    // released once the callback returns
+    setImmediate(() => {
+      const after = memoryStats();
+      assert.equal(after.in_flight, 0, 'released');
+      assert.ok(after.peak >= bufferSF.length * 2, 'decompressed source and output counted');
+      assert.equal(after.rejected, before.rejected, 'not rejected');
+      assert.end();
+    });
+  });
+});
+
+test('[composite] memory budget: calls larger than the budget are rejected', (assert) => {
+  configure({ memory_budget: 1024 });
+  const before = memoryStats();
+  assert.equal(before.max_bytes, 1024, 'budget');
+  composite([{ buffer: gzippedSF, z: 15, x: 5238, y: 12666 }], zxy, {}, (err, buffer) => {
+    assert.ok(err);
+    assert.ok(/^memory budget exceeded/.test(err.message), err.message);
+    assert.notOk(buffer);
+    localize({ buffer: gzippedSF }, (err) => {
+      assert.ok(err);
+      assert.ok(/^memory budget exceeded/.test(err.message), err.message);
+      assert.equal(memoryStats().rejected - before.rejected, 2, 'rejections counted');
+      configure({ memory_budget: 0 });
+      assert.end();
+    });
+  });
+});
+
+test('[composite] memory budget: deeper overzooms are estimated larger', (assert) => {
+  // an uncompressed source is estimated at twice its size overzoomed by one
+  // zoom level and three times by seven, plus its size for the output tile
+  configure({ memory_budget: Math.floor(bufferSF.length * 3.5) });
+  const before = memoryStats();
+  composite([{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }], { z: 16, x: 10476, y: 25332 }, {}, (err) => {
+    assert.ifError(err);
+    composite([{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }], { z: 22, x: 670464, y: 1621248 }, {}, (err) => {
+      assert.ok(err);
+      assert.ok(/^memory budget exceeded/.test(err.message), err.message);
+      assert.equal(memoryStats().rejected - before.rejected, 1, 'only the deeper overzoom rejected');
+      configure({ memory_budget: 0 });
+      assert.end();
+    });
+  });
+});
+
+test('[compositeSync] memory budget: throws when the call is larger than the budget', (assert) => {
+  configure({ memory_budget: 1024 });
+  assert.throws(() => {
+    compositeSync([{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }], zxy);
+  }, /memory budget exceeded/);
+  configure({ memory_budget: 0 });
+  assert.end();
+});
+
+test('[composite] memory budget: calls wait for memory in flight', (assert) => {
+  // an uncompressed source at the target zoom is estimated at its size for the
+  // output tile, so only one call fits at a time
+  configure({ memory_budget: Math.floor(bufferSF.length * 1.5) });
+  composite([{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }], zxy, {}, (err, expected) => {
+    assert.ifError(err);
+    // once the memory of this call is released
+    setImmediate(() => run(expected));
+  });
+
+  function run(expected) {
+    const before = memoryStats();
+    const calls = 4;
+    const order = [];
+    let remaining = calls;
+    for (let i = 0; i < calls; ++i) {
+      composite([{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }], zxy, {}, (err, buffer) => {
+        assert.ifError(err);
+        assert.ok(buffer.equals(expected), 'same output');
+        order.push(i);
+        if (--remaining === 0) {
+          setImmediate(() => {
+            const after = memoryStats();
+            assert.deepEqual(order, [0, 1, 2, 3], 'started in the order they were made');
+            assert.equal(after.queued - before.queued, calls - 1, 'all but the first waited');
+            assert.equal(after.rejected, before.rejected, 'none rejected');
+            assert.equal(after.in_flight, 0, 'all released');
+            assert.equal(after.waiting, 0, 'none waiting');
+            configure({ memory_budget: 0 });
+            assert.end();
+          });
+        }
+      });
+    }
+    assert.equal(memoryStats().waiting, calls - 1, 'all but the first are waiting, admitted on the calling thread');
+  }
+});
@@ -0,0 +1,122 @@
+'use strict';
+
+const test = require('tape');
+const { composite, compositePacked, localize } = require('../lib/index.js');
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+const mvtFixtures = require('@mapbox/mvt-fixtures');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+const bufferPoints = mvtFixtures.get('017').buffer;
+
+function sameAsComposite(assert, tiles, zxy, options, message, done) {
+  composite(tiles, zxy, options, (err, expected) => {
+    assert.ifError(err);
+    const coords = [zxy.z, zxy.x, zxy.y];
+    tiles.forEach((t) => coords.push(t.z, t.x, t.y));
+    compositePacked(tiles.map((t) => t.buffer), Uint32Array.from(coords), options, (err, buffer) => {
+      assert.ifError(err);
+      assert.ok(buffer.equals(expected), message);
+      done();
+    });
+  });
+}
+
+test('[compositePacked] same output as composite', (assert) => {
+  const cases = [
+    [[{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }], { z: 15, x: 5238, y: 12666 }, {}, 'at the source zoom'],
+    [[{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }], { z: 17, x: 20953, y: 50666 }, { buffer_size: 128 }, 'overzoomed'],
+    [[{ buffer: zlib.gzipSync(bufferSF), z: 15, x: 5238, y: 12666 }], { z: 16, x: 10476, y: 25332 }, { compress: true }, 'gzipped'],
+    [[{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }, { buffer: bufferPoints, z: 16, x: 10476, y: 25332 }], { z: 16, x: 10476, y: 25332 }, {}, 'several sources']
+  ];
+  let remaining = cases.length;
+  cases.forEach(([tiles, zxy, options, message]) => {
+    sameAsComposite(assert, tiles, zxy, options, message, () => {
+      if (--remaining === 0) assert.end();
+    });
+  });
+});
+
+test('[compositePacked] without options', (assert) => {
+  composite([{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }], { z: 16, x: 10476, y: 25332 }, {}, (err, expected) => {
+    assert.ifError(err);
+    compositePacked([bufferSF], Uint32Array.of(16, 10476, 25332, 15, 5238, 12666), (err, buffer) => {
+      assert.ifError(err);
+      assert.ok(buffer.equals(expected), 'same output');
+      assert.end();
+    });
+  });
+});
+
+test('[compositePacked] argument validation', (assert) => {
+  const coords = Uint32Array.of(15, 5238, 12666, 15, 5238, 12666);
+  const cases = [
+    [{ buffer: bufferSF }, coords, {}, 'first arg \'buffers\' must be an array of buffers'],
+    [[], coords, {}, '\'buffers\' array must be of length greater than 0'],
+    [['tile'], coords, {}, 'items in \'buffers\' array must be buffers'],
+    [[bufferSF], [15, 5238, 12666, 15, 5238, 12666], {}, 'second arg \'coords\' must be a Uint32Array'],
+    [[bufferSF], Int32Array.from(coords), {}, 'second arg \'coords\' must be a Uint32Array'],
+    [[bufferSF], Uint32Array.of(15, 5238, 12666), {}, '\'coords\' must hold the z, x, y of the target tile and of each buffer'],
+    [[bufferSF], Uint32Array.of(15, 5238, 12666, 32, 0, 0), {}, '\'coords\' must hold the z, x, y of valid tiles'],
+    [[bufferSF], Uint32Array.of(1, 2, 0, 0, 0, 0), {}, '\'coords\' must hold the z, x, y of valid tiles'],
+    [[bufferSF], coords, { buffer_size: -1 }, '\'buffer_size\' must be a positive int32'],
+    [[bufferSF], Uint32Array.of(14, 2619, 6333, 15, 5238, 12666), {}, 'Invalid tile composite request: SOURCE(15,5238,12666) TARGET(14,2619,6333)']
+  ];
+  let remaining = cases.length;
+  cases.forEach(([buffers, zxy, options, message]) => {
+    compositePacked(buffers, zxy, options, (err) => {
+      assert.ok(err);
+      assert.equal(err.message, message);
+      if (--remaining === 0) assert.end();
+    });
+  });
+});
+
+test('[compositePacked] callback validation', (assert) => {
+  assert.throws(() => {
+    compositePacked([bufferSF], Uint32Array.of(15, 5238, 12666, 15, 5238, 12666), {});
+  }, /last argument must be a callback function/);
+  assert.end();
+});
+
+test('[composite] calls do not see the options of earlier calls', (assert) => {
+  const tiles = [{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }];
+  const zxy = { z: 15, x: 5238, y: 12666 };
+  composite(tiles, zxy, {}, (err, expected) => {
+    assert.ifError(err);
+    const options = { compress: true, buffer_size: 64, max_bytes: 1024, drop_priority: { water: 1 }, localize: { languages: ['en'] } };
+    let remaining = 16;
+    for (let i = 0; i < 16; ++i) {
+      composite(tiles, zxy, options, (err) => {
+        assert.ifError(err);
+        if (--remaining === 0) {
+          // after the batons of the calls above are handed back
+          setImmediate(() => {
+            composite(tiles, zxy, {}, (err, buffer) => {
+              assert.ifError(err);
+              assert.ok(buffer.equals(expected), 'same output');
+              assert.end();
+            });
+          });
+        }
+      });
+    }
+  });
+});
+
+test('[localize] calls do not see the params of earlier calls', (assert) => {
+  localize({ buffer: bufferSF }, (err, expected) => {
+    assert.ifError(err);
+    localize({ buffer: bufferSF, languages: ['en'], worldviews: ['US'], compress: true }, (err) => {
+      assert.ifError(err);
+      setImmediate(() => {
+        localize({ buffer: bufferSF }, (err, buffer) => {
+          assert.ifError(err);
+          assert.ok(buffer.equals(expected), 'same output');
+          assert.end();
+        });
+      });
+    });
+  });
+});
@@ -0,0 +1,108 @@
+'use strict';
+
+const test = require('tape');
+const composite = require('../lib/index.js').composite;
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+const mvtFixtures = require('@mapbox/mvt-fixtures');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+
+const requests = [
+  {
+    description: 'single tile, same zoom',
+    tiles: [{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }],
+    zxy: { z: 15, x: 5238, y: 12666 },
+    options: {}
+  },
+  {
+    description: 'single gzipped tile, overzoomed',
+    tiles: [{ buffer: zlib.gzipSync(bufferSF), z: 15, x: 5238, y: 12666 }],
+    zxy: { z: 17, x: 20953, y: 50666 },
+    options: { buffer_size: 128 }
+  },
+  {
+    description: 'several tiles, mixed zooms and layer filters',
+    tiles: [
+      { buffer: fs.readFileSync('./test/fixtures/polygons-buildings-sf-15-5239-12666.mvt'), z: 15, x: 5239, y: 12666 },
+      { buffer: fs.readFileSync('./test/fixtures/polygons-hillshade-sf-15-5239-12666.mvt'), z: 15, x: 5239, y: 12666 },
+      { buffer: fs.readFileSync('./test/fixtures/points-poi-sf-15-5239-12666.mvt'), z: 16, x: 10478, y: 25332 },
+      { buffer: fs.readFileSync('./test/fixtures/linestrings-sf-15-5239-12666.mvt'), z: 15, x: 5239, y: 12666, layers: ['road'] }
+    ],
+    zxy: { z: 16, x: 10478, y: 25332 },
+    options: { buffer_size: 64 }
+  },
+  {
+    description: 'same layer name in two sources, first source wins',
+    tiles: [
+      { buffer: mvtFixtures.get('059').buffer, z: 14, x: 2619, y: 6333 },
+      { buffer: mvtFixtures.get('060').buffer, z: 15, x: 5238, y: 12666 }
+    ],
+    zxy: { z: 15, x: 5238, y: 12666 },
+    options: {}
+  },
+  {
+    description: 'compressed output',
+    tiles: [{ buffer: fs.readFileSync('./test/fixtures/polygons-with-holes-4-13-6.mvt'), z: 4, x: 13, y: 6 }],
+    zxy: { z: 7, x: 107, y: 49 },
+    options: { buffer_size: 128, compress: true }
+  }
+];
+
+// see '[composite] resolves polygon clockwise error in overzoomed V1 tiles'
+if (!process.env.ASAN_OPTIONS) {
+  requests.push({
+    description: 'overzoomed v1 tiles',
+    tiles: [
+      { buffer: fs.readFileSync('./test/fixtures/v1-6.mvt'), z: 3, x: 4, y: 2 },
+      { buffer: fs.readFileSync('./test/fixtures/v1-7.mvt'), z: 3, x: 4, y: 2 },
+      { buffer: fs.readFileSync('./test/fixtures/v1-8.mvt'), z: 2, x: 2, y: 1 }
+    ],
+    zxy: { z: 4, x: 8, y: 5 },
+    options: { buffer_size: 4080 }
+  });
+}
+
+requests.forEach((request) => {
+  test(`[composite] threads output is byte-identical to sequential output - ${request.description}`, (assert) => {
+    composite(request.tiles, request.zxy, request.options, (err, expected) => {
+      assert.ifError(err);
+      const options = Object.assign({}, request.options, { threads: 4 });
+      composite(request.tiles, request.zxy, options, (err, actual) => {
+        assert.ifError(err);
+        assert.ok(expected.equals(actual), 'same bytes');
+        assert.end();
+      });
+    });
+  });
+});
+
+test('[composite] threads - reports invalid source tiles like the sequential path', (assert) => {
+  const tiles = [
+    { buffer: mvtFixtures.get('017').buffer, z: 15, x: 5238, y: 12666 },
+    { buffer: mvtFixtures.get('053').buffer, z: 15, x: 5239, y: 12666 }
+  ];
+  composite(tiles, { z: 15, x: 5238, y: 12666 }, { threads: 2 }, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, 'Invalid tile composite request: SOURCE(15,5239,12666) TARGET(15,5238,12666)');
+    assert.end();
+  });
+});
+
+test('[composite] threads - capped at the number of hardware threads', (assert) => {
+  const request = requests[1];
+  composite(request.tiles, request.zxy, request.options, (err, expected) => {
+    assert.ifError(err);
+    // would otherwise start a thread for each chunk of features
+    const options = Object.assign({}, request.options, { threads: 2147483647 });
+    let remaining = 4;
+    for (let i = 0; i < 4; ++i) {
+      composite(request.tiles, request.zxy, options, (err, actual) => {
+        assert.ifError(err);
+        assert.ok(expected.equals(actual), 'same bytes');
+        if (--remaining === 0) assert.end();
+      });
+    }
+  });
+});
@@ -3,6 +3,7 @@ var composite = require('../lib/index.js').composite;
 var fs = require('fs');
 var path = require('path');
 var vtinfo = require('./test-utils.js').vtinfo;
+var mvtFixtures = require('@mapbox/mvt-fixtures');
 
 test('[composite] composite success polygons - same zoom, different features, without and without buffer', function(assert) {
   const tiles = [
@@ -165,3 +166,115 @@ test('[composite] composite and overzooming polygons with holes', function(asser
     assert.end();
   });
 });
+
+test('[composite] overzooming polygons - features entirely within the target tile are only scaled', function(assert) {
+  const buffer = fs.readFileSync('./test/fixtures/polygons-buildings-sf-15-5239-12666.mvt');
+  const tiles = [{ z: 15, x: 5239, y: 12666, buffer: buffer }];
+  // top-left child: source coordinates [0, 2048] end up in [0, 4096]
+  const zxy = { z: 16, x: 10478, y: 25332 };
+
+  const scaled = (geometry) => geometry.map((ring) => ring.map((pt) => ({ x: pt.x * 2, y: pt.y * 2 })));
+  const inside = (geometry) => geometry.every((ring) => ring.every((pt) => pt.x >= 0 && pt.y >= 0 && pt.x <= 2048 && pt.y <= 2048));
+
+  const source = vtinfo(buffer).layers.building;
+  const expected = [];
+  for (let i = 0; i < source.length; ++i) {
+    const geometry = source.feature(i).loadGeometry();
+    if (inside(geometry)) expected.push(JSON.stringify(scaled(geometry)));
+  }
+  assert.ok(expected.length > 0, 'fixture has buildings within the target tile');
+
+  composite(tiles, zxy, { buffer_size: 0 }, (err, vtBuffer) => {
+    assert.notOk(err);
+    const output = vtinfo(vtBuffer).layers.building;
+    const actual = new Set();
+    for (let i = 0; i < output.length; ++i) {
+      actual.add(JSON.stringify(output.feature(i).loadGeometry()));
+    }
+    assert.ok(expected.every((geometry) => actual.has(geometry)), 'geometry of the buildings within the target tile is unchanged apart from scaling');
+    assert.end();
+  });
+});
+
+test('[composite] overzooming polygons - rings entirely within the target tile are cleaned up like clipped ones', function(assert) {
+  const buffer = mvtFixtures.create({
+    layers: [
+      {
+        version: 2,
+        name: 'polygons',
+        features: [
+          {
+            id: 1,
+            tags: [],
+            type: 3, // polygon
+            // (100,100) (200,100) (300,100) (200,100) (200,200) (100,200): spike at (300,100)
+            geometry: [9, 200, 200, 42, 200, 0, 200, 0, 199, 0, 0, 200, 199, 0, 15]
+          },
+          {
+            id: 2,
+            tags: [],
+            type: 3, // polygon
+            // (100,300) (200,300) (300,300): no area
+            geometry: [9, 200, 600, 18, 200, 0, 200, 0, 15]
+          }
+        ],
+        keys: [],
+        values: [],
+        extent: 4096
+      }
+    ]
+  }).buffer;
+  const tiles = [{ z: 15, x: 0, y: 0, buffer: buffer }];
+  const zxy = { z: 16, x: 0, y: 0 };
+
+  composite(tiles, zxy, { buffer_size: 0 }, (err, vtBuffer) => {
+    assert.notOk(err);
+    const output = vtinfo(vtBuffer).layers.polygons;
+    assert.equal(output.length, 1, 'polygon without area is dropped');
+    assert.deepEqual(output.feature(0).loadGeometry().map((ring) => ring.map((pt) => [pt.x, pt.y])),
+      [[[200, 200], [400, 200], [400, 400], [200, 400], [200, 200]]], 'spike is removed');
+    assert.end();
+  });
+});
+
+test('[composite] overzooming polygons - clipped polygons get the same points as with boost::geometry', function(assert) {
+  const buffer = mvtFixtures.create({
+    layers: [
+      {
+        version: 2,
+        name: 'polygons',
+        features: [
+          {
+            id: 1,
+            tags: [],
+            type: 3, // polygon
+            // (1500,1000) (2500,1333) (2500,1777) (1500,2000): crosses the right edge of the target tile
+            geometry: [9, 3000, 2000, 26, 2000, 666, 0, 888, 1999, 446, 15]
+          },
+          {
+            id: 2,
+            tags: [],
+            type: 3, // polygon
+            // (-100,-100) (2200,-100) (2200,2200) (-100,2200): contains the target tile
+            geometry: [9, 199, 199, 26, 4600, 0, 0, 4600, 4599, 0, 15]
+          }
+        ],
+        keys: [],
+        values: [],
+        extent: 4096
+      }
+    ]
+  }).buffer;
+  const tiles = [{ z: 15, x: 0, y: 0, buffer: buffer }];
+  const zxy = { z: 16, x: 0, y: 0 };
+
+  composite(tiles, zxy, { buffer_size: 0 }, (err, vtBuffer) => {
+    assert.notOk(err);
+    const output = vtinfo(vtBuffer).layers.polygons;
+    assert.equal(output.length, 2);
+    const geometry = (i) => output.feature(i).loadGeometry().map((ring) => ring.map((pt) => [pt.x, pt.y]));
+    assert.deepEqual(geometry(0), [[[3000, 2000], [4096, 2365], [4096, 3756], [3000, 4000], [3000, 2000]]], 'polygon crossing one edge');
+    assert.deepEqual(geometry(1), [[[0, 4096], [0, 0], [4096, 0], [4096, 4096], [0, 4096]]], 'polygon containing the tile');
+    assert.end();
+  });
+});
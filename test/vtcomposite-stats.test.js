@@ -0,0 +1,111 @@
+'use strict';
+
+const test = require('tape');
+const { composite, compositeBatch, localize } = require('../lib/index.js');
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+const overzoomed = [{ buffer: zlib.gzipSync(bufferSF), z: 15, x: 5238, y: 12666 }];
+const zxy = { z: 17, x: 20953, y: 50666 };
+const phases = ['decompress', 'overzoom', 'properties', 'localize', 'serialize', 'compress'];
+
+function checkStats(assert, stats) {
+  phases.forEach((phase) => {
+    assert.equal(typeof stats.time[phase].wall, 'number', `${phase} wall time`);
+    assert.ok(stats.time[phase].wall >= 0, `${phase} wall time is not negative`);
+  });
+  assert.equal(typeof stats.bytes_in, 'number');
+  assert.equal(typeof stats.bytes_out, 'number');
+  assert.ok(Array.isArray(stats.layers));
+  stats.layers.forEach((layer) => {
+    assert.equal(typeof layer.name, 'string');
+    assert.ok(layer.features_out <= layer.features_in || layer.overzoomed, `${layer.name}: features_out`);
+    assert.equal(layer.skipped, 0, `${layer.name}: nothing skipped`);
+  });
+}
+
+test('[composite] no stats argument by default', (assert) => {
+  composite(overzoomed, zxy, {}, function(err, buffer) {
+    assert.ifError(err);
+    assert.ok(arguments.length < 3 || arguments[2].time === undefined, 'no stats');
+    assert.end();
+  });
+});
+
+test('[composite] stats must be a boolean', (assert) => {
+  composite(overzoomed, zxy, { stats: 'yes' }, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, '\'stats\' must be a boolean');
+    assert.end();
+  });
+});
+
+[{}, { threads: 4 }].forEach((extra) => {
+  test(`[composite] stats of an overzoomed composite - ${JSON.stringify(extra)}`, (assert) => {
+    const options = Object.assign({ buffer_size: 64, compress: true, stats: true }, extra);
+    composite(overzoomed, zxy, options, (err, buffer, stats) => {
+      assert.ifError(err);
+      checkStats(assert, stats);
+      assert.equal(stats.bytes_in, overzoomed[0].buffer.length, 'bytes_in');
+      assert.equal(stats.bytes_out, buffer.length, 'bytes_out');
+      assert.ok(stats.time.decompress.wall > 0, 'decompressed');
+      assert.ok(stats.time.compress.wall > 0, 'compressed');
+      assert.ok(stats.layers.length > 0, 'layers');
+      stats.layers.forEach((layer) => {
+        assert.ok(layer.overzoomed, `${layer.name} overzoomed`);
+        assert.ok(layer.bytes_in > 0, `${layer.name} bytes_in`);
+      });
+      const features = stats.layers.reduce((sum, layer) => sum + layer.features_out, 0);
+      assert.ok(features > 0, 'features out');
+      assert.end();
+    });
+  });
+});
+
+test('[composite] stats of layers at the target zoom', (assert) => {
+  const tiles = [{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }];
+  composite(tiles, { z: 15, x: 5238, y: 12666 }, { stats: true }, (err, buffer, stats) => {
+    assert.ifError(err);
+    checkStats(assert, stats);
+    stats.layers.forEach((layer) => {
+      assert.notOk(layer.overzoomed, `${layer.name} not overzoomed`);
+      assert.equal(layer.features_out, layer.features_in, `${layer.name} features kept`);
+      assert.equal(layer.vertices_out, layer.vertices_in, `${layer.name} vertices kept`);
+    });
+    assert.equal(stats.time.decompress.wall, 0, 'nothing to decompress');
+    assert.end();
+  });
+});
+
+test('[compositeBatch] stats', (assert) => {
+  compositeBatch(overzoomed, { z: 16, x: 10476, y: 25332, max_z: 17 }, { stats: true }, (err, results, stats) => {
+    assert.ifError(err);
+    checkStats(assert, stats);
+    const bytes = results.reduce((sum, result) => sum + result.buffer.length, 0);
+    assert.equal(stats.bytes_out, bytes, 'bytes_out of all targets');
+    assert.end();
+  });
+});
+
+test('[localize] stats', (assert) => {
+  const params = { buffer: bufferSF, languages: ['en'], worldviews: ['US'], stats: true };
+  localize(params, (err, buffer, stats) => {
+    assert.ifError(err);
+    checkStats(assert, stats);
+    assert.equal(stats.bytes_in, bufferSF.length, 'bytes_in');
+    assert.equal(stats.bytes_out, buffer.length, 'bytes_out');
+    assert.ok(stats.time.localize.wall > 0, 'localized');
+    assert.ok(stats.layers.length > 0, 'layers');
+    assert.end();
+  });
+});
+
+test('[localize] params.stats must be a boolean', (assert) => {
+  localize({ buffer: bufferSF, stats: 1 }, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, 'params.stats must be a boolean');
+    assert.end();
+  });
+});
@@ -0,0 +1,110 @@
+'use strict';
+
+const test = require('tape');
+const { composite, compositeSync, localize, localizeSync, configure } = require('../lib/index.js');
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+const tiles = [
+  { buffer: fs.readFileSync('./test/fixtures/points-poi-sf-15-5239-12666.mvt'), z: 15, x: 5239, y: 12666 },
+  { buffer: fs.readFileSync('./test/fixtures/linestrings-sf-15-5239-12666.mvt'), z: 15, x: 5239, y: 12666, layers: ['road'] }
+];
+const zxy = { z: 15, x: 5239, y: 12666 };
+
+test('[compositeSync] same output as composite', (assert) => {
+  const overzoomed = [{ buffer: zlib.gzipSync(bufferSF), z: 15, x: 5238, y: 12666 }];
+  const requests = [
+    [tiles, zxy, {}],
+    [tiles, zxy, { compress: true }],
+    [overzoomed, { z: 17, x: 20953, y: 50666 }, { buffer_size: 64 }]
+  ];
+  let pending = requests.length;
+  requests.forEach(([sources, target, options]) => {
+    composite(sources, target, options, (err, expected) => {
+      assert.ifError(err);
+      assert.ok(expected.equals(compositeSync(sources, target, options)), `same bytes for ${JSON.stringify(options)}`);
+      if (--pending === 0) assert.end();
+    });
+  });
+});
+
+test('[compositeSync] options are optional', (assert) => {
+  composite(tiles, zxy, {}, (err, expected) => {
+    assert.ifError(err);
+    assert.ok(expected.equals(compositeSync(tiles, zxy)));
+    assert.end();
+  });
+});
+
+test('[compositeSync] errors are thrown', (assert) => {
+  assert.throws(() => {
+    compositeSync([], zxy, {});
+  }, /'tiles' array must be of length greater than 0/);
+  assert.throws(() => {
+    compositeSync(tiles, 'zxy', {});
+  }, /'zxy_maprequest' must be an object/);
+  assert.throws(() => {
+    compositeSync(tiles, zxy, { buffer_size: -1 });
+  }, /'buffer_size' must be a positive int32/);
+  assert.throws(() => {
+    compositeSync(tiles, { z: 15, x: 5238, y: 12666 }, {});
+  }, /Invalid tile composite request: SOURCE\(15,5239,12666\) TARGET\(15,5238,12666\)/);
+  assert.end();
+});
+
+test('[localizeSync] same output as localize', (assert) => {
+  const params = { buffer: bufferSF, languages: ['en'], worldviews: ['US'], compress: true };
+  localize(params, (err, expected) => {
+    assert.ifError(err);
+    assert.ok(expected.equals(localizeSync(params)));
+    assert.end();
+  });
+});
+
+test('[localizeSync] errors are thrown', (assert) => {
+  assert.throws(() => {
+    localizeSync();
+  }, /first argument must be an object/);
+  assert.throws(() => {
+    localizeSync({});
+  }, /params.buffer is required/);
+  assert.end();
+});
+
+test('[configure] inline_threshold', (assert) => {
+  assert.throws(() => {
+    configure({ inline_threshold: 'small' });
+  }, /'inline_threshold' must be a number/);
+  assert.throws(() => {
+    configure({ inline_threshold: -1 });
+  }, /'inline_threshold' must not be negative/);
+
+  const expected = compositeSync(tiles, zxy, {});
+  configure({ inline_threshold: 1024 * 1024 });
+  let called = false;
+  composite(tiles, zxy, {}, (err, buffer) => {
+    assert.ifError(err);
+    assert.ok(expected.equals(buffer), 'same output inline');
+    called = true;
+  });
+  assert.ok(called, 'small composite ran inline');
+
+  called = false;
+  localize({ buffer: bufferSF }, (err) => {
+    assert.ifError(err);
+    called = true;
+  });
+  assert.ok(called, 'small localize ran inline');
+
+  called = false;
+  composite(tiles, zxy, { threads: 2 }, (err, buffer) => {
+    assert.ifError(err);
+    assert.ok(expected.equals(buffer), 'same output queued');
+    assert.ok(called, 'composite with threads was queued');
+    configure({ inline_threshold: 0 });
+    assert.end();
+  });
+  called = true;
+});
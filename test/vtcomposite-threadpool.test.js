@@ -0,0 +1,72 @@
+'use strict';
+
+const test = require('tape');
+const { composite, localize, configure } = require('../lib/index.js');
+const fs = require('fs');
+const path = require('path');
+const mvtFixtures = require('@mapbox/mvt-fixtures');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+const tiles = [{ buffer: bufferSF, z: 15, x: 5238, y: 12666 }];
+const zxy = { z: 17, x: 20953, y: 50666 };
+
+test('[configure] parameter validation', (assert) => {
+  assert.throws(() => {
+    configure();
+  }, /first argument must be an object/);
+  assert.throws(() => {
+    configure('not an object');
+  }, /first argument must be an object/);
+  assert.throws(() => {
+    configure({ threadpool_size: 'four' });
+  }, /'threadpool_size' must be an int32/);
+  assert.throws(() => {
+    configure({ threadpool_size: 0 });
+  }, /'threadpool_size' must be a positive int32/);
+  assert.end();
+});
+
+test('[configure] results are the same on the vtcomposite threadpool', (assert) => {
+  composite(tiles, zxy, { buffer_size: 64 }, (err, expectedComposite) => {
+    assert.ifError(err);
+    localize({ buffer: bufferSF, languages: ['en'] }, (err, expectedLocalize) => {
+      assert.ifError(err);
+
+      configure({ threadpool_size: 3 });
+      configure({ threadpool_size: 3 }); // same size again is fine
+      assert.throws(() => {
+        configure({ threadpool_size: 4 });
+      }, /already running with a different size/);
+
+      let remaining = 8;
+      const done = () => {
+        if (--remaining === 0) {
+          assert.end();
+        }
+      };
+      ['interactive', 'bulk'].forEach((priority) => {
+        for (let i = 0; i < 2; ++i) {
+          composite(tiles, zxy, { buffer_size: 64, priority, threads: 2 }, (err, actual) => {
+            assert.ifError(err);
+            assert.ok(expectedComposite.equals(actual), `composite ${priority}: same bytes`);
+            done();
+          });
+          localize({ buffer: bufferSF, languages: ['en'], priority }, (err, actual) => {
+            assert.ifError(err);
+            assert.ok(expectedLocalize.equals(actual), `localize ${priority}: same bytes`);
+            done();
+          });
+        }
+      });
+    });
+  });
+});
+
+test('[configure] errors are reported through the callback on the vtcomposite threadpool', (assert) => {
+  const invalid = [{ buffer: mvtFixtures.get('017').buffer, z: 15, x: 5239, y: 12666 }];
+  composite(invalid, { z: 15, x: 5238, y: 12666 }, { priority: 'bulk' }, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, 'Invalid tile composite request: SOURCE(15,5239,12666) TARGET(15,5238,12666)');
+    assert.end();
+  });
+});
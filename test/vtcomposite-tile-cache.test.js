@@ -0,0 +1,77 @@
+'use strict';
+
+const test = require('tape');
+const { composite, configure, cacheStats } = require('../lib/index.js');
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+
+const bufferSF = fs.readFileSync(path.resolve(__dirname + '/../node_modules/@mapbox/mvt-fixtures/real-world/sanfrancisco/15-5238-12666.mvt'));
+const gzippedSF = zlib.gzipSync(bufferSF);
+const zxy = { z: 17, x: 20953, y: 50666 };
+
+test('[configure] tile_cache_size validation', (assert) => {
+  assert.throws(() => {
+    configure({ tile_cache_size: 'big' });
+  }, /'tile_cache_size' must be a number/);
+  assert.throws(() => {
+    configure({ tile_cache_size: -1 });
+  }, /'tile_cache_size' must not be negative/);
+  assert.end();
+});
+
+test('[composite] failure: id must be a non-empty string', (assert) => {
+  composite([{ buffer: gzippedSF, z: 15, x: 5238, y: 12666, id: '' }], zxy, {}, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, '\'id\' value in \'tiles\' array item must be a non-empty string');
+    assert.end();
+  });
+});
+
+test('[composite] tile cache: hot sources are decompressed once', (assert) => {
+  composite([{ buffer: gzippedSF, z: 15, x: 5238, y: 12666 }], zxy, { buffer_size: 64 }, (err, expected) => {
+    assert.ifError(err);
+    configure({ tile_cache_size: 16 * 1024 * 1024 });
+    const before = cacheStats().tiles;
+    assert.equal(before.max_bytes, 16 * 1024 * 1024, 'budget');
+    composite([{ buffer: gzippedSF, z: 15, x: 5238, y: 12666 }], zxy, { buffer_size: 64 }, (err, first) => {
+      assert.ifError(err);
+      // a copy of the same bytes hits the entry keyed by content hash
+      composite([{ buffer: Buffer.from(gzippedSF), z: 15, x: 5238, y: 12666 }], zxy, { buffer_size: 64 }, (err, second) => {
+        assert.ifError(err);
+        const after = cacheStats().tiles;
+        assert.ok(expected.equals(first), 'same output on a miss');
+        assert.ok(expected.equals(second), 'same output on a hit');
+        assert.equal(after.misses - before.misses, 1, 'one miss');
+        assert.equal(after.hits - before.hits, 1, 'one hit');
+        assert.equal(after.bytes, bufferSF.length, 'charged the decompressed size');
+        configure({ tile_cache_size: 0 });
+        assert.equal(cacheStats().tiles.entries, 0, 'disabling the cache empties it');
+        assert.end();
+      });
+    });
+  });
+});
+
+test('[composite] tile cache: entries keyed by id, least recently used evicted', (assert) => {
+  // room for a single decompressed tile
+  configure({ tile_cache_size: bufferSF.length + 1 });
+  const before = cacheStats().tiles;
+  const tile = (id) => [{ buffer: gzippedSF, z: 15, x: 5238, y: 12666, id }];
+  composite(tile('a'), zxy, {}, (err) => {
+    assert.ifError(err);
+    composite(tile('b'), zxy, {}, (err) => {
+      assert.ifError(err);
+      composite(tile('b'), zxy, {}, (err) => {
+        assert.ifError(err);
+        const after = cacheStats().tiles;
+        assert.equal(after.misses - before.misses, 2, 'a and b missed');
+        assert.equal(after.hits - before.hits, 1, 'b hit');
+        assert.equal(after.evictions - before.evictions, 1, 'a evicted');
+        assert.equal(after.entries, 1, 'one entry');
+        configure({ tile_cache_size: 0 });
+        assert.end();
+      });
+    });
+  });
+});
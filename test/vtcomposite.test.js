@@ -1,5 +1,6 @@
 const test = require('tape');
 const composite = require('../lib/index.js').composite;
+const localize = require('../lib/index.js').localize;
 const fs = require('fs');
 const path = require('path');
 const zlib = require('zlib');
@@ -86,6 +87,21 @@ test('[composite] success: compositing single gzipped VT', function(assert) {
   });
 });
 
+test('[composite] success: gzipped VT of several gzip members', function(assert) {
+  const half = Math.floor(bufferSF.length / 2);
+  const members = Buffer.concat([zlib.gzipSync(bufferSF.slice(0, half)), zlib.gzipSync(bufferSF.slice(half))]);
+  const zxy = {z:15, x:5238, y:12666};
+
+  composite([{buffer: bufferSF, z:15, x:5238, y:12666}], zxy, {}, (err, expected) => {
+    assert.notOk(err);
+    composite([{buffer: members, z:15, x:5238, y:12666}], zxy, {}, (err, vtBuffer) => {
+      assert.notOk(err);
+      assert.ok(vtBuffer.equals(expected), 'all members are read');
+      assert.end();
+    });
+  });
+});
+
 test('[composite] success: gzipped output', function(assert) {
   const tiles = [
     {buffer: bufferSF, z:15, x:5238, y:12666}
@@ -100,6 +116,51 @@ test('[composite] success: gzipped output', function(assert) {
   });
 });
 
+test('[composite] success: compression options', function(assert) {
+  const tiles = [
+    {buffer: bufferSF, z:15, x:5238, y:12666}
+  ];
+
+  const zxy = {z:15, x:5238, y:12666};
+
+  composite(tiles, zxy, {compression: {codec: 'gzip', level: 9}}, (err, vtBuffer) => {
+    assert.notOk(err);
+    assert.equal(zlib.gunzipSync(vtBuffer).length, bufferSF.length, 'gzip at level 9');
+    composite(tiles, zxy, {compress: true, compression: {codec: 'gzip', min_bytes: bufferSF.length + 1}}, (err, vtBuffer) => {
+      assert.notOk(err);
+      assert.equal(vtBuffer.length, bufferSF.length, 'smaller than min_bytes: uncompressed');
+      composite(tiles, zxy, {compression: {codec: 'zstd', level: 19}}, (err, vtBuffer) => {
+        if (err) {
+          assert.equal(err.message, 'compression.codec \'zstd\' is not supported by this build');
+          return assert.end();
+        }
+        assert.deepEqual(vtBuffer.slice(0, 4), Buffer.from([0x28, 0xb5, 0x2f, 0xfd]), 'zstd frame');
+        // zstd compressed sources are decompressed
+        composite([{buffer: vtBuffer, z:15, x:5238, y:12666}], zxy, {}, (err, roundtrip) => {
+          assert.notOk(err);
+          assert.equal(roundtrip.length, bufferSF.length, 'same size');
+          assert.end();
+        });
+      });
+    });
+  });
+});
+
+test('[composite] failure: garbage sources are not taken for brotli', function(assert) {
+  // 0x06 happens to be a valid (empty) brotli stream, but not a vector tile:
+  // it fails to parse, as in builds without brotli
+  const garbage = Buffer.from([0x06]);
+  composite([{buffer: garbage, z:0, x:0, y:0}], {z:0, x:0, y:0}, {}, (err) => {
+    assert.ok(err);
+    assert.equal(err.message, 'invalid tag exception');
+    localize({buffer: garbage}, (err) => {
+      assert.ok(err);
+      assert.equal(err.message, 'invalid tag exception');
+      assert.end();
+    });
+  });
+});
+
 // TEST - check vt is within target
 
 test('[composite] failure: discards layer that is not within target', function(assert) {
@@ -397,3 +458,71 @@ test('[composite] success: empty overzoomed tile returns empty buffer even if co
     assert.end();
   });
 });
+
+test('[composite] success: overzooming far enough for 64-bit coordinates', function(assert) {
+  const buffer = mvtFixtures.create({
+    layers: [
+      {
+        version: 2,
+        name: 'deep',
+        features: [
+          { id: 1, tags: [], type: 1, geometry: [9, 4096, 4096] }, // (2048,2048)
+          { id: 2, tags: [], type: 2, geometry: [9, 4094, 4094, 10, 4, 4] }, // (2047,2047) (2049,2049)
+          // (2047,2047) (2049,2047) (2049,2049) (2047,2049): contains the target tile
+          { id: 3, tags: [], type: 3, geometry: [9, 4094, 4094, 26, 4, 0, 0, 4, 3, 0, 15] }
+        ],
+        keys: [],
+        values: [],
+        extent: 4096
+      }
+    ]
+  }).buffer;
+  // zoom factor 2^17: the source tile spans 2^29 units, too many for 32-bit coordinates
+  const tiles = [{ z: 0, x: 0, y: 0, buffer: buffer }];
+  const zxy = { z: 17, x: 65536, y: 65536 };
+
+  composite(tiles, zxy, { buffer_size: 0 }, (err, vtBuffer) => {
+    assert.notOk(err);
+    const output = vtinfo(vtBuffer).layers.deep;
+    assert.equal(output.length, 3);
+    const geometry = (i) => output.feature(i).loadGeometry().map((part) => part.map((pt) => [pt.x, pt.y]));
+    assert.deepEqual(geometry(0), [[[0, 0]]], 'point');
+    assert.deepEqual(geometry(1), [[[0, 0], [4096, 4096]]], 'linestring');
+    assert.deepEqual(geometry(2), [[[0, 4096], [0, 0], [4096, 0], [4096, 4096], [0, 4096]]], 'polygon');
+    assert.end();
+  });
+});
+
+test('[composite] success: features reaching beyond 32-bit coordinates are clipped with 64-bit ones', function(assert) {
+  const buffer = mvtFixtures.create({
+    layers: [
+      {
+        version: 2,
+        name: 'wide',
+        features: [
+          // (1024,1024) (1024 + 2^30,1024)
+          { id: 1, tags: [], type: 2, geometry: [9, 2048, 2048, 10, 2147483648, 0] },
+          // (1000,1000) (1000 + 2^30,1000) (1000 + 2^30,2000) (1000,2000)
+          { id: 2, tags: [], type: 3, geometry: [9, 2000, 2000, 26, 2147483648, 0, 0, 2000, 2147483647, 0, 15] }
+        ],
+        keys: [],
+        values: [],
+        extent: 4096
+      }
+    ]
+  }).buffer;
+  // the layer is overzoomed with 32-bit coordinates, but both features reach
+  // past 2^31 at zoom factor 2
+  const tiles = [{ z: 15, x: 0, y: 0, buffer: buffer }];
+  const zxy = { z: 16, x: 0, y: 0 };
+
+  composite(tiles, zxy, { buffer_size: 0 }, (err, vtBuffer) => {
+    assert.notOk(err);
+    const output = vtinfo(vtBuffer).layers.wide;
+    assert.equal(output.length, 2);
+    const geometry = (i) => output.feature(i).loadGeometry().map((part) => part.map((pt) => [pt.x, pt.y]));
+    assert.deepEqual(geometry(0), [[[2048, 2048], [4096, 2048]]], 'linestring');
+    assert.deepEqual(geometry(1), [[[2000, 2000], [4096, 2000], [4096, 4000], [2000, 4000], [2000, 2000]]], 'polygon');
+    assert.end();
+  });
+});